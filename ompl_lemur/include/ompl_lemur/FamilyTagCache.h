@@ -202,7 +202,7 @@ public:
                   if (!new_tag)
                   {
                      new_tag = _checker->tagIfSetKnown(v_tag_map[v_index], iset->second.var, false);
-                     iset->second.load_valid_map[v_tag_map[v_index]] = new_tag;
+                     iset->second.load_invalid_map[v_tag_map[v_index]] = new_tag;
                   }
                   v_tag_map[v_index] = new_tag;
                   break;
@@ -253,7 +253,7 @@ public:
                   if (!new_tag)
                   {
                      new_tag = _checker->tagIfSetKnown(e_tag_map[e_index], iset->second.var, false);
-                     iset->second.load_valid_map[e_tag_map[e_index]] = new_tag;
+                     iset->second.load_invalid_map[e_tag_map[e_index]] = new_tag;
                   }
                   e_tag_map[e_index] = new_tag;
                   break;
@@ -281,6 +281,7 @@ public:
       {
          if (iset->second.fp)
             fclose(iset->second.fp);
+         iset->second.fp = 0;
       }
    }
    
@@ -305,8 +306,6 @@ public:
       VTagMap v_tag_map, size_t v_from, size_t v_to,
       ETagMap e_tag_map, size_t e_from, size_t e_to)
    {
-      printf("new save not implemented!\n");
-#if 0
       for (typename std::map<size_t, CachedSet>::iterator
          iset=_cached_sets.begin(); iset!=_cached_sets.end(); iset++)
       {
@@ -318,21 +317,14 @@ public:
          // save vertices
          fprintf(iset->second.fp, "vertices ");
          for (size_t v_index=v_from; v_index<v_to; v_index++)
-         {
-            size_t & tag = v_tag_map[v_index];
-            fprintf(iset->second.fp, "%c", iset->second.save_map[tag]);
-         }
+            fputc(_checker->tagSetKnowledge(v_tag_map[v_index], iset->second.var), iset->second.fp);
          fprintf(iset->second.fp, "\n");
          // save edges
          fprintf(iset->second.fp, "edges ");
          for (size_t e_index=e_from; e_index<e_to; e_index++)
-         {
-            size_t & tag = e_tag_map[e_index];
-            fprintf(iset->second.fp, "%c", iset->second.save_map[tag]);
-         }
+            fputc(_checker->tagSetKnowledge(e_tag_map[e_index], iset->second.var), iset->second.fp);
          fprintf(iset->second.fp, "\n");
       }
-#endif
    }
    
    void saveEnd()
@@ -342,6 +334,7 @@ public:
       {
          if (iset->second.fp)
             fclose(iset->second.fp);
+         iset->second.fp = 0;
       }
    }
 };
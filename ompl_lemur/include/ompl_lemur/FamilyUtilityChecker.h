@@ -18,6 +18,16 @@ namespace ompl_lemur
  * 
  * This now implements lazy computation of tags / optimistic plans.
  * 
+ * The family's relations are horn clauses, so the sets implied by each
+ * belief are found by forward chaining over them (see
+ * apply_implications()), rather than from a truth table over all 2^N
+ * assignments; setup is linear in the size of the family.
+ * 
+ * The tag methods may be called concurrently (the lazily-computed
+ * belief states and policies are guarded by a mutex, which is not held
+ * while the underlying checkers run), provided the set checkers
+ * themselves are thread-safe.
+ * 
  * This used to be called `FamilyEffortModel`.
  */
 class FamilyUtilityChecker : public UtilityChecker
@@ -35,18 +45,44 @@ public: // set by calling code (e.g. or_lemur::FamilyPlanner)
 
    typedef std::pair<double, ompl::base::StateValidityCheckerPtr> SetChecker;
    
+   // keeps the computed policies of each target and costs checked
+   // before, and restores them if they are checked again
    void start_checking(std::string set_target, const std::map<std::string, SetChecker> & set_checkers);
    void stop_checking();
+   
+   // by default, each tag's policy is computed by its own search when
+   // it is first needed; if precompute is set, start_checking() instead
+   // computes the policies of all belief states reachable from tag 0
+   // in one backward search from the target-valid states (see
+   // compute_policies()), provided there are at most max_states of them
+   void set_precompute_policies(bool precompute, size_t max_states = 100000);
+   
+   // saves the belief states (in tag order), and the computed policies
+   // (with their tag transitions) of each target and costs checked;
+   // load_tables() restores them into a checker for the same family
+   // whose tags so far are a prefix of the saved ones (e.g. a new one),
+   // so that tag numbering is the same as in the saving checker;
+   // both log any error and return false (leaving the tables unchanged)
+   bool save_tables(const std::string & filename) const;
+   bool load_tables(const std::string & filename);
 
 public: // used internally and by ompl_lemur::FamilyTagCache
 
    // this will throw if set not found!
    size_t getSetIndex(const std::string & set_name) const;
 
-   size_t numTags() const { return _belief_states.size(); }
+   size_t numTags() const
+   {
+      boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+      return _belief_states.size();
+   }
    
    // this may add a new set (changing the result of numTags())
    size_t tagIfSetKnown(size_t tag_in, size_t iset, bool value) const;
+   
+   // what tag_in knows about the set: 'V' (valid), 'I' (invalid),
+   // or 'U' (unknown); this is the per-set tag cache file format
+   char tagSetKnowledge(size_t tag_in, size_t iset) const;
 
 public: // used by planner
 
@@ -58,8 +94,15 @@ public: // used by planner
    
    double getPartialEvalCost(size_t tag, const ompl::base::State * state) const;
    
+   // computes the policies of any new unknown tags;
+   // returns false if not checking (no target)
+   bool updateTagTable(TagTable & table) const;
+   
    bool isValidPartialEval(size_t & tag, const ompl::base::State * state) const;
    
+   size_t isValidPartialEvalBatch(size_t * tags,
+      const ompl::base::State * const * states, size_t n) const;
+   
 private:
    const Family _family;
    bool _has_changed;
@@ -76,7 +119,14 @@ private:
    };
    std::vector<ConjunctionImplication> _conjunction_implications;
    
-   std::vector< std::vector<bool> > _truth_table;
+   // for each set, the conjunction implications it is an antecedent of
+   std::vector< std::vector<size_t> > _implications_by_antecedent;
+   
+   // belief states are bit-packed, with one bit per set in each of
+   // _num_words 64-bit words (so one word for up to 64 sets);
+   // a belief state is the words of which sets are known,
+   // followed by the words of their values (zero where unknown)
+   size_t _num_words;
    
 // these are set by start_checking() and persist until stop_checkint()
 
@@ -85,11 +135,45 @@ private:
    // subsumes var_costs and subsets[g[e].var].second.si->isValid()
    std::vector<SetChecker> _checkers;
    
+   // a pool of belief states, indexed in order of insertion,
+   // with hashed lookup (open addressing with linear probing)
+   class BeliefStateTable
+   {
+   public:
+      BeliefStateTable(): _num_words(1), _size(0) {}
+      
+      // removes all states (keeping the storage),
+      // and sets the number of words per set mask
+      void clear(size_t num_words);
+      
+      size_t size() const { return _size; }
+      
+      // the known and value words of state idx
+      // (invalidated by insert())
+      const uint64_t * get(size_t idx) const
+      {
+         return &_words[idx*2*_num_words];
+      }
+      
+      // the index of bstate, or size() if not present
+      size_t find(const uint64_t * bstate) const;
+      
+      // the index of bstate, which is added if not present
+      size_t insert(const uint64_t * bstate, bool & inserted);
+      
+   private:
+      size_t _num_words;
+      size_t _size;
+      std::vector<uint64_t> _words;
+      std::vector<size_t> _slots; // state index + 1, or 0 if empty
+      
+      // the slot holding bstate, or the empty slot where it belongs
+      size_t find_slot(const uint64_t * bstate) const;
+   };
+   
    // these are only the states that are on optimal paths
    // to the target from existing states!
-   typedef std::pair< std::vector<bool>, std::vector<bool> > BeliefState;
-   mutable std::vector< BeliefState > _belief_states;
-   mutable std::map< BeliefState, size_t > _belief_state_map;
+   mutable BeliefStateTable _belief_states;
    
    // this is cost and target dependent stuff:
    struct BeliefStatePolicy
@@ -106,8 +190,73 @@ private:
    // (even if they are not computed yet)
    mutable std::vector< BeliefStatePolicy > _policy;
    
+   // a hash of the sets and relations, checked by load_tables()
+   std::string _family_hash;
+   
+   // a hash of the target and costs the computed entries of _policy
+   // are for (empty before the first start_checking()),
+   // and the policies of those checked before, by their hash
+   std::string _policy_key;
+   std::map< std::string, std::vector<BeliefStatePolicy> > _stored_policies;
+   
+   bool _precompute_policies;
+   size_t _precompute_max_states;
+   
+   // if _all_policies_valid, the policies of all belief states reachable
+   // from tag 0 (_all_policies[i] is for state i of _all_states),
+   // with computed false for those from which the target cannot be
+   // shown valid
+   bool _all_policies_valid;
+   BeliefStateTable _all_states;
+   std::vector< BeliefStatePolicy > _all_policies;
+   
+   // guards _belief_states, _policy, and the scratch space below
+   mutable boost::recursive_mutex _tables_mutex;
+   
+   // scratch space for compute_policy() and tagIfSetKnown()
+   mutable BeliefStateTable _policy_states;
+   mutable std::vector<uint64_t> _bstate_scratch;
+   mutable std::vector<uint64_t> _chain_words;
+   mutable std::vector<size_t> _chain_counts;
+   mutable std::vector<size_t> _chain_queue;
+   
+   // one check taken by isValidPartialEval() with the desired result
+   struct PolicyStep
+   {
+      size_t tag;
+      size_t iset;
+      bool result_desired;
+      size_t tag_next;
+   };
+   
+   // per-thread scratch space for isValidPartialEvalBatch()
+   mutable boost::thread_specific_ptr< std::vector<PolicyStep> > _batch_steps;
+   
    // this is called if _policy[tag].computed is false
    void compute_policy(size_t tag) const;
+   
+   // fills _all_states and _all_policies, and the policies of all
+   // existing tags found there; returns false (leaving
+   // _all_policies_valid false) if there are too many states
+   bool compute_policies();
+   
+   // copies the policy of tag from _all_policies if it is there
+   bool lookup_policy(size_t tag) const;
+   
+   // marks the sets implied by bstate as known
+   void apply_implications(uint64_t * bstate) const;
+   
+   // extends the true sets in derived (_num_words words) to all those
+   // implied by them; returns false if one is known false in bstate
+   bool chain_implications(const uint64_t * bstate, uint64_t * derived) const;
+   
+   // implements isValidPartialEval(),
+   // appending the steps taken to steps (if passed)
+   bool eval_partial(size_t & tag, const ompl::base::State * state,
+      std::vector<PolicyStep> * steps) const;
+   
+   // the tag reached from tag by a check of its policy's set
+   size_t tag_on_result(size_t tag, bool valid) const;
 };
 
 #ifdef OMPL_LEMUR_HAS_BOOSTSMARTPTRS
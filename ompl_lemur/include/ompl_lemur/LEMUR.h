@@ -37,6 +37,11 @@ public:
       int batch;
       // for lazysp; for current subset only!
       double w_lazy;
+      // value of _w_lazy_epoch when w_lazy was last calculated
+      size_t w_lazy_epoch;
+      // set if an endpoint's tag changed while the edge's batch
+      // was not being searched, so w_lazy was not recalculated
+      bool w_lazy_dirty;
       // interior points, in bisection order
       // if edge_states.size() != num_edge_states,
       // then edge_states needs to be generated! (with tags = 0)
@@ -44,6 +49,9 @@ public:
       std::vector< ompl::base::State * > edge_states;
       //std::vector< size_t > edge_tags;
       size_t edge_tag; // this is the tag for ALL INTERNAL STATES
+      // number of leading edge_states already found valid from
+      // edge_tag (partial progress, see EVAL_TYPE_PATH_BISECT)
+      size_t num_edge_states_passed;
    };
    typedef boost::adjacency_list<
       boost::vecS, // Edgelist ds, for per-vertex out-edges
@@ -114,6 +122,7 @@ public:
       std::vector< ompl::base::State * > edge_states;
       //std::vector< size_t > edge_tags;
       size_t edge_tag; // mega tag?
+      size_t num_edge_states_passed;
    };
    typedef boost::adjacency_list<
       boost::vecS, // Edgelist ds, for per-vertex out-edges
@@ -127,24 +136,17 @@ public:
    typedef boost::graph_traits<OverGraph>::edge_descriptor OverEdge;
    typedef boost::graph_traits<OverGraph>::edge_iterator OverEdgeIter;
 
-   struct filter_num_batches
-   {
-      EPBatchMap edge_batch_map;
-      unsigned int num_batches;
-      filter_num_batches() {}
-      filter_num_batches(EPBatchMap edge_batch_map, unsigned int num_batches):
-         edge_batch_map(edge_batch_map), num_batches(num_batches)
-      {}
-      bool operator()(const Edge & e) const
-      {
-         return get(edge_batch_map, e) < (int)num_batches;
-      }
-   };
+   // per-vertex out-degree over the first k batches, see batch_prefix_apply()
+   typedef boost::iterator_property_map<std::vector<size_t>::iterator, VertexIndexMap> BatchPrefixMap;
 
 private:
    // part 2: members
 
    ompl_lemur::UtilityCheckerPtr _utility_checker;
+   
+   // snapshot of the checker's per-tag queries (see tag_table_refresh);
+   // it is only refreshed while no other threads are running
+   ompl_lemur::UtilityChecker::TagTable _tag_table;
 
    std::map<std::string, boost::function<Roadmap<RoadmapArgs> * (RoadmapArgs args)> > _roadmap_registry;
 
@@ -158,6 +160,10 @@ public:
    // danger, don't change this during planning!
    boost::shared_ptr< TagCache<VIdxTagMap,EIdxTagsMap> > _tag_cache;
    
+   // optional memo of root vertex and edge tags across queries;
+   // danger, don't change this during planning either!
+   boost::shared_ptr<RootTagMemo> _root_tag_memo;
+   
 private:
 
    std::vector< std::pair<size_t,size_t> > _subgraph_sizes; // numverts,numedges (cumulative)
@@ -207,6 +213,13 @@ private:
    unsigned int _num_batches_searched; // the number of batches currently being searched
    
    bool _solve_all;
+   // with _solve_all, the tag cache is saved after every this many
+   // edges are evaluated (and after the vertices); zero disables
+   unsigned int _solve_all_checkpoint;
+   // with _solve_all, only this shard (of the given number) of each
+   // batch's vertex and edge index ranges is evaluated
+   unsigned int _solve_all_shard;
+   unsigned int _solve_all_num_shards;
    
    enum
    {
@@ -215,7 +228,8 @@ private:
       SEARCH_TYPE_LPASTAR,
       SEARCH_TYPE_RLPASTAR,
       SEARCH_TYPE_INCBI,
-      SEARCH_TYPE_WINCBI
+      SEARCH_TYPE_WINCBI,
+      SEARCH_TYPE_CCH
    } _search_type;
    
    double _search_incbi_heur_interp;
@@ -228,6 +242,42 @@ private:
    
    double _search_incbi_balancer_goalfrac;
    
+   bool _search_incbi_parallel;
+   
+   // landmark (alt) heuristics, computed over the applied graph;
+   // _landmarks_valid is cleared whenever it (or its edge lower bounds)
+   // may have changed, and the distances are then recomputed;
+   // _landmark_dists is indexed by vidx*_search_num_landmarks+li
+   unsigned int _search_num_landmarks;
+   bool _landmarks_valid;
+   std::vector<Vertex> _landmarks;
+   std::vector<double> _landmark_dists;
+   
+   // bounded-suboptimal inner search (weighted heuristics);
+   // _solution_suboptimality is the bound achieved by the last solution
+   double _search_epsilon;
+   double _solution_suboptimality;
+   
+   // incremental search state (lpastar/rlpastar/incbi/wincbi)
+   // carried across batches within a single solve();
+   // indexed by vertex index in the applied graph,
+   // whose overlay vertices always follow the core vertices
+   bool _incsp_resumable;
+   size_t _incsp_num_core_vertices;
+   std::vector<Vertex> _incsp_startpreds;
+   std::vector<double> _incsp_startdist;
+   std::vector<double> _incsp_startdistlookahead;
+   std::vector<Vertex> _incsp_goalpreds;
+   std::vector<double> _incsp_goaldist;
+   std::vector<double> _incsp_goaldistlookahead;
+   
+   // polls the termination condition from within lazysp and its
+   // inner search while solve() runs (never cancels otherwise)
+   pr_bgl::cancel_poll _lazysp_cancel;
+   
+   // out-degrees over the batches being searched (see batch_prefix_apply)
+   std::vector<size_t> _batch_prefix_degrees;
+   
    enum
    {
       EVAL_TYPE_FWD,
@@ -236,12 +286,97 @@ private:
       EVAL_TYPE_EVEN,
       EVAL_TYPE_BISECT,
       EVAL_TYPE_FWD_EXPAND,
+      EVAL_TYPE_ALL,
+      EVAL_TYPE_PATH_BISECT,
+      EVAL_TYPE_FAILPROB,
 #if 0
       EVAL_TYPE_PARTITION_ALL,
       EVAL_TYPE_SP_INDICATOR_PROBABILITY
 #endif
    } _eval_type;
    
+   // number of threads used to check the interiors of a batch of
+   // selected edges concurrently (see wmap_get_batch)
+   unsigned int _num_eval_threads;
+   
+   // if set, when the utility checker changes, w_lazy is recalculated
+   // for each edge when it is next used, instead of for all edges
+   bool _defer_w_lazy;
+   
+   // whether any edge may have been marked w_lazy_dirty
+   // since calculate_w_lazy_stale() last ran
+   bool _w_lazy_dirty_any;
+   // advanced when the utility checker changes; edges whose
+   // w_lazy_epoch differs are stale (see w_lazy_get)
+   size_t _w_lazy_epoch;
+   
+   // scratch list of edges whose interiors are checked concurrently
+   std::vector<Edge> _eval_interior_edges;
+   
+   // scratch state tags for wmap_check_interior() on the main thread
+   std::vector<size_t> _interior_tags;
+   
+   // scratch bisection orders of the edges in wmap_get_path_bisect
+   // (null for edges whose interiors are done), and check counts
+   std::vector< const std::vector< std::pair<int,int> > * > _path_bisect_perms;
+   std::vector<size_t> _path_bisect_checks;
+   
+   // number of background threads which speculatively check the
+   // remaining edges of the last lazy path while the inner search runs
+   // (see wmap_speculate); zero disables speculation
+   unsigned int _num_speculative_threads;
+   
+   // per-edge validity check counts of the current speculation
+   std::vector<size_t> _speculative_checks;
+   
+   // speculative validity checks on edges which were (useful)
+   // or were not (wasted) on the path found by the overlapping search
+   size_t _num_speculative_checks_useful;
+   size_t _num_speculative_checks_wasted;
+   
+   // per-vertex flag set when an evaluation changes the vertex's tag,
+   // and cleared once wmap_update recalculates its incident edges
+   std::vector<char> _v_tag_changed;
+   
+   // evaluations applied by wmap_update, the w_lazy recalculations
+   // they performed, and the recalculations which would be performed
+   // if every incident edge were recalculated
+   size_t _num_w_lazy_updates;
+   size_t _num_w_lazy_recalcs;
+   size_t _num_w_lazy_recalcs_full;
+   
+   // inner search vertex expansions (polls of _lazysp_cancel)
+   size_t _num_search_expansions;
+   
+   // for EVAL_TYPE_FAILPROB, the kernel bandwidth over which known
+   // results inform the collision probabilities of nearby edges
+   // (zero means a tenth of the space's maximum extent)
+   double _failprob_bandwidth;
+   double _failprob_h;
+   
+   // evidence for EVAL_TYPE_FAILPROB: the states of known vertices and
+   // the midpoints of edges with known interiors, and whether each was
+   // invalid; these are indexed from 1 (state 0 is the query scratch);
+   // this is kept until the utility checker or eval type changes
+   bool _failprob_active;
+   std::vector<ompl::base::State *> _failprob_states;
+   std::vector<bool> _failprob_invalid;
+   boost::shared_ptr< ompl::NearestNeighbors<size_t> > _failprob_nn;
+   std::vector<size_t> _failprob_near;
+   // whether each vertex (by index) and edge (by EProps::index)
+   // has already been noted as evidence
+   std::vector<bool> _failprob_vertex_noted;
+   std::vector<bool> _failprob_edge_noted;
+   // per-edge (by EProps::index) kernel sums in failprob_get() over the
+   // first _failprob_edge_num_seen evidence states (0 if not computed)
+   std::vector<double> _failprob_edge_sum_weight;
+   std::vector<double> _failprob_edge_sum_invalid;
+   std::vector<size_t> _failprob_edge_num_seen;
+   
+   // advanced whenever the utility checker reports a change,
+   // invalidating the entries in _root_tag_memo
+   size_t _root_tag_memo_epoch;
+   
 public:
    std::ostream * os_alglog;
 
@@ -304,6 +439,13 @@ public:
    void setSolveAll(bool solve_all);
    bool getSolveAll() const;
    
+   void setSolveAllCheckpoint(unsigned int solve_all_checkpoint);
+   unsigned int getSolveAllCheckpoint() const;
+   
+   // shard as "index/count", e.g. "0/1" (the default) or "2/8"
+   void setSolveAllShard(std::string solve_all_shard);
+   std::string getSolveAllShard() const;
+   
    void setSearchType(std::string search_type);
    std::string getSearchType() const;
    
@@ -316,9 +458,30 @@ public:
    void setSearchIncbiBalancerGoalfrac(double search_incbi_balancer_goalfrac);
    double getSearchIncbiBalancerGoalfrac() const;
    
+   void setSearchIncbiParallel(bool search_incbi_parallel);
+   bool getSearchIncbiParallel() const;
+   
+   void setSearchNumLandmarks(unsigned int search_num_landmarks);
+   unsigned int getSearchNumLandmarks() const;
+   
+   void setSearchEpsilon(double search_epsilon);
+   double getSearchEpsilon() const;
+   
    void setEvalType(std::string eval_type);
    std::string getEvalType() const;
    
+   void setNumEvalThreads(unsigned int num_eval_threads);
+   unsigned int getNumEvalThreads() const;
+   
+   void setNumSpeculativeThreads(unsigned int num_speculative_threads);
+   unsigned int getNumSpeculativeThreads() const;
+   
+   void setDeferWLazy(bool defer_w_lazy);
+   bool getDeferWLazy() const;
+   
+   void setFailprobBandwidth(double failprob_bandwidth);
+   double getFailprobBandwidth() const;
+   
    // this is guaranteed to initialize the roadmap
    void setProblemDefinition(const ompl::base::ProblemDefinitionPtr & pdef);
    
@@ -331,6 +494,12 @@ public:
    template <class MyGraph>
    bool do_lazysp_a(MyGraph & graph, std::vector<Edge> & epath);
    
+   // tightens the (non-empty) heuristic vectors
+   // with landmark triangle-inequality bounds
+   // (over the applied graph, so they also hold for its prefixes)
+   void landmarks_apply(
+      std::vector<double> & v_hgvalues, std::vector<double> & v_hsvalues);
+   
    // this fails if problem definition not set
    ompl::base::PlannerStatus solve(const ompl::base::PlannerTerminationCondition & ptc);
    
@@ -338,6 +507,9 @@ public:
    
    void saveTagCache();
    
+   // suboptimality bound of the last solution found
+   double getSolutionSuboptimality();
+   
    double getDurTotal();
    double getDurRoadmapGen();
    double getDurRoadmapInit();
@@ -348,6 +520,15 @@ public:
    double getDurSelector();
    double getDurSelectorNotify();
    
+   size_t getNumSpeculativeChecksUseful();
+   size_t getNumSpeculativeChecksWasted();
+   
+   size_t getNumWLazyUpdates();
+   size_t getNumWLazyRecalcs();
+   size_t getNumWLazyRecalcsFull();
+   
+   size_t getNumSearchExpansions();
+   
    // part 4: private methods
 private:
    
@@ -358,13 +539,152 @@ private:
    void overlay_apply();
    void overlay_unapply();
    
+   // extends _tag_table to the checker's current tags
+   // (clearing it first if the checker has changed)
+   void tag_table_refresh(bool changed);
+   
+   // per-tag queries via _tag_table, falling back to the checker
+   // for tags added since it was last refreshed
+   bool tag_known(size_t tag) const
+   {
+      if (tag < _tag_table.known.size())
+         return _tag_table.known[tag];
+      return _utility_checker->isKnown(tag);
+   }
+   bool tag_known_invalid(size_t tag) const
+   {
+      if (tag < _tag_table.known_invalid.size())
+         return _tag_table.known_invalid[tag];
+      return _utility_checker->isKnownInvalid(tag);
+   }
+   double tag_cost(size_t tag, const ompl::base::State * state) const
+   {
+      if (tag < _tag_table.cost.size())
+         return _tag_table.cost[tag];
+      return _utility_checker->getPartialEvalCost(tag, state);
+   }
+   
+   // also discards the edge's partial progress if it is stale
    void calculate_w_lazy(const Edge & e);
+   
+   // for wmap_update, recalculates w_lazy for the edges incident to v
+   // (except e) if v's tag has changed since they were last recalculated
+   void wmap_update_incident(Vertex v, const Edge & e, std::vector<Edge> & es_changed);
+   void vertex_tag_changed(Vertex v, bool changed);
+   
+   // recalculates w_lazy for every stale edge of the core graph,
+   // on up to _num_eval_threads threads
+   void calculate_w_lazy_stale();
+   
+   // whether stale or dirty w_lazy values may be left until they are
+   // next used (see w_lazy_get), which requires that no other threads
+   // use the graph while the search runs
+   bool w_lazy_deferrable();
+   
+   // a lower bound on w_lazy which holds whatever is later evaluated
+   // (all remaining evaluation costs are taken to be zero)
+   double w_lazy_lower_bound(const Edge & e);
+   
+   // sizes the incremental search state for the applied graph;
+   // if a previous batch was searched during this solve(),
+   // its values are shifted to make room for the new core vertices
+   // and true is returned (so the search can resume from them);
+   // vertices not seen by a previous search are always reset
+   bool incsp_prepare();
+   
+   // marks vertex vidx as not yet reached by either search direction
+   void incsp_reset_vertex(size_t vidx);
+   
+   // sorts each vertex's out-edges in the applied graph by batch,
+   // and computes _batch_prefix_degrees so that the first num_batches
+   // batches are a prefix of each out-edge list (see pr_bgl::prefix_graph)
+   void batch_prefix_apply(unsigned int num_batches);
+   
+   // checks the interiors of the edges (whose states must have been
+   // generated) on up to _num_eval_threads threads
+   void wmap_check_interiors(const std::vector<Edge> & es);
+   
+   // for EVAL_TYPE_PATH_BISECT, checks the selected edges (the whole
+   // unevaluated path) coarse-to-fine across edges, stopping at the
+   // first invalid state; edges keep their partial progress
+   void wmap_get_path_bisect(const std::vector<Edge> & es,
+      std::vector<double> & weights, std::vector<Edge> & es_changed,
+      std::vector<size_t> & changed_ends);
+   
+   // for EVAL_TYPE_FAILPROB, rebuilds the evidence from all known
+   // vertices and edges of the applied graph
+   void failprob_reset();
+   // adds the known vertices and edges of new batches and of the
+   // applied roots to the evidence
+   void failprob_extend();
+   // adds the known results of e and its endpoints to the evidence
+   void failprob_note(const Edge & e);
+   void failprob_note_state(const ompl::base::State * state, bool invalid);
+   double failprob_dist(const size_t & a, const size_t & b);
+   
+   // records the known tags of the current root vertices and edges
+   // in _root_tag_memo (called before they are discarded)
+   void root_tag_memo_save();
+   // assigns memoized tags to unknown root vertices and edges
+   // (the overlay must not be applied)
+   void root_tag_memo_load();
+   
+   // for _solve_all, evaluates every unknown vertex and then every
+   // unevaluated edge, on _num_eval_threads threads, with the same
+   // results as evaluating them in turn
+   void solve_all_evaluate();
 
    // these are public so the property map wrappers can access them;
    // instead, i should probable move those classes inside LEMUR
 public:
    bool isevaledmap_get(const Edge & e);
+   // returns w_lazy, first recalculating it if it is stale
+   double w_lazy_get(const Edge & e)
+   {
+      if (g[e].w_lazy_epoch != _w_lazy_epoch || g[e].w_lazy_dirty)
+         calculate_w_lazy(e);
+      return g[e].w_lazy;
+   }
+   void w_lazy_put(const Edge & e, double w_lazy)
+   {
+      g[e].w_lazy = w_lazy;
+   }
    std::pair<double, std::vector<Edge> > wmap_get(const Edge & e);
+   // appends the changed edges to es_changed, and returns the new w_lazy
+   double wmap_get(const Edge & e, std::vector<Edge> & es_changed);
+   // same results as calling wmap_get() on each (distinct) edge in turn,
+   // recording the end of each edge's changed edges in changed_ends
+   void wmap_get_batch(const std::vector<Edge> & es,
+      std::vector<double> & weights, std::vector<Edge> & es_changed,
+      std::vector<size_t> & changed_ends);
+   
+   // runs search() while background threads check es_speculate
+   // in order; the completed edges are then reported as by
+   // wmap_get_batch(), and their checks counted as useful if they
+   // lie on the path found by the search
+   double wmap_speculate(const std::vector<Edge> & es_speculate,
+      boost::function<double ()> search, const std::vector<Edge> & path,
+      std::vector<Edge> & es, std::vector<double> & weights,
+      std::vector<Edge> & es_changed, std::vector<size_t> & changed_ends);
+   
+   // the parts of wmap_get():
+   // checks the endpoints, returning true if the interior should be checked
+   // (a stale edge's w_lazy and partial progress are recalculated first)
+   // (if num_checks is passed, it is incremented for each check performed)
+   bool wmap_check_endpoints(const Edge & e, size_t * num_checks = 0);
+   // checks the interior states (which must have been generated),
+   // using tags as scratch space; this may be called concurrently
+   // for distinct edges (with distinct scratch space)
+   void wmap_check_interior(const Edge & e,
+      std::vector<size_t> & tags, size_t * num_checks = 0);
+   // recalculates w_lazy for e, and for the incident edges of each
+   // endpoint whose tag changed (those in unsearched batches are
+   // instead marked dirty)
+   double wmap_update(const Edge & e, std::vector<Edge> & es_changed);
+   
+   // estimated probability that e is invalid, kernel-weighted
+   // over the known results near its midpoint
+   double failprob_get(const Edge & e);
    
 private:
    double nn_dist(const Vertex & va, const Vertex & vb);
@@ -386,6 +706,42 @@ inline const double get(const IsEvaledMap & isevaledmap, const LEMUR::Edge & e)
    return isevaledmap.lemur.isevaledmap_get(e);
 }
 
+// helper property map which delegates to LEMUR::w_lazy_get()
+class WLazyMap
+{
+public:
+   typedef boost::read_write_property_map_tag category;
+   typedef LEMUR::Edge key_type;
+   typedef double value_type;
+   typedef double reference;
+   LEMUR & lemur;
+   WLazyMap(LEMUR & lemur): lemur(lemur) {}
+};
+inline double get(const WLazyMap & wlazymap, const LEMUR::Edge & e)
+{
+   return wlazymap.lemur.w_lazy_get(e);
+}
+inline void put(const WLazyMap & wlazymap, const LEMUR::Edge & e, double w_lazy)
+{
+   wlazymap.lemur.w_lazy_put(e, w_lazy);
+}
+
+// helper property map which delegates to LEMUR::failprob_get()
+class FailProbMap
+{
+public:
+   typedef boost::readable_property_map_tag category;
+   typedef LEMUR::Edge key_type;
+   typedef double value_type;
+   typedef double reference;
+   LEMUR & lemur;
+   FailProbMap(LEMUR & lemur): lemur(lemur) {}
+};
+inline double get(const FailProbMap & failprobmap, const LEMUR::Edge & e)
+{
+   return failprobmap.lemur.failprob_get(e);
+}
+
 // helper property map which delegates to FamilyPlanner::wmap_get()
 class WMap
 {
@@ -401,5 +757,29 @@ inline const std::pair<double, std::vector<LEMUR::Edge> > get(const WMap & wmap,
 {
    return wmap.lemur.wmap_get(e);
 }
+inline double lazysp_wmap_eval(const WMap & wmap, const LEMUR::Edge & e,
+   std::vector<LEMUR::Edge> & changed)
+{
+   return wmap.lemur.wmap_get(e, changed);
+}
+inline void lazysp_wmap_eval_batch(const WMap & wmap,
+   const std::vector<LEMUR::Edge> & es, std::vector<double> & weights,
+   std::vector<LEMUR::Edge> & changed, std::vector<std::size_t> & changed_ends)
+{
+   wmap.lemur.wmap_get_batch(es, weights, changed, changed_ends);
+}
+inline bool lazysp_wmap_speculates(const WMap & wmap)
+{
+   return wmap.lemur.getNumSpeculativeThreads() > 0;
+}
+template <class SearchFn>
+inline double lazysp_wmap_speculate(const WMap & wmap,
+   const std::vector<LEMUR::Edge> & speculate, SearchFn search,
+   std::vector<LEMUR::Edge> & es, std::vector<double> & weights,
+   std::vector<LEMUR::Edge> & changed, std::vector<std::size_t> & changed_ends)
+{
+   return wmap.lemur.wmap_speculate(speculate, search, search.path,
+      es, weights, changed, changed_ends);
+}
 
 } // namespace ompl_lemur
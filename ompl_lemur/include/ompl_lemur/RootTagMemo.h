@@ -0,0 +1,100 @@
+/*! \file RootTagMemo.h
+ * \author Chris Dellin <cdellin@gmail.com>
+ * \copyright 2015 Carnegie Mellon University
+ * \copyright License: BSD
+ *
+ * \brief Cross-query memo of root vertex and edge tags
+ *        (ompl_lemur::RootTagMemo)
+ */
+
+namespace ompl_lemur
+{
+
+/*! \brief Memo of the tags of root vertices and root edges
+ *         across queries.
+ *
+ * Without persist_roots, each call to LEMUR::setProblemDefinition()
+ * discards the overlay roots and root-to-anchor edges, so repeated
+ * queries from the same configurations would re-check them.
+ * The memo is constructed outside LEMUR, and provided by pointer
+ * via its LEMUR::_root_tag_memo public member.
+ *
+ * Vertices are keyed by their state quantized to the given resolution
+ * (via StateSpace::copyToReals()), and edges by the unordered pair of
+ * their endpoint keys.
+ * Entries are only valid for a particular utility checker and epoch;
+ * LEMUR advances its epoch whenever UtilityChecker::hasChanged()
+ * reports a change (e.g. a new family target), and the memo is
+ * cleared on the next validate() call with a different checker or
+ * epoch.
+ */
+class RootTagMemo
+{
+public:
+   typedef std::vector<long> Key;
+
+   const double resolution;
+
+   RootTagMemo(double resolution = 1.0e-6):
+      resolution(resolution), _checker(0), _epoch(0)
+   {
+   }
+
+   // clears the memo if it was filled for another checker or epoch
+   void validate(const UtilityChecker * checker, size_t epoch)
+   {
+      if (checker == _checker && epoch == _epoch)
+         return;
+      _checker = checker;
+      _epoch = epoch;
+      _vertex_tags.clear();
+      _edge_tags.clear();
+   }
+
+   Key key(const ompl::base::StateSpace * space, const ompl::base::State * state)
+   {
+      space->copyToReals(_reals, state);
+      Key k(_reals.size());
+      for (unsigned int ui=0; ui<_reals.size(); ui++)
+         k[ui] = (long)floor(_reals[ui]/resolution + 0.5);
+      return k;
+   }
+
+   // tag 0 (unknown) is returned for states not in the memo
+   size_t get_vertex(const Key & k) const
+   {
+      std::map<Key,size_t>::const_iterator it = _vertex_tags.find(k);
+      return (it == _vertex_tags.end()) ? 0 : it->second;
+   }
+
+   void set_vertex(const Key & k, size_t tag)
+   {
+      _vertex_tags[k] = tag;
+   }
+
+   size_t get_edge(const Key & ka, const Key & kb) const
+   {
+      std::map<std::pair<Key,Key>,size_t>::const_iterator it
+         = _edge_tags.find(kb < ka ? std::make_pair(kb,ka) : std::make_pair(ka,kb));
+      return (it == _edge_tags.end()) ? 0 : it->second;
+   }
+
+   void set_edge(const Key & ka, const Key & kb, size_t tag)
+   {
+      _edge_tags[kb < ka ? std::make_pair(kb,ka) : std::make_pair(ka,kb)] = tag;
+   }
+
+   size_t size() const
+   {
+      return _vertex_tags.size() + _edge_tags.size();
+   }
+
+private:
+   const UtilityChecker * _checker;
+   size_t _epoch;
+   std::map<Key,size_t> _vertex_tags;
+   std::map<std::pair<Key,Key>,size_t> _edge_tags;
+   std::vector<double> _reals;
+};
+
+} // namespace ompl_lemur
@@ -62,6 +62,36 @@ public:
     */
    virtual double getPartialEvalCost(size_t tag, const ompl::base::State * state) const = 0;
    
+   /*! \brief Dense snapshot of the per-tag queries, indexed by tag.
+    *
+    * Entry i holds isKnown(i), isKnownInvalid(i), and
+    * getPartialEvalCost(i,0).
+    */
+   struct TagTable
+   {
+      std::vector<char> known;
+      std::vector<char> known_invalid;
+      std::vector<double> cost;
+   };
+   
+   /*! \brief Extend a TagTable to cover every tag currently in use.
+    *
+    * Existing entries are kept, so callers should clear the table
+    * whenever hasChanged() reports a change; tags added afterwards
+    * (e.g. by isValidPartialEval()) are covered by the next call.
+    *
+    * Returns false (leaving the table empty) if the checker cannot
+    * provide one, in which case callers use the per-tag methods.
+    * This default implementation does exactly that.
+    */
+   virtual bool updateTagTable(TagTable & table) const
+   {
+      table.known.clear();
+      table.known_invalid.clear();
+      table.cost.clear();
+      return false;
+   }
+   
    /*! \brief Conduct the optimistic set of evaluations.
     * 
     * Returns true if everything went as planned (so that target is T!).
@@ -74,6 +104,26 @@ public:
     */
    virtual bool isValidPartialEval(size_t & tag, const ompl::base::State * state) const = 0;
    
+   /*! \brief Conduct the optimistic evaluations of several states.
+    * 
+    * Equivalent to calling isValidPartialEval(tags[i], states[i])
+    * for each i in order, stopping after the first which returns
+    * false.  Returns the number of leading states for which it
+    * returned true (so n if all did); the tags of the states evaluated
+    * (the first min(ret+1,n)) are updated.
+    * 
+    * This default implementation does exactly that; checkers which can
+    * amortize work across a batch of states should override it.
+    */
+   virtual size_t isValidPartialEvalBatch(size_t * tags,
+      const ompl::base::State * const * states, size_t n) const
+   {
+      for (size_t i=0; i<n; i++)
+         if (!isValidPartialEval(tags[i], states[i]))
+            return i;
+      return n;
+   }
+   
    /*! \brief Tag-ignorant validity check wrapper.
     * 
     * Users of UtilityChecker will usually not call this, because they
@@ -130,7 +180,10 @@ public:
    bool isKnown(size_t tag) const;
    bool isKnownInvalid(size_t tag) const;
    double getPartialEvalCost(size_t tag, const ompl::base::State * state) const;
+   bool updateTagTable(TagTable & table) const;
    bool isValidPartialEval(size_t & tag, const ompl::base::State * state) const;
+   size_t isValidPartialEvalBatch(size_t * tags,
+      const ompl::base::State * const * states, size_t n) const;
 };
 
 #ifdef OMPL_LEMUR_HAS_BOOSTSMARTPTRS
@@ -4,29 +4,117 @@
  * \copyright License: BSD
  */
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <vector>
 #include <cstdio>
+#include <fstream>
+#include <stdint.h>
 #include <boost/graph/adjacency_list.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/tss.hpp>
 #include <ompl/util/Console.h>
 #include <ompl/base/StateValidityChecker.h>
 #include <pr_bgl/heap_indexed.h>
 #include <ompl_lemur/config.h>
+#include <ompl_lemur/util.h>
 #include <ompl_lemur/UtilityChecker.h>
 #include <ompl_lemur/Family.h>
 #include <ompl_lemur/FamilyUtilityChecker.h>
 
+namespace {
+
+inline bool get_bit(const uint64_t * words, size_t i)
+{
+   return (words[i>>6] >> (i&63)) & 1;
+}
+
+inline void set_bit(uint64_t * words, size_t i)
+{
+   words[i>>6] |= (uint64_t)1 << (i&63);
+}
+
+inline void clear_bit(uint64_t * words, size_t i)
+{
+   words[i>>6] &= ~((uint64_t)1 << (i&63));
+}
+
+} // anonymous namespace
+
+void ompl_lemur::FamilyUtilityChecker::BeliefStateTable::clear(size_t num_words)
+{
+   _num_words = num_words;
+   _size = 0;
+   _words.clear();
+   std::fill(_slots.begin(), _slots.end(), 0);
+}
+
+size_t ompl_lemur::FamilyUtilityChecker::BeliefStateTable::find_slot(
+   const uint64_t * bstate) const
+{
+   const size_t len = 2*_num_words;
+   uint64_t hash = 0;
+   for (size_t iw=0; iw<len; iw++)
+   {
+      hash = (hash ^ bstate[iw]) * 0x9e3779b97f4a7c15ULL;
+      hash ^= hash >> 29;
+   }
+   const size_t mask = _slots.size() - 1;
+   for (size_t islot=hash&mask;; islot=(islot+1)&mask)
+   {
+      if (!_slots[islot])
+         return islot;
+      if (std::equal(bstate, bstate+len, &_words[(_slots[islot]-1)*len]))
+         return islot;
+   }
+}
+
+size_t ompl_lemur::FamilyUtilityChecker::BeliefStateTable::find(
+   const uint64_t * bstate) const
+{
+   if (!_size)
+      return 0;
+   size_t islot = find_slot(bstate);
+   return _slots[islot] ? _slots[islot] - 1 : _size;
+}
+
+size_t ompl_lemur::FamilyUtilityChecker::BeliefStateTable::insert(
+   const uint64_t * bstate, bool & inserted)
+{
+   // keep the load factor at most 1/2
+   if (_slots.size() < 2*(_size+1))
+   {
+      _slots.assign(std::max((size_t)16, 2*_slots.size()), 0);
+      for (size_t idx=0; idx<_size; idx++)
+         _slots[find_slot(get(idx))] = idx + 1;
+   }
+   size_t islot = find_slot(bstate);
+   if (_slots[islot])
+   {
+      inserted = false;
+      return _slots[islot] - 1;
+   }
+   _words.insert(_words.end(), bstate, bstate+2*_num_words);
+   _slots[islot] = ++_size;
+   inserted = true;
+   return _size - 1;
+}
+
 ompl_lemur::FamilyUtilityChecker::FamilyUtilityChecker(
       ompl::base::SpaceInformation * si, const Family & family):
-   ompl_lemur::UtilityChecker(si), _family(family), _has_changed(true)
+   ompl_lemur::UtilityChecker(si), _family(family), _has_changed(true),
+   _precompute_policies(false), _precompute_max_states(100000),
+   _all_policies_valid(false)
 {
    initialize();
 }
 
 ompl_lemur::FamilyUtilityChecker::FamilyUtilityChecker(
       const ompl::base::SpaceInformationPtr & si, const Family & family):
-   ompl_lemur::UtilityChecker(si), _family(family), _has_changed(true)
+   ompl_lemur::UtilityChecker(si), _family(family), _has_changed(true),
+   _precompute_policies(false), _precompute_max_states(100000),
+   _all_policies_valid(false)
 {
    initialize();
 }
@@ -74,58 +162,45 @@ void ompl_lemur::FamilyUtilityChecker::initialize()
       _conjunction_implications.push_back(x);
    }
 
-   // compute truth table
-   std::vector<bool> row(_sets.size(), false);
-   for (;;)
+   // index implications by antecedent (for chain_implications)
+   _implications_by_antecedent.resize(_sets.size());
+   for (size_t ic=0; ic<_conjunction_implications.size(); ic++)
    {
-      // skip invalid truth table rows
-      std::vector<ConjunctionImplication>::iterator implit;
-      for (implit=_conjunction_implications.begin();
-            implit!=_conjunction_implications.end(); implit++)
-      {
-         if (row[implit->consequent])
-            continue;
-         std::vector<std::size_t>::iterator anteit;
-         for (anteit=implit->antecedents.begin();
-               anteit!=implit->antecedents.end(); anteit++)
-            if (!row[*anteit])
-               break;
-         if (anteit!=implit->antecedents.end())
-            continue;
-         break;
-      }
-      if (implit==_conjunction_implications.end())
-         _truth_table.push_back(row);
-      // increment
-      std::size_t iconst;
-      for (iconst=0; iconst<_sets.size(); iconst++)
-      {
-         row[iconst] = !row[iconst];
-         if (row[iconst])
-            break;
-      }
-      if (!(iconst<_sets.size()))
-         break;
+      const ConjunctionImplication & x = _conjunction_implications[ic];
+      for (size_t ia=0; ia<x.antecedents.size(); ia++)
+         _implications_by_antecedent[x.antecedents[ia]].push_back(ic);
    }
-   OMPL_INFORM("Truth table has %lu rows.", _truth_table.size());
+   OMPL_INFORM("Family has %lu sets and %lu implications.",
+      _sets.size(), _conjunction_implications.size());
+   
+   _num_words = std::max((size_t)1, (_sets.size()+63)/64);
 
    // start with the full unknown state, tag 0
-   BeliefState state_initial;
-   state_initial.first.resize(_sets.size(),false);
-   state_initial.second.resize(_sets.size(),false);
-   _belief_states.push_back(state_initial);
-   _belief_state_map[state_initial] = 0;
+   std::vector<uint64_t> state_initial(2*_num_words, 0);
+   bool inserted;
+   _belief_states.clear(_num_words);
+   _belief_states.insert(&state_initial[0], inserted);
    
    // corresponding non-computed policy
    _policy.push_back(BeliefStatePolicy());
+   
+   // hash the sets (in index order) and implications
+   std::string family_text;
+   for (size_t iset=0; iset<_sets.size(); iset++)
+      family_text += _sets[iset] + "\n";
+   for (size_t ic=0; ic<_conjunction_implications.size(); ic++)
+   {
+      const ConjunctionImplication & x = _conjunction_implications[ic];
+      for (size_t ia=0; ia<x.antecedents.size(); ia++)
+         family_text += ompl_lemur::util::sf("%lu ", x.antecedents[ia]);
+      family_text += ompl_lemur::util::sf("=> %lu\n", x.consequent);
+   }
+   _family_hash = ompl_lemur::util::sha1(family_text);
 }
 
 void ompl_lemur::FamilyUtilityChecker::start_checking(std::string set_target,
    const std::map<std::string, ompl_lemur::FamilyUtilityChecker::SetChecker> & set_checkers)
 {
-   // TODO: if checkers and set target are the same,
-   // no need to recompute!
-   
    // convert target and checkers into var index
    _checkers.clear();
    _var_target = _sets.size();
@@ -148,10 +223,38 @@ void ompl_lemur::FamilyUtilityChecker::start_checking(std::string set_target,
       throw std::runtime_error("set target not found!");
    }
    
-   // invalidate policies
-   for (unsigned int ui=0; ui<_policy.size(); ui++)
+   // switch policies (unless they are for the same target and costs)
+   std::string policy_key = _sets[_var_target];
+   for (size_t var=0; var<_checkers.size(); var++)
+      policy_key += ompl_lemur::util::sf(" %.17g", _checkers[var].first);
+   policy_key = ompl_lemur::util::sha1(policy_key);
+   if (policy_key != _policy_key)
    {
-      _policy[ui].computed = false;
+      boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+      
+      // keep the policies of the previous target and costs
+      if (_policy_key.size())
+         _stored_policies[_policy_key] = _policy;
+      
+      // restore those computed before for these (if any)
+      std::map< std::string, std::vector<BeliefStatePolicy> >::iterator
+         stored = _stored_policies.find(policy_key);
+      if (stored != _stored_policies.end())
+      {
+         _policy = stored->second;
+         _policy.resize(_belief_states.size());
+      }
+      else
+      {
+         for (unsigned int ui=0; ui<_policy.size(); ui++)
+         {
+            _policy[ui].computed = false;
+         }
+      }
+      _all_policies_valid = false;
+      _policy_key = policy_key;
+      if (_precompute_policies)
+         compute_policies();
    }
    
    // notify planners that values must be recomputed
@@ -163,6 +266,205 @@ void ompl_lemur::FamilyUtilityChecker::stop_checking()
    _checkers.clear();
 }
 
+void ompl_lemur::FamilyUtilityChecker::set_precompute_policies(bool precompute, size_t max_states)
+{
+   _precompute_policies = precompute;
+   _precompute_max_states = max_states;
+}
+
+// the file has a header line, one line per tag with its knowledge of
+// each set (as in tagSetKnowledge()), and then a block per target and
+// costs with a line per computed policy (in tag order)
+bool ompl_lemur::FamilyUtilityChecker::save_tables(const std::string & filename) const
+{
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   
+   // the current policies supersede any stored for the same key
+   std::map< std::string, const std::vector<BeliefStatePolicy> * > policies;
+   for (std::map< std::string, std::vector<BeliefStatePolicy> >::const_iterator
+      it=_stored_policies.begin(); it!=_stored_policies.end(); it++)
+   {
+      policies[it->first] = &it->second;
+   }
+   if (_policy_key.size())
+      policies[_policy_key] = &_policy;
+   
+   FILE * fp = fopen(filename.c_str(), "w");
+   if (!fp)
+   {
+      OMPL_ERROR("Could not save to file \"%s\".", filename.c_str());
+      return false;
+   }
+   fprintf(fp, "family_tables family %s num_sets %lu num_tags %lu num_policies %lu\n",
+      _family_hash.c_str(), _sets.size(), _belief_states.size(), policies.size());
+   std::string knowledge(_sets.size(), 'U');
+   for (size_t tag=0; tag<_belief_states.size(); tag++)
+   {
+      for (size_t iset=0; iset<_sets.size(); iset++)
+         knowledge[iset] = tagSetKnowledge(tag, iset);
+      fprintf(fp, "tag %s\n", knowledge.c_str());
+   }
+   for (std::map< std::string, const std::vector<BeliefStatePolicy> * >::iterator
+      it=policies.begin(); it!=policies.end(); it++)
+   {
+      const std::vector<BeliefStatePolicy> & policy = *it->second;
+      size_t num_computed = 0;
+      for (size_t tag=0; tag<policy.size(); tag++)
+         if (policy[tag].computed)
+            num_computed++;
+      fprintf(fp, "policies %s num_computed %lu\n", it->first.c_str(), num_computed);
+      for (size_t tag=0; tag<policy.size(); tag++)
+      {
+         if (!policy[tag].computed)
+            continue;
+         fprintf(fp, "policy %lu iset %lu result_desired %d tag_on_valid %lu tag_on_invalid %lu cost_to_go %.17g\n",
+            tag, policy[tag].iset, policy[tag].result_desired ? 1 : 0,
+            policy[tag].tag_on_valid, policy[tag].tag_on_invalid,
+            policy[tag].cost_to_go);
+      }
+   }
+   fclose(fp);
+   return true;
+}
+
+bool ompl_lemur::FamilyUtilityChecker::load_tables(const std::string & filename)
+{
+   std::ifstream fs(filename.c_str());
+   if (!fs.is_open())
+   {
+      OMPL_ERROR("Could not open file \"%s\".", filename.c_str());
+      return false;
+   }
+   
+   // header
+   std::string line;
+   char family_hash[64];
+   size_t num_sets;
+   size_t num_tags;
+   size_t num_policies;
+   int n;
+   if (!std::getline(fs, line)
+      || sscanf(line.c_str(), "family_tables family %40s num_sets %lu num_tags %lu num_policies %lu%n",
+         family_hash, &num_sets, &num_tags, &num_policies, &n) != 4
+      || n != (int)line.size())
+   {
+      OMPL_ERROR("Bad header in file \"%s\".", filename.c_str());
+      return false;
+   }
+   if (family_hash != _family_hash || num_sets != _sets.size() || !num_tags)
+   {
+      OMPL_ERROR("File \"%s\" is for a different family.", filename.c_str());
+      return false;
+   }
+   
+   // belief states
+   const size_t nw = _num_words;
+   std::vector<uint64_t> words(num_tags*2*nw, 0);
+   for (size_t tag=0; tag<num_tags; tag++)
+   {
+      if (!std::getline(fs, line) || line.size() != 4 + num_sets
+         || line.substr(0,4) != "tag ")
+      {
+         OMPL_ERROR("Bad tag line in file \"%s\".", filename.c_str());
+         return false;
+      }
+      uint64_t * bstate = &words[tag*2*nw];
+      for (size_t iset=0; iset<num_sets; iset++)
+      {
+         switch (line[4+iset])
+         {
+         case 'U': break;
+         case 'V': set_bit(bstate, iset); set_bit(bstate+nw, iset); break;
+         case 'I': set_bit(bstate, iset); break;
+         default:
+            OMPL_ERROR("Unknown character in file \"%s\".", filename.c_str());
+            return false;
+         }
+      }
+   }
+   
+   // policies
+   std::map< std::string, std::vector<BeliefStatePolicy> > policies;
+   for (size_t ip=0; ip<num_policies; ip++)
+   {
+      char key[64];
+      size_t num_computed;
+      if (!std::getline(fs, line)
+         || sscanf(line.c_str(), "policies %40s num_computed %lu%n", key, &num_computed, &n) != 2
+         || n != (int)line.size())
+      {
+         OMPL_ERROR("Bad policies line in file \"%s\".", filename.c_str());
+         return false;
+      }
+      std::vector<BeliefStatePolicy> & policy = policies[key];
+      policy.resize(num_tags);
+      for (size_t ic=0; ic<num_computed; ic++)
+      {
+         size_t tag;
+         BeliefStatePolicy p;
+         int result_desired;
+         if (!std::getline(fs, line)
+            || sscanf(line.c_str(), "policy %lu iset %lu result_desired %d tag_on_valid %lu tag_on_invalid %lu cost_to_go %lf%n",
+               &tag, &p.iset, &result_desired, &p.tag_on_valid, &p.tag_on_invalid, &p.cost_to_go, &n) != 6
+            || n != (int)line.size()
+            || !(tag < num_tags) || !(p.iset < num_sets)
+            || !(p.tag_on_valid < num_tags) || !(p.tag_on_invalid < num_tags))
+         {
+            OMPL_ERROR("Bad policy line in file \"%s\".", filename.c_str());
+            return false;
+         }
+         p.computed = true;
+         p.result_desired = result_desired ? true : false;
+         policy[tag] = p;
+      }
+   }
+   
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   
+   // existing tags must be the same as the first saved ones
+   if (num_tags < _belief_states.size())
+   {
+      OMPL_ERROR("File \"%s\" has fewer tags than exist.", filename.c_str());
+      return false;
+   }
+   for (size_t tag=0; tag<_belief_states.size(); tag++)
+   {
+      const uint64_t * bstate = _belief_states.get(tag);
+      if (!std::equal(bstate, bstate+2*nw, &words[tag*2*nw]))
+      {
+         OMPL_ERROR("Tags in file \"%s\" do not match existing tags.", filename.c_str());
+         return false;
+      }
+   }
+   BeliefStateTable belief_states = _belief_states;
+   for (size_t tag=_belief_states.size(); tag<num_tags; tag++)
+   {
+      bool inserted;
+      belief_states.insert(&words[tag*2*nw], inserted);
+      if (!inserted)
+      {
+         OMPL_ERROR("Duplicate tags in file \"%s\".", filename.c_str());
+         return false;
+      }
+   }
+   
+   // add the new tags, and the saved policies
+   // to the tags that have none computed yet
+   std::swap(_belief_states, belief_states);
+   _policy.resize(num_tags);
+   for (std::map< std::string, std::vector<BeliefStatePolicy> >::iterator
+      it=policies.begin(); it!=policies.end(); it++)
+   {
+      std::vector<BeliefStatePolicy> & policy
+         = (it->first == _policy_key) ? _policy : _stored_policies[it->first];
+      policy.resize(num_tags);
+      for (size_t tag=0; tag<num_tags; tag++)
+         if (!policy[tag].computed)
+            policy[tag] = it->second[tag];
+   }
+   return true;
+}
+
 bool ompl_lemur::FamilyUtilityChecker::hasChanged()
 {
    bool ret = _has_changed;
@@ -172,93 +474,189 @@ bool ompl_lemur::FamilyUtilityChecker::hasChanged()
    
 bool ompl_lemur::FamilyUtilityChecker::isKnown(size_t tag) const
 {
-   const BeliefState & bstate = _belief_states[tag];
-   return bstate.first[_var_target];
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   return get_bit(_belief_states.get(tag), _var_target);
 }
 
 bool ompl_lemur::FamilyUtilityChecker::isKnownInvalid(size_t tag) const
 {
-   const BeliefState & bstate = _belief_states[tag];
-   if (!bstate.first[_var_target])
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   const uint64_t * bstate = _belief_states.get(tag);
+   if (!get_bit(bstate, _var_target))
       return false;
-   if (bstate.second[_var_target])
+   if (get_bit(bstate + _num_words, _var_target))
       return false;
    return true;
 }
 
 double ompl_lemur::FamilyUtilityChecker::getPartialEvalCost(size_t tag, const ompl::base::State * state) const
 {
-   const BeliefState & bstate = _belief_states[tag];
-   if (bstate.first[_var_target])
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   if (get_bit(_belief_states.get(tag), _var_target))
       return 0.0;
    if (!_policy[tag].computed)
       compute_policy(tag);
    return _policy[tag].cost_to_go;
 }
 
+bool ompl_lemur::FamilyUtilityChecker::updateTagTable(TagTable & table) const
+{
+   if (!_checkers.size())
+      return UtilityChecker::updateTagTable(table);
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   for (size_t tag=table.known.size(); tag<_belief_states.size(); tag++)
+   {
+      const uint64_t * bstate = _belief_states.get(tag);
+      if (get_bit(bstate, _var_target))
+      {
+         table.known.push_back(true);
+         table.known_invalid.push_back(!get_bit(bstate + _num_words, _var_target));
+         table.cost.push_back(0.0);
+         continue;
+      }
+      if (!_policy[tag].computed)
+         compute_policy(tag);
+      table.known.push_back(false);
+      table.known_invalid.push_back(false);
+      table.cost.push_back(_policy[tag].cost_to_go);
+   }
+   return true;
+}
+
 bool ompl_lemur::FamilyUtilityChecker::isValidPartialEval(size_t & tag, const ompl::base::State * state) const
+{
+   return eval_partial(tag, state, 0);
+}
+
+size_t ompl_lemur::FamilyUtilityChecker::isValidPartialEvalBatch(size_t * tags,
+   const ompl::base::State * const * states, size_t n) const
+{
+   // the steps taken by a state which passes from a given tag are
+   // recorded; later states from the same tag then replay them without
+   // taking the lock, until one of them fails
+   if (!_batch_steps.get())
+      _batch_steps.reset(new std::vector<PolicyStep>());
+   std::vector<PolicyStep> & steps = *_batch_steps;
+   bool have_steps = false;
+   size_t steps_tag = 0;
+   for (size_t i=0; i<n; i++)
+   {
+      if (!have_steps || tags[i] != steps_tag)
+      {
+         steps_tag = tags[i];
+         steps.clear();
+         have_steps = eval_partial(tags[i], states[i], &steps);
+         if (!have_steps)
+            return i;
+         continue;
+      }
+      for (size_t istep=0; istep<steps.size(); istep++)
+      {
+         const PolicyStep & step = steps[istep];
+         bool valid = _checkers[step.iset].second->isValid(states[i]);
+         if (valid != step.result_desired)
+         {
+            tags[i] = tag_on_result(step.tag, valid);
+            return i;
+         }
+      }
+      tags[i] = steps.back().tag_next;
+   }
+   return n;
+}
+
+bool ompl_lemur::FamilyUtilityChecker::eval_partial(size_t & tag,
+   const ompl::base::State * state, std::vector<PolicyStep> * steps) const
 {
    // continue going as planned!
    for (;;)
    {
-      const BeliefState bstate = _belief_states[tag];
-      if (!_policy[tag].computed)
-         compute_policy(tag);
-      
-      bool result_desired = _policy[tag].result_desired;
-      bool valid = _checkers[_policy[tag].iset].second->isValid(state);
-      
-      // update
-      size_t tag_on_result = valid ? _policy[tag].tag_on_valid : _policy[tag].tag_on_invalid;
-      if (!tag_on_result)
+      bool result_desired;
+      size_t iset;
       {
-         tag_on_result = tagIfSetKnown(tag, _policy[tag].iset, valid);
-         
-         // update tag_on_result
-         if (valid)
-            _policy[tag].tag_on_valid = tag_on_result;
-         else
-            _policy[tag].tag_on_invalid = tag_on_result;
+         boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+         if (!_policy[tag].computed)
+            compute_policy(tag);
+         result_desired = _policy[tag].result_desired;
+         iset = _policy[tag].iset;
       }
       
-      tag = tag_on_result;
+      // the check itself runs without holding the lock
+      bool valid = _checkers[iset].second->isValid(state);
+      
+      // update
+      size_t tag_prev = tag;
+      tag = tag_on_result(tag, valid);
       
       // should we continue?
       if (valid != result_desired)
          return false;
       
+      if (steps)
+      {
+         PolicyStep step;
+         step.tag = tag_prev;
+         step.iset = iset;
+         step.result_desired = result_desired;
+         step.tag_next = tag;
+         steps->push_back(step);
+      }
+      
       // are we done?
       if (isKnown(tag))
          return !isKnownInvalid(tag);
    }
 }
 
+size_t ompl_lemur::FamilyUtilityChecker::tag_on_result(size_t tag, bool valid) const
+{
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   size_t tag_on_result = valid ? _policy[tag].tag_on_valid : _policy[tag].tag_on_invalid;
+   if (!tag_on_result)
+   {
+      tag_on_result = tagIfSetKnown(tag, _policy[tag].iset, valid);
+      
+      // update tag_on_result
+      if (valid)
+         _policy[tag].tag_on_valid = tag_on_result;
+      else
+         _policy[tag].tag_on_invalid = tag_on_result;
+   }
+   return tag_on_result;
+}
+
 // this is called if _policy[tag].computed is false
 // right now, this is completely self-contained ...
 void ompl_lemur::FamilyUtilityChecker::compute_policy(size_t tag) const
 {
-   const BeliefState & initial_bstate = _belief_states[tag];
+   const size_t nw = _num_words;
    
-   // TODO: do we already know for this tag?
+   // precomputed by compute_policies()?
+   if (lookup_policy(tag))
+      return;
    
-   std::vector< BeliefState > my_states;
-   std::map< BeliefState, size_t > my_state_map;
+   // the belief states reached by the search (index 0 is tag's)
+   _policy_states.clear(nw);
    
    // points back to initial_state
    // (parent_idx, (iset,result))
    std::vector< std::pair<size_t,std::pair<size_t,bool> > > my_parents;
    
    // do forward dijkstra's search
-   // index: index into my_states
+   // index: index into _policy_states
    // cost: cost so far (from belief_state)
    pr_bgl::heap_indexed<double> heap;
    
-   BeliefState initial_bstate_copy = initial_bstate;
-   my_states.push_back(initial_bstate_copy);
+   bool inserted;
+   _policy_states.insert(_belief_states.get(tag), inserted);
    my_parents.push_back(std::make_pair(0,std::make_pair(0,false)));
-   my_state_map[initial_bstate] = 0;
    heap.insert(0, 0.0);
    
+   // the popped state, and each new state
+   _bstate_scratch.resize(4*nw);
+   uint64_t * popped_bstate = &_bstate_scratch[0];
+   uint64_t * new_bstate = &_bstate_scratch[2*nw];
+   
    size_t popped_idx;
    double popped_distance;
    bool goal_found = false;
@@ -267,11 +665,12 @@ void ompl_lemur::FamilyUtilityChecker::compute_policy(size_t tag) const
       // pop
       popped_idx = heap.top_idx();
       popped_distance = heap.top_key();
-      const BeliefState popped_bstate = my_states[popped_idx];
+      const uint64_t * popped_words = _policy_states.get(popped_idx);
+      std::copy(popped_words, popped_words+2*nw, popped_bstate);
       heap.remove_min();
       
       // are we done??
-      if (popped_bstate.first[_var_target] && popped_bstate.second[_var_target])
+      if (get_bit(popped_bstate, _var_target) && get_bit(popped_bstate+nw, _var_target))
       {
          goal_found = true;
          break;
@@ -281,64 +680,32 @@ void ompl_lemur::FamilyUtilityChecker::compute_policy(size_t tag) const
       for (size_t iset=0; iset<_sets.size(); iset++)
       {
          // obviously, skip tests for states we already know
-         if (popped_bstate.first[iset])
+         if (get_bit(popped_bstate, iset))
             continue;
          for (int iresult=0; iresult<2; iresult++)
          {
             bool result = (iresult==0) ? false : true;
             
             // new belief
-            BeliefState new_bstate = popped_bstate;
-            new_bstate.first[iset] = true; // known
-            new_bstate.second[iset] = result;
-            
-            // compute implications
-            // for each var, which consistent truth table rows have it true or false?
-            std::vector<bool> seen_true(_sets.size(),false);
-            std::vector<bool> seen_false(_sets.size(),false);
-            for (size_t irow=0; irow<_truth_table.size(); irow++)
-            {
-               // is this row inconsistent? then skip
-               size_t ivar_incon;
-               for (ivar_incon=0; ivar_incon<_sets.size(); ivar_incon++)
-                  if (new_bstate.first[ivar_incon] && new_bstate.second[ivar_incon] != _truth_table[irow][ivar_incon])
-                     break;
-               if (ivar_incon<_sets.size())
-                  continue;
-               // ok, this is consistent
-               for (size_t ivar2=0; ivar2<_sets.size(); ivar2++)
-               {
-                  if (_truth_table[irow][ivar2])
-                     seen_true[ivar2] = true;
-                  else
-                     seen_false[ivar2] = true;
-               }
-            }
+            std::copy(popped_bstate, popped_bstate+2*nw, new_bstate);
+            set_bit(new_bstate, iset); // known
+            if (result)
+               set_bit(new_bstate+nw, iset);
             
             // update new_state with implied stuff
-            for (size_t ivar2=0; ivar2<_sets.size(); ivar2++)
-            {
-               if (new_bstate.first[ivar2])
-                  continue;
-               if (seen_true[ivar2] && seen_false[ivar2])
-                  continue;
-               new_bstate.first[ivar2] = true;
-               new_bstate.second[ivar2] = seen_true[ivar2];
-            }
+            apply_implications(new_bstate);
             
             // if this implies the target is false, then don't even bother!
-            if (new_bstate.first[_var_target] && !new_bstate.second[_var_target])
+            if (get_bit(new_bstate, _var_target) && !get_bit(new_bstate+nw, _var_target))
                continue;
             
             // compute the cost to get to this vertex
             double new_distance = popped_distance + _checkers[iset].first;
             
             // de-duplicate new state, get its index
-            size_t new_idx;
-            std::map< BeliefState, size_t >::iterator needle = my_state_map.find(new_bstate);
-            if (needle != my_state_map.end())
+            size_t new_idx = _policy_states.insert(new_bstate, inserted);
+            if (!inserted)
             {
-               new_idx = needle->second;
                // if it's in the heap, then we might have found a new value for it!
                if (heap.contains(new_idx))
                {
@@ -352,12 +719,8 @@ void ompl_lemur::FamilyUtilityChecker::compute_policy(size_t tag) const
             else
             {
                // never seen before state;
-               // add it to my_states with the correct cost,
-               // and add it to the open list (heap)
-               new_idx = my_states.size();
-               my_states.push_back(new_bstate);
+               // add it to the open list (heap) with the correct cost
                my_parents.push_back(std::make_pair(popped_idx,std::make_pair(iset,result)));
-               my_state_map[new_bstate] = new_idx;
                heap.insert(new_idx, new_distance); // check_cost
             }
          }
@@ -380,6 +743,249 @@ void ompl_lemur::FamilyUtilityChecker::compute_policy(size_t tag) const
    _policy[tag].tag_on_invalid = 0;
 }
 
+// the policies are optimistic (each check is assumed to give the
+// desired result), so the cost-to-go of a state is that of a shortest
+// path in the graph of states and checks to a target-valid state;
+// this enumerates the graph reachable from tag 0, and then searches
+// it once backwards from all target-valid states
+bool ompl_lemur::FamilyUtilityChecker::compute_policies()
+{
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   const size_t nw = _num_words;
+   _all_policies_valid = false;
+   
+   // enumerate states (those with the target known are not expanded);
+   // the checks from state idx are [edge_begin[idx], edge_begin[idx+1])
+   std::vector<size_t> edge_begin;
+   std::vector<size_t> edge_target;
+   std::vector<size_t> edge_iset;
+   std::vector<char> edge_result;
+   
+   bool inserted;
+   _all_states.clear(nw);
+   _all_states.insert(_belief_states.get(0), inserted);
+   
+   _bstate_scratch.resize(4*nw);
+   uint64_t * bstate = &_bstate_scratch[0];
+   uint64_t * new_bstate = &_bstate_scratch[2*nw];
+   
+   for (size_t idx=0; idx<_all_states.size(); idx++)
+   {
+      edge_begin.push_back(edge_target.size());
+      const uint64_t * words = _all_states.get(idx);
+      std::copy(words, words+2*nw, bstate);
+      if (get_bit(bstate, _var_target))
+         continue;
+      for (size_t iset=0; iset<_sets.size(); iset++)
+      {
+         if (get_bit(bstate, iset))
+            continue;
+         for (int iresult=0; iresult<2; iresult++)
+         {
+            bool result = (iresult==0) ? false : true;
+            std::copy(bstate, bstate+2*nw, new_bstate);
+            set_bit(new_bstate, iset);
+            if (result)
+               set_bit(new_bstate+nw, iset);
+            apply_implications(new_bstate);
+            if (get_bit(new_bstate, _var_target) && !get_bit(new_bstate+nw, _var_target))
+               continue;
+            size_t new_idx = _all_states.insert(new_bstate, inserted);
+            if (_precompute_max_states < _all_states.size())
+            {
+               OMPL_INFORM("Family has more than %lu reachable belief states;"
+                  " computing policies per tag.", _precompute_max_states);
+               _all_states.clear(nw);
+               return false;
+            }
+            edge_target.push_back(new_idx);
+            edge_iset.push_back(iset);
+            edge_result.push_back(result);
+         }
+      }
+   }
+   const size_t num_states = _all_states.size();
+   edge_begin.push_back(edge_target.size());
+   
+   // index the checks by the state they lead to
+   std::vector<size_t> rev_begin(num_states+1, 0);
+   for (size_t ie=0; ie<edge_target.size(); ie++)
+      rev_begin[edge_target[ie]+1]++;
+   for (size_t idx=0; idx<num_states; idx++)
+      rev_begin[idx+1] += rev_begin[idx];
+   std::vector<size_t> rev_fill(rev_begin.begin(), rev_begin.end()-1);
+   std::vector<size_t> rev_source(edge_target.size());
+   std::vector<size_t> rev_edge(edge_target.size());
+   for (size_t idx=0; idx<num_states; idx++)
+      for (size_t ie=edge_begin[idx]; ie<edge_begin[idx+1]; ie++)
+      {
+         size_t ir = rev_fill[edge_target[ie]]++;
+         rev_source[ir] = idx;
+         rev_edge[ir] = ie;
+      }
+   
+   // backward dijkstra's search from the target-valid states
+   // index: index into _all_states
+   // cost: cost to go
+   _all_policies.assign(num_states, BeliefStatePolicy());
+   std::vector<char> finished(num_states, 0);
+   pr_bgl::heap_indexed<double> heap;
+   for (size_t idx=0; idx<num_states; idx++)
+   {
+      const uint64_t * words = _all_states.get(idx);
+      if (get_bit(words, _var_target) && get_bit(words+nw, _var_target))
+         heap.insert(idx, 0.0);
+   }
+   while (heap.size())
+   {
+      size_t idx = heap.top_idx();
+      double cost_to_go = heap.top_key();
+      heap.remove_min();
+      finished[idx] = 1;
+      for (size_t ir=rev_begin[idx]; ir<rev_begin[idx+1]; ir++)
+      {
+         size_t source = rev_source[ir];
+         if (finished[source])
+            continue;
+         size_t ie = rev_edge[ir];
+         double new_cost = cost_to_go + _checkers[edge_iset[ie]].first;
+         if (heap.contains(source))
+         {
+            if (!(new_cost < heap.key_of(source)))
+               continue;
+            heap.update(source, new_cost);
+         }
+         else
+            heap.insert(source, new_cost);
+         BeliefStatePolicy & policy = _all_policies[source];
+         policy.computed = true;
+         policy.cost_to_go = new_cost;
+         policy.iset = edge_iset[ie];
+         policy.result_desired = edge_result[ie];
+         policy.tag_on_valid = 0;
+         policy.tag_on_invalid = 0;
+      }
+   }
+   _all_policies_valid = true;
+   
+   // fill the policies of the existing tags
+   for (size_t tag=0; tag<_policy.size(); tag++)
+      if (!_policy[tag].computed)
+         lookup_policy(tag);
+   return true;
+}
+
+bool ompl_lemur::FamilyUtilityChecker::lookup_policy(size_t tag) const
+{
+   if (!_all_policies_valid)
+      return false;
+   size_t idx = _all_states.find(_belief_states.get(tag));
+   if (idx == _all_states.size() || !_all_policies[idx].computed)
+      return false;
+   _policy[tag] = _all_policies[idx];
+   return true;
+}
+
+// the implications are horn clauses, so the sets known true in every
+// assignment consistent with bstate are those derived by forward
+// chaining from its true sets, and a set is known false in every such
+// assignment iff chaining from it (and the true sets) reaches a set
+// known false; if bstate is inconsistent, all unknown sets become
+// known false (as when no assignment is consistent)
+void ompl_lemur::FamilyUtilityChecker::apply_implications(uint64_t * bstate) const
+{
+   const size_t nw = _num_words;
+   uint64_t * known = bstate;
+   uint64_t * values = bstate + nw;
+   
+   _chain_words.resize(2*nw);
+   uint64_t * derived = &_chain_words[0];
+   uint64_t * probe = &_chain_words[nw];
+   
+   uint64_t last_mask = ~(uint64_t)0;
+   if (_sets.size() % 64)
+      last_mask = ((uint64_t)1 << (_sets.size()%64)) - 1;
+   
+   // sets implied true
+   for (size_t iw=0; iw<nw; iw++)
+      derived[iw] = known[iw] & values[iw];
+   if (!chain_implications(bstate, derived))
+   {
+      for (size_t iw=0; iw<nw; iw++)
+         known[iw] |= (iw+1 < nw) ? ~(uint64_t)0 : last_mask;
+      return;
+   }
+   bool any_false = false;
+   for (size_t iw=0; iw<nw; iw++)
+   {
+      known[iw] |= derived[iw];
+      values[iw] |= derived[iw];
+      if (known[iw] & ~values[iw])
+         any_false = true;
+   }
+   
+   // sets implied false (only possible if some set is known false)
+   if (!any_false)
+      return;
+   for (size_t iset=0; iset<_sets.size(); iset++)
+   {
+      if (get_bit(known, iset))
+         continue;
+      std::copy(derived, derived+nw, probe);
+      set_bit(probe, iset);
+      if (!chain_implications(bstate, probe))
+         set_bit(known, iset);
+   }
+}
+
+bool ompl_lemur::FamilyUtilityChecker::chain_implications(
+   const uint64_t * bstate, uint64_t * derived) const
+{
+   const uint64_t * known = bstate;
+   const uint64_t * values = bstate + _num_words;
+   
+   // queue of derived sets whose implications are yet to be counted
+   _chain_queue.clear();
+   for (size_t iset=0; iset<_sets.size(); iset++)
+      if (get_bit(derived, iset))
+         _chain_queue.push_back(iset);
+   
+   // number of antecedents of each implication not yet derived;
+   // each implication fires once this reaches zero
+   _chain_counts.resize(_conjunction_implications.size());
+   for (size_t ic=0; ic<_conjunction_implications.size(); ic++)
+   {
+      _chain_counts[ic] = _conjunction_implications[ic].antecedents.size();
+      if (_chain_counts[ic])
+         continue;
+      size_t consequent = _conjunction_implications[ic].consequent;
+      if (get_bit(derived, consequent))
+         continue;
+      if (get_bit(known, consequent) && !get_bit(values, consequent))
+         return false;
+      set_bit(derived, consequent);
+      _chain_queue.push_back(consequent);
+   }
+   
+   for (size_t iq=0; iq<_chain_queue.size(); iq++)
+   {
+      const std::vector<size_t> & ics = _implications_by_antecedent[_chain_queue[iq]];
+      for (size_t ui=0; ui<ics.size(); ui++)
+      {
+         if (--_chain_counts[ics[ui]])
+            continue;
+         size_t consequent = _conjunction_implications[ics[ui]].consequent;
+         if (get_bit(derived, consequent))
+            continue;
+         if (get_bit(known, consequent) && !get_bit(values, consequent))
+            return false;
+         set_bit(derived, consequent);
+         _chain_queue.push_back(consequent);
+      }
+   }
+   return true;
+}
+
 size_t ompl_lemur::FamilyUtilityChecker::getSetIndex(const std::string & set_name) const
 {
    size_t iset;
@@ -392,62 +998,39 @@ size_t ompl_lemur::FamilyUtilityChecker::getSetIndex(const std::string & set_nam
       throw std::runtime_error("set not found!");
 }
 
+char ompl_lemur::FamilyUtilityChecker::tagSetKnowledge(size_t tag_in, size_t iset) const
+{
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   const uint64_t * bstate = _belief_states.get(tag_in);
+   if (!get_bit(bstate, iset))
+      return 'U';
+   return get_bit(bstate + _num_words, iset) ? 'V' : 'I';
+}
+
 size_t ompl_lemur::FamilyUtilityChecker::tagIfSetKnown(size_t tag_in, size_t iset, bool value) const
 {
-   const BeliefState bstate = _belief_states[tag_in];
+   boost::recursive_mutex::scoped_lock lock(_tables_mutex);
+   const size_t nw = _num_words;
    
    // compute resulting belief (it could be new!)
-   BeliefState new_bstate = bstate;
-   new_bstate.first[iset] = true; // known
-   new_bstate.second[iset] = value;
-   
-   // compute implications
-   // for each var, which consistent truth table rows have it true or false?
-   std::vector<bool> seen_true(_sets.size(),false);
-   std::vector<bool> seen_false(_sets.size(),false);
-   for (size_t irow=0; irow<_truth_table.size(); irow++)
-   {
-      // is this row inconsistent? then skip
-      size_t ivar_incon;
-      for (ivar_incon=0; ivar_incon<_sets.size(); ivar_incon++)
-         if (new_bstate.first[ivar_incon] && new_bstate.second[ivar_incon] != _truth_table[irow][ivar_incon])
-            break;
-      if (ivar_incon<_sets.size())
-         continue;
-      // ok, this is consistent
-      for (size_t ivar2=0; ivar2<_sets.size(); ivar2++)
-      {
-         if (_truth_table[irow][ivar2])
-            seen_true[ivar2] = true;
-         else
-            seen_false[ivar2] = true;
-      }
-   }
+   _bstate_scratch.resize(2*nw);
+   uint64_t * new_bstate = &_bstate_scratch[0];
+   const uint64_t * bstate = _belief_states.get(tag_in);
+   std::copy(bstate, bstate+2*nw, new_bstate);
+   set_bit(new_bstate, iset); // known
+   if (value)
+      set_bit(new_bstate+nw, iset);
+   else
+      clear_bit(new_bstate+nw, iset);
    
    // update new_state with implied stuff
-   for (size_t ivar2=0; ivar2<_sets.size(); ivar2++)
-   {
-      if (new_bstate.first[ivar2])
-         continue;
-      if (seen_true[ivar2] && seen_false[ivar2])
-         continue;
-      new_bstate.first[ivar2] = true;
-      new_bstate.second[ivar2] = seen_true[ivar2];
-   }
+   apply_implications(new_bstate);
    
    // check if it's in our set of existing tags ...
    // get the new tag in any case
-   std::map< BeliefState, size_t >::iterator needle = _belief_state_map.find(new_bstate);
-   if (needle != _belief_state_map.end())
-   {
-      return needle->second;
-   }
-   else
-   {
-      size_t new_tag = _belief_states.size();
-      _belief_states.push_back(new_bstate);
-      _belief_state_map[new_bstate] = new_tag;
+   bool inserted;
+   size_t new_tag = _belief_states.insert(new_bstate, inserted);
+   if (inserted)
       _policy.push_back(BeliefStatePolicy());
-      return new_tag;
-   }
+   return new_tag;
 }
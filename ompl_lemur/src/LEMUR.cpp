@@ -4,16 +4,19 @@
  * \copyright License: BSD
  */
 
+#include <cmath>
+#include <cstdio>
 #include <fstream>
+#include <sstream>
 
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
 #include <boost/chrono.hpp>
+#include <boost/thread.hpp>
 #include <boost/property_map/dynamic_property_map.hpp>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 #include <boost/graph/astar_search.hpp>
-#include <boost/graph/filtered_graph.hpp>
 #include <boost/graph/reverse_graph.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
@@ -35,6 +38,8 @@
 #include <pr_bgl/string_map.h>
 #include <pr_bgl/vector_ref_property_map.h>
 #include <pr_bgl/edge_indexed_graph.h>
+#include <pr_bgl/prefix_graph.h>
+#include <pr_bgl/cancel_poll.h>
 #include <pr_bgl/overlay_manager.h>
 #include <pr_bgl/lazysp.h>
 #include <pr_bgl/heap_indexed.h>
@@ -46,10 +51,12 @@
 #endif
 #include <pr_bgl/lpastar.h>
 #include <pr_bgl/incbi.h>
+#include <pr_bgl/cch.h>
 #include <pr_bgl/lazysp_incsp_dijkstra.h>
 #include <pr_bgl/lazysp_incsp_astar.h>
 #include <pr_bgl/lazysp_incsp_lpastar.h>
 #include <pr_bgl/lazysp_incsp_incbi.h>
+#include <pr_bgl/lazysp_incsp_cch.h>
 #include <pr_bgl/waste_edge_map.h>
 
 #include <ompl_lemur/config.h>
@@ -59,19 +66,12 @@
 #include <ompl_lemur/Roadmap.h>
 #include <ompl_lemur/TagCache.h>
 #include <ompl_lemur/UtilityChecker.h>
+#include <ompl_lemur/RootTagMemo.h>
 #include <ompl_lemur/LEMUR.h>
 #include <ompl_lemur/lazysp_log_visitor.h>
 
 namespace boost {
 
-template <class Filter>
-inline
-ompl_lemur::LEMUR::Vertex
-vertex(size_t v_index, const boost::filtered_graph<ompl_lemur::LEMUR::Graph, Filter>& g)
-{
-   return vertex(v_index, g.m_g);
-}
-
 // since we've structured our graph (via the overlay manager)
 // to always remove vertices in the reverse order,
 // we replace boost's remove_vertex function
@@ -86,6 +86,200 @@ void remove_vertex(ompl_lemur::LEMUR::Vertex v, ompl_lemur::LEMUR::Graph & g)
 
 } // boost namespace
 
+namespace {
+
+// orders the stored out-edges of vertex v by edge batch
+struct stored_edge_batch_less
+{
+   const ompl_lemur::LEMUR::Graph & g;
+   ompl_lemur::LEMUR::Vertex v;
+   stored_edge_batch_less(const ompl_lemur::LEMUR::Graph & g, ompl_lemur::LEMUR::Vertex v):
+      g(g), v(v)
+   {
+   }
+   template <class StoredEdge>
+   inline int batch(const StoredEdge & se) const
+   {
+      return g[ompl_lemur::LEMUR::Edge(v, se.get_target(), &se.get_property())].batch;
+   }
+   template <class StoredEdge>
+   inline bool operator()(const StoredEdge & a, const StoredEdge & b) const
+   {
+      return batch(a) < batch(b);
+   }
+};
+
+// stably sorts a vertex's stored out-edges by batch (if not already),
+// and returns how many of them are in the first num_batches batches
+template <class OutEdgeList>
+size_t stored_edges_batch_prefix(OutEdgeList & oel,
+   const stored_edge_batch_less & less, int num_batches)
+{
+   size_t count = 0;
+   bool is_sorted = true;
+   int prev_batch = INT_MIN;
+   for (typename OutEdgeList::iterator it=oel.begin(); it!=oel.end(); ++it)
+   {
+      int batch = less.batch(*it);
+      if (batch < num_batches)
+         count++;
+      if (batch < prev_batch)
+         is_sorted = false;
+      prev_batch = batch;
+   }
+   if (!is_sorted)
+      std::stable_sort(oel.begin(), oel.end(), less);
+   return count;
+}
+
+// checks the interiors of a list of edges,
+// repeatedly taking the next unclaimed edge;
+// this is run concurrently from several threads
+struct interior_check_worker
+{
+   ompl_lemur::LEMUR & lemur;
+   const std::vector<ompl_lemur::LEMUR::Edge> & edges;
+   boost::mutex & mutex;
+   size_t & next;
+   // scratch space (each thread has its own copy of the worker)
+   std::vector<size_t> tags;
+   interior_check_worker(ompl_lemur::LEMUR & lemur,
+      const std::vector<ompl_lemur::LEMUR::Edge> & edges,
+      boost::mutex & mutex, size_t & next):
+      lemur(lemur), edges(edges), mutex(mutex), next(next)
+   {
+   }
+   void operator()()
+   {
+      for (;;)
+      {
+         size_t ui;
+         {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (next == edges.size())
+               return;
+            ui = next++;
+         }
+         lemur.wmap_check_interior(edges[ui], tags);
+      }
+   }
+};
+
+// recalculates the stale w_lazy values of a list of edges,
+// repeatedly taking the next unclaimed chunk of edges;
+// this is run concurrently from several threads
+struct w_lazy_worker
+{
+   ompl_lemur::LEMUR & lemur;
+   const std::vector<ompl_lemur::LEMUR::Edge> & edges;
+   boost::mutex & mutex;
+   size_t & next;
+   w_lazy_worker(ompl_lemur::LEMUR & lemur,
+      const std::vector<ompl_lemur::LEMUR::Edge> & edges,
+      boost::mutex & mutex, size_t & next):
+      lemur(lemur), edges(edges), mutex(mutex), next(next)
+   {
+   }
+   void operator()()
+   {
+      const size_t chunk = 256;
+      for (;;)
+      {
+         size_t ui_from;
+         size_t ui_to;
+         {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (next == edges.size())
+               return;
+            ui_from = next;
+            ui_to = std::min(next + chunk, edges.size());
+            next = ui_to;
+         }
+         for (size_t ui=ui_from; ui<ui_to; ui++)
+            lemur.w_lazy_get(edges[ui]);
+      }
+   }
+};
+
+// checks a list of vertices until each is known,
+// repeatedly taking the next unclaimed vertex;
+// this is run concurrently from several threads
+struct vertex_check_worker
+{
+   const ompl_lemur::UtilityChecker & checker;
+   ompl_lemur::LEMUR::Graph & g;
+   const std::vector<ompl_lemur::LEMUR::Vertex> & vertices;
+   boost::mutex & mutex;
+   size_t & next;
+   vertex_check_worker(const ompl_lemur::UtilityChecker & checker,
+      ompl_lemur::LEMUR::Graph & g,
+      const std::vector<ompl_lemur::LEMUR::Vertex> & vertices,
+      boost::mutex & mutex, size_t & next):
+      checker(checker), g(g), vertices(vertices), mutex(mutex), next(next)
+   {
+   }
+   void operator()()
+   {
+      for (;;)
+      {
+         size_t ui;
+         {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (next == vertices.size())
+               return;
+            ui = next++;
+         }
+         ompl_lemur::LEMUR::Vertex v = vertices[ui];
+         while (!checker.isKnown(g[v].tag))
+            checker.isValidPartialEval(g[v].tag, g[v].state);
+      }
+   }
+};
+
+// speculatively checks a list of edges in order,
+// repeatedly taking the next unclaimed edge until stopped;
+// this is run from background threads during the inner search
+struct speculative_check_worker
+{
+   ompl_lemur::LEMUR & lemur;
+   const std::vector<ompl_lemur::LEMUR::Edge> & edges;
+   std::vector<size_t> & checks;
+   boost::mutex & mutex;
+   size_t & next;
+   bool & stop;
+   // scratch space (each thread has its own copy of the worker)
+   std::vector<size_t> tags;
+   speculative_check_worker(ompl_lemur::LEMUR & lemur,
+      const std::vector<ompl_lemur::LEMUR::Edge> & edges,
+      std::vector<size_t> & checks,
+      boost::mutex & mutex, size_t & next, bool & stop):
+      lemur(lemur), edges(edges), checks(checks),
+      mutex(mutex), next(next), stop(stop)
+   {
+   }
+   void operator()()
+   {
+      for (;;)
+      {
+         size_t ui;
+         bool do_interior;
+         {
+            // endpoints may be shared between edges,
+            // so they are checked while holding the lock
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (stop || next == edges.size())
+               return;
+            ui = next++;
+            do_interior = lemur.wmap_check_endpoints(edges[ui], &checks[ui]);
+         }
+         if (do_interior)
+            lemur.wmap_check_interior(edges[ui], tags, &checks[ui]);
+      }
+   }
+};
+
+} // anonymous namespace
+
 /*
  * ok, how does the overlay graph relate to the core graph?
  * 
@@ -123,11 +317,36 @@ ompl_lemur::LEMUR::LEMUR(const ompl::base::SpaceInformationPtr & si):
    _num_batches_init(0),
    _max_batches(UINT_MAX),
    _solve_all(false),
+   _solve_all_checkpoint(0),
+   _solve_all_shard(0),
+   _solve_all_num_shards(1),
    _search_type(SEARCH_TYPE_ASTAR),
    _search_incbi_heur_interp(0.5),
    _search_incbi_balancer_type(SEARCH_INCBI_BALANCER_TYPE_DISTANCE),
    _search_incbi_balancer_goalfrac(0.5),
+   _search_incbi_parallel(false),
+   _search_num_landmarks(0),
+   _landmarks_valid(false),
+   _search_epsilon(0.0),
+   _solution_suboptimality(1.0),
+   _incsp_resumable(false),
+   _incsp_num_core_vertices(0),
    _eval_type(EVAL_TYPE_EVEN),
+   _num_eval_threads(1),
+   _defer_w_lazy(false),
+   _w_lazy_dirty_any(false),
+   _w_lazy_epoch(0),
+   _num_speculative_threads(0),
+   _num_speculative_checks_useful(0),
+   _num_speculative_checks_wasted(0),
+   _num_w_lazy_updates(0),
+   _num_w_lazy_recalcs(0),
+   _num_w_lazy_recalcs_full(0),
+   _num_search_expansions(0),
+   _failprob_bandwidth(0.0),
+   _failprob_h(0.0),
+   _failprob_active(false),
+   _root_tag_memo_epoch(0),
    os_alglog(0),
    _vidx_tag_map(pr_bgl::make_compose_property_map(get(&VProps::tag,g), get(boost::vertex_index,g))),
    _eidx_tags_map(pr_bgl::make_compose_property_map(get(&EProps::edge_tag,g), eig.edge_vector_map))
@@ -171,6 +390,12 @@ ompl_lemur::LEMUR::LEMUR(const ompl::base::SpaceInformationPtr & si):
    Planner::declareParam<bool>("solve_all", this,
       &ompl_lemur::LEMUR::setSolveAll,
       &ompl_lemur::LEMUR::getSolveAll);
+   Planner::declareParam<unsigned int>("solve_all_checkpoint", this,
+      &ompl_lemur::LEMUR::setSolveAllCheckpoint,
+      &ompl_lemur::LEMUR::getSolveAllCheckpoint);
+   Planner::declareParam<std::string>("solve_all_shard", this,
+      &ompl_lemur::LEMUR::setSolveAllShard,
+      &ompl_lemur::LEMUR::getSolveAllShard);
    Planner::declareParam<std::string>("search_type", this,
       &ompl_lemur::LEMUR::setSearchType,
       &ompl_lemur::LEMUR::getSearchType);
@@ -183,9 +408,30 @@ ompl_lemur::LEMUR::LEMUR(const ompl::base::SpaceInformationPtr & si):
    Planner::declareParam<double>("search_incbi_balancer_goalfrac", this,
       &ompl_lemur::LEMUR::setSearchIncbiBalancerGoalfrac,
       &ompl_lemur::LEMUR::getSearchIncbiBalancerGoalfrac);
+   Planner::declareParam<bool>("search_incbi_parallel", this,
+      &ompl_lemur::LEMUR::setSearchIncbiParallel,
+      &ompl_lemur::LEMUR::getSearchIncbiParallel);
+   Planner::declareParam<unsigned int>("search_num_landmarks", this,
+      &ompl_lemur::LEMUR::setSearchNumLandmarks,
+      &ompl_lemur::LEMUR::getSearchNumLandmarks);
+   Planner::declareParam<double>("search_epsilon", this,
+      &ompl_lemur::LEMUR::setSearchEpsilon,
+      &ompl_lemur::LEMUR::getSearchEpsilon, "0.:0.1:10.");
    Planner::declareParam<std::string>("eval_type", this,
       &ompl_lemur::LEMUR::setEvalType,
       &ompl_lemur::LEMUR::getEvalType);
+   Planner::declareParam<unsigned int>("num_eval_threads", this,
+      &ompl_lemur::LEMUR::setNumEvalThreads,
+      &ompl_lemur::LEMUR::getNumEvalThreads);
+   Planner::declareParam<unsigned int>("num_speculative_threads", this,
+      &ompl_lemur::LEMUR::setNumSpeculativeThreads,
+      &ompl_lemur::LEMUR::getNumSpeculativeThreads);
+   Planner::declareParam<bool>("defer_w_lazy", this,
+      &ompl_lemur::LEMUR::setDeferWLazy,
+      &ompl_lemur::LEMUR::getDeferWLazy);
+   Planner::declareParam<double>("failprob_bandwidth", this,
+      &ompl_lemur::LEMUR::setFailprobBandwidth,
+      &ompl_lemur::LEMUR::getFailprobBandwidth);
    
    // setup ompl_nn
    //nn->setDistanceFunction(boost::bind(&ompl_lemur::LEMUR::nn_dist, this, _1, _2)); // option A
@@ -229,6 +475,10 @@ ompl_lemur::LEMUR::~LEMUR()
    for (boost::tie(oei,oei_end)=edges(og); oei!=oei_end; ++oei)
       for (unsigned int ui=0; ui<og[*oei].edge_states.size(); ui++)
          space->freeState(og[*oei].edge_states[ui]);
+   
+   // failprob evidence
+   for (unsigned int ui=0; ui<_failprob_states.size(); ui++)
+      space->freeState(_failprob_states[ui]);
 }
 
 void ompl_lemur::LEMUR::registerRoadmapType(std::string roadmap_type,
@@ -289,6 +539,7 @@ std::string ompl_lemur::LEMUR::getRoadmapType() const
 void ompl_lemur::LEMUR::setCoeffDistance(double coeff_distance)
 {
    _coeff_distance = coeff_distance;
+   _landmarks_valid = false;
 }
 
 double ompl_lemur::LEMUR::getCoeffDistance() const
@@ -309,6 +560,7 @@ double ompl_lemur::LEMUR::getCoeffCheckcost() const
 void ompl_lemur::LEMUR::setCoeffBatch(double coeff_batch)
 {
    _coeff_batch = coeff_batch;
+   _landmarks_valid = false;
 }
 
 double ompl_lemur::LEMUR::getCoeffBatch() const
@@ -366,6 +618,35 @@ bool ompl_lemur::LEMUR::getSolveAll() const
    return _solve_all;
 }
 
+void ompl_lemur::LEMUR::setSolveAllCheckpoint(unsigned int solve_all_checkpoint)
+{
+   _solve_all_checkpoint = solve_all_checkpoint;
+}
+
+unsigned int ompl_lemur::LEMUR::getSolveAllCheckpoint() const
+{
+   return _solve_all_checkpoint;
+}
+
+void ompl_lemur::LEMUR::setSolveAllShard(std::string solve_all_shard)
+{
+   unsigned int shard;
+   unsigned int num_shards;
+   int n;
+   int ret = sscanf(solve_all_shard.c_str(), "%u/%u%n", &shard, &num_shards, &n);
+   if (ret != 2 || n != (int)solve_all_shard.size() || !(shard < num_shards))
+      throw std::runtime_error("solve_all_shard parameter must be index/count, with index < count.");
+   _solve_all_shard = shard;
+   _solve_all_num_shards = num_shards;
+}
+
+std::string ompl_lemur::LEMUR::getSolveAllShard() const
+{
+   std::stringstream ss;
+   ss << _solve_all_shard << "/" << _solve_all_num_shards;
+   return ss.str();
+}
+
 void ompl_lemur::LEMUR::setSearchType(std::string search_type)
 {
    if (search_type == "dijkstras")
@@ -380,8 +661,13 @@ void ompl_lemur::LEMUR::setSearchType(std::string search_type)
       _search_type = SEARCH_TYPE_INCBI;
    else if (search_type == "wincbi")
       _search_type = SEARCH_TYPE_WINCBI;
+   else if (search_type == "cch")
+      _search_type = SEARCH_TYPE_CCH;
    else
-      throw std::runtime_error("Search type parameter must be dijkstras, astar, or lpastar.");
+      throw std::runtime_error("Search type parameter must be dijkstras, astar, lpastar, rlpastar, incbi, wincbi, or cch.");
+   _incsp_resumable = false;
+   // the singleroot edge costs depend on the search type
+   _landmarks_valid = false;
 }
 
 std::string ompl_lemur::LEMUR::getSearchType() const
@@ -394,6 +680,7 @@ std::string ompl_lemur::LEMUR::getSearchType() const
    case SEARCH_TYPE_RLPASTAR: return "rlpastar";
    case SEARCH_TYPE_INCBI: return "incbi";
    case SEARCH_TYPE_WINCBI: return "wincbi";
+   case SEARCH_TYPE_CCH: return "cch";
    default:
       throw std::runtime_error("corrupted _search_type!");
    }
@@ -444,8 +731,43 @@ double ompl_lemur::LEMUR::getSearchIncbiBalancerGoalfrac() const
    return _search_incbi_balancer_goalfrac;
 }
 
+void ompl_lemur::LEMUR::setSearchIncbiParallel(bool search_incbi_parallel)
+{
+   _search_incbi_parallel = search_incbi_parallel;
+}
+
+bool ompl_lemur::LEMUR::getSearchIncbiParallel() const
+{
+   return _search_incbi_parallel;
+}
+
+void ompl_lemur::LEMUR::setSearchNumLandmarks(unsigned int search_num_landmarks)
+{
+   _search_num_landmarks = search_num_landmarks;
+   _landmarks_valid = false;
+}
+
+unsigned int ompl_lemur::LEMUR::getSearchNumLandmarks() const
+{
+   return _search_num_landmarks;
+}
+
+void ompl_lemur::LEMUR::setSearchEpsilon(double search_epsilon)
+{
+   if (!(0.0 <= search_epsilon))
+      throw std::runtime_error("search_epsilon parameter must be non-negative.");
+   _search_epsilon = search_epsilon;
+}
+
+double ompl_lemur::LEMUR::getSearchEpsilon() const
+{
+   return _search_epsilon;
+}
+
 void ompl_lemur::LEMUR::setEvalType(std::string eval_type)
 {
+   // failprob evidence is not added under other eval types
+   _failprob_active = false;
    if (eval_type == "fwd")
       _eval_type = EVAL_TYPE_FWD;
    else if (eval_type == "rev")
@@ -458,6 +780,12 @@ void ompl_lemur::LEMUR::setEvalType(std::string eval_type)
       _eval_type = EVAL_TYPE_BISECT;
    else if (eval_type == "fwd_expand")
       _eval_type = EVAL_TYPE_FWD_EXPAND;
+   else if (eval_type == "all")
+      _eval_type = EVAL_TYPE_ALL;
+   else if (eval_type == "path_bisect")
+      _eval_type = EVAL_TYPE_PATH_BISECT;
+   else if (eval_type == "failprob")
+      _eval_type = EVAL_TYPE_FAILPROB;
 #if 0
    else if (eval_type == "partition_all")
       _eval_type = EVAL_TYPE_PARTITION_ALL;
@@ -465,7 +793,7 @@ void ompl_lemur::LEMUR::setEvalType(std::string eval_type)
       _eval_type = EVAL_TYPE_SP_INDICATOR_PROBABILITY;
 #endif
    else
-      throw std::runtime_error("Eval type parameter must be fwd rev alt bisect or fwd_expand.");
+      throw std::runtime_error("Eval type parameter must be fwd rev alt even bisect fwd_expand all path_bisect or failprob.");
 }
 
 std::string ompl_lemur::LEMUR::getEvalType() const
@@ -478,6 +806,9 @@ std::string ompl_lemur::LEMUR::getEvalType() const
    case EVAL_TYPE_EVEN: return "even";
    case EVAL_TYPE_BISECT: return "bisect";
    case EVAL_TYPE_FWD_EXPAND: return "fwd_expand";
+   case EVAL_TYPE_ALL: return "all";
+   case EVAL_TYPE_PATH_BISECT: return "path_bisect";
+   case EVAL_TYPE_FAILPROB: return "failprob";
 #if 0
    case EVAL_TYPE_PARTITION_ALL: return "partition_all";
    case EVAL_TYPE_SP_INDICATOR_PROBABILITY: return "sp_indicator_probability";
@@ -487,6 +818,50 @@ std::string ompl_lemur::LEMUR::getEvalType() const
    }
 }
 
+void ompl_lemur::LEMUR::setNumEvalThreads(unsigned int num_eval_threads)
+{
+   if (!num_eval_threads)
+      throw std::runtime_error("num_eval_threads parameter must be positive.");
+   _num_eval_threads = num_eval_threads;
+}
+
+unsigned int ompl_lemur::LEMUR::getNumEvalThreads() const
+{
+   return _num_eval_threads;
+}
+
+void ompl_lemur::LEMUR::setNumSpeculativeThreads(unsigned int num_speculative_threads)
+{
+   _num_speculative_threads = num_speculative_threads;
+}
+
+unsigned int ompl_lemur::LEMUR::getNumSpeculativeThreads() const
+{
+   return _num_speculative_threads;
+}
+
+void ompl_lemur::LEMUR::setDeferWLazy(bool defer_w_lazy)
+{
+   _defer_w_lazy = defer_w_lazy;
+}
+
+bool ompl_lemur::LEMUR::getDeferWLazy() const
+{
+   return _defer_w_lazy;
+}
+
+void ompl_lemur::LEMUR::setFailprobBandwidth(double failprob_bandwidth)
+{
+   if (!(0.0 <= failprob_bandwidth))
+      throw std::runtime_error("failprob_bandwidth parameter must be non-negative.");
+   _failprob_bandwidth = failprob_bandwidth;
+}
+
+double ompl_lemur::LEMUR::getFailprobBandwidth() const
+{
+   return _failprob_bandwidth;
+}
+
 void ompl_lemur::LEMUR::setProblemDefinition(
    const ompl::base::ProblemDefinitionPtr & pdef)
 {
@@ -507,9 +882,18 @@ void ompl_lemur::LEMUR::setProblemDefinition(
    clear_vertex(ov_singlestart, og);
    clear_vertex(ov_singlegoal, og);
    
+   // the landmark distances depend on the roots
+   _landmarks_valid = false;
+   
    // if asked to, remove all root (and anchor) vertices / edges
    if (!_persist_roots)
    {
+      // overlay vertex indices will not be preserved
+      _incsp_resumable = false;
+      
+      // remember what is known about the roots being discarded
+      root_tag_memo_save();
+      
       // free all edge internal data
       OverEdgeIter oei, oei_end;
       for (boost::tie(oei,oei_end)=edges(og); oei!=oei_end; oei++)
@@ -660,6 +1044,7 @@ void ompl_lemur::LEMUR::setProblemDefinition(
             //edge_init_points(state, g[*vi].state, dist, og[oe].edge_states);
             //og[oe].edge_tags.resize(og[oe].edge_states.size(), 0);
             og[oe].edge_tag = 0;
+            og[oe].num_edge_states_passed = 0;
          }
          
       }
@@ -674,6 +1059,7 @@ void ompl_lemur::LEMUR::setProblemDefinition(
          og[e].batch = 0;
          og[e].num_edge_states = 0;
          og[e].edge_tag = 0;
+         og[e].num_edge_states_passed = 0;
       }
    }
 }
@@ -691,7 +1077,7 @@ bool ompl_lemur::LEMUR::do_lazysp_c(
             og[ov_singlestart].core_vertex,
             og[ov_singlegoal].core_vertex,
             ompl_lemur::WMap(*this),
-            get(&EProps::w_lazy,g),
+            ompl_lemur::WLazyMap(*this),
             ompl_lemur::IsEvaledMap(*this),
             epath,
             incsp,
@@ -701,8 +1087,8 @@ bool ompl_lemur::LEMUR::do_lazysp_c(
                   get(boost::vertex_index, g),
                   get(&EProps::index, g),
                   *os_alglog),
-               LazySPTimingVisitor(_dur_search, _dur_eval, _dur_selector, _dur_selector_notify))
-            );
+               LazySPTimingVisitor(_dur_search, _dur_eval, _dur_selector, _dur_selector_notify)),
+            _lazysp_cancel);
       }
       else
       {
@@ -710,12 +1096,13 @@ bool ompl_lemur::LEMUR::do_lazysp_c(
             og[ov_singlestart].core_vertex,
             og[ov_singlegoal].core_vertex,
             ompl_lemur::WMap(*this),
-            get(&EProps::w_lazy,g),
+            ompl_lemur::WLazyMap(*this),
             ompl_lemur::IsEvaledMap(*this),
             epath,
             incsp,
             evalstrategy,
-            LazySPTimingVisitor(_dur_search, _dur_eval, _dur_selector, _dur_selector_notify));
+            LazySPTimingVisitor(_dur_search, _dur_eval, _dur_selector, _dur_selector_notify),
+            _lazysp_cancel);
       }
    }
    else // no timing
@@ -726,7 +1113,7 @@ bool ompl_lemur::LEMUR::do_lazysp_c(
             og[ov_singlestart].core_vertex,
             og[ov_singlegoal].core_vertex,
             ompl_lemur::WMap(*this),
-            get(&EProps::w_lazy,g),
+            ompl_lemur::WLazyMap(*this),
             ompl_lemur::IsEvaledMap(*this),
             epath,
             incsp,
@@ -734,7 +1121,8 @@ bool ompl_lemur::LEMUR::do_lazysp_c(
             ompl_lemur::make_lazysp_log_visitor(
                get(boost::vertex_index, g),
                get(&EProps::index, g),
-               *os_alglog));
+               *os_alglog),
+            _lazysp_cancel);
       }
       else
       {
@@ -742,12 +1130,13 @@ bool ompl_lemur::LEMUR::do_lazysp_c(
             og[ov_singlestart].core_vertex,
             og[ov_singlegoal].core_vertex,
             ompl_lemur::WMap(*this),
-            get(&EProps::w_lazy,g),
+            ompl_lemur::WLazyMap(*this),
             ompl_lemur::IsEvaledMap(*this),
             epath,
             incsp,
             evalstrategy,
-            pr_bgl::lazysp_visitor_null());
+            pr_bgl::lazysp_visitor_null(),
+            _lazysp_cancel);
       }
    }
 }
@@ -775,6 +1164,23 @@ bool ompl_lemur::LEMUR::do_lazysp_b(MyGraph & mg, std::vector<Edge> & epath, Inc
    case EVAL_TYPE_FWD_EXPAND:
       return do_lazysp_c(mg, epath, incsp,
          pr_bgl::lazysp_selector_fwdexpand());
+   case EVAL_TYPE_ALL:
+      return do_lazysp_c(mg, epath, incsp,
+         pr_bgl::lazysp_selector_all());
+   case EVAL_TYPE_PATH_BISECT:
+      // the selected edges are interleaved in wmap_get_batch()
+      return do_lazysp_c(mg, epath, incsp,
+         pr_bgl::lazysp_selector_all());
+   case EVAL_TYPE_FAILPROB:
+      // the evidence is kept across batches and queries,
+      // and is added as evaluations are applied in wmap_update()
+      if (_failprob_active)
+         failprob_extend();
+      else
+         failprob_reset();
+      return do_lazysp_c(mg, epath, incsp,
+         pr_bgl::lazysp_selector_maxprob<ompl_lemur::FailProbMap>(
+            ompl_lemur::FailProbMap(*this)));
 #if 0
    case EVAL_TYPE_PARTITION_ALL: 
    {
@@ -822,6 +1228,87 @@ bool ompl_lemur::LEMUR::do_lazysp_b(MyGraph & mg, std::vector<Edge> & epath, Inc
    }
 }
 
+void ompl_lemur::LEMUR::landmarks_apply(
+   std::vector<double> & v_hgvalues, std::vector<double> & v_hsvalues)
+{
+   const double inf = std::numeric_limits<double>::infinity();
+   size_t num_v = num_vertices(g);
+   unsigned int stride = _search_num_landmarks;
+   
+   // recompute the landmark distances only if they were invalidated
+   // (a new batch, new roots, or a changed checker or cost coefficient)
+   if (!_landmarks_valid || _landmark_dists.size() != num_v * stride)
+   {
+      _landmarks_valid = true;
+      
+      // lower-bound edge weights over the whole applied graph;
+      // distances over it are no longer than over any batch prefix,
+      // so the bounds below hold for each searched batch
+      std::vector<double> e_lbs(num_edges(eig), inf);
+      EdgeIter ei, ei_end;
+      for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei)
+         e_lbs[g[*ei].index] = w_lazy_lower_bound(*ei);
+      
+      // select landmarks by farthest-point selection,
+      // starting from the goal (which alone makes v_hgvalues exact
+      // w.r.t. the lower-bound weights)
+      _landmarks.clear();
+      _landmark_dists.resize(num_v * stride);
+      std::vector<double> v_dists(num_v);
+      std::vector<double> v_mindists(num_v, inf);
+      Vertex v_next = og[ov_singlegoal].core_vertex;
+      while (_landmarks.size() < stride)
+      {
+         unsigned int li = _landmarks.size();
+         _landmarks.push_back(v_next);
+         boost::dijkstra_shortest_paths(g, v_next,
+            boost::weight_map(boost::make_iterator_property_map(e_lbs.begin(), get(&EProps::index,g)))
+            .distance_map(boost::make_iterator_property_map(v_dists.begin(), get(boost::vertex_index,g)))
+            .distance_inf(inf));
+         double dist_far = 0.0;
+         for (size_t vidx=0; vidx<num_v; vidx++)
+         {
+            _landmark_dists[vidx*stride+li] = v_dists[vidx];
+            if (v_dists[vidx] < v_mindists[vidx])
+               v_mindists[vidx] = v_dists[vidx];
+            if (v_mindists[vidx] != inf && dist_far < v_mindists[vidx]
+               && g[vertex(vidx,g)].state)
+            {
+               dist_far = v_mindists[vidx];
+               v_next = vertex(vidx,g);
+            }
+         }
+         if (dist_far == 0.0)
+            break;
+      }
+   }
+   
+   // |d(l,root) - d(l,v)| <= d(v,root) for every landmark l
+   size_t vidx_sg = get(get(boost::vertex_index,g), og[ov_singlegoal].core_vertex);
+   size_t vidx_ss = get(get(boost::vertex_index,g), og[ov_singlestart].core_vertex);
+   for (size_t vidx=0; vidx<num_v; vidx++)
+   {
+      for (unsigned int li=0; li<_landmarks.size(); li++)
+      {
+         double d_v = _landmark_dists[vidx*stride+li];
+         if (d_v == inf)
+            continue;
+         if (v_hgvalues.size() && _landmark_dists[vidx_sg*stride+li] != inf)
+         {
+            double h = fabs(_landmark_dists[vidx_sg*stride+li] - d_v);
+            if (v_hgvalues[vidx] < h)
+               v_hgvalues[vidx] = h;
+         }
+         if (v_hsvalues.size() && _landmark_dists[vidx_ss*stride+li] != inf)
+         {
+            double h = fabs(_landmark_dists[vidx_ss*stride+li] - d_v);
+            if (v_hsvalues[vidx] < h)
+               v_hsvalues[vidx] = h;
+         }
+      }
+   }
+}
+
 template <class MyGraph>
 bool ompl_lemur::LEMUR::do_lazysp_a(MyGraph & mg, std::vector<Edge> & epath)
 {
@@ -927,6 +1414,9 @@ bool ompl_lemur::LEMUR::do_lazysp_a(MyGraph & mg, std::vector<Edge> & epath)
       }
    }
    
+   if (_search_num_landmarks && (v_hgvalues.size() || v_hsvalues.size()))
+      landmarks_apply(v_hgvalues, v_hsvalues);
+   
    if (_do_timing)
       _dur_search += boost::chrono::high_resolution_clock::now() - time_heur_begin;
    
@@ -934,7 +1424,10 @@ bool ompl_lemur::LEMUR::do_lazysp_a(MyGraph & mg, std::vector<Edge> & epath)
    {
    case SEARCH_TYPE_ASTAR:
       {
-         // astar
+         // astar (weighted if search_epsilon is set)
+         if (_search_epsilon)
+            for (unsigned int ui=0; ui<v_hgvalues.size(); ui++)
+               v_hgvalues[ui] *= 1.0 + _search_epsilon;
          std::vector<Vertex> v_startpreds(num_vertices(eig));
          std::vector<double> v_startdist(num_vertices(eig));
          std::vector<double> v_fvalues(num_vertices(eig));
@@ -955,45 +1448,45 @@ bool ompl_lemur::LEMUR::do_lazysp_a(MyGraph & mg, std::vector<Edge> & epath)
    case SEARCH_TYPE_LPASTAR:
       {
          // lpastar
-         std::vector<Vertex> v_startpreds(num_vertices(eig));
-         std::vector<double> v_gvalues(num_vertices(eig));
-         std::vector<double> v_rhsvalues(num_vertices(eig));
+         bool do_resume = incsp_prepare();
          
          return do_lazysp_b(mg, epath,
             pr_bgl::make_lazysp_incsp_lpastar(mg,
                og[ov_singlestart].core_vertex,
                og[ov_singlegoal].core_vertex,
-               get(&EProps::w_lazy,g),
+               ompl_lemur::WLazyMap(*this),
                boost::make_iterator_property_map(v_hgvalues.begin(), get(boost::vertex_index,g)), // heuristic_map
-               boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-               boost::make_iterator_property_map(v_gvalues.begin(), get(boost::vertex_index,g)), // gvalues_map
-               boost::make_iterator_property_map(v_rhsvalues.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+               boost::make_iterator_property_map(_incsp_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+               boost::make_iterator_property_map(_incsp_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
+               boost::make_iterator_property_map(_incsp_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
                1.0e-9, // goal_margin
                std::less<double>(), // compare
                boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
-               std::numeric_limits<double>::infinity(), 0.0));
+               std::numeric_limits<double>::infinity(), 0.0,
+               do_resume, 1.0 + _search_epsilon,
+               &_solution_suboptimality));
       }
       break;
    case SEARCH_TYPE_RLPASTAR:
       {
-         // lpastar
-         std::vector<Vertex> v_startpreds(num_vertices(eig));
-         std::vector<double> v_gvalues(num_vertices(eig));
-         std::vector<double> v_rhsvalues(num_vertices(eig));
+         // lpastar (rooted at the goal)
+         bool do_resume = incsp_prepare();
          
          return do_lazysp_b(mg, epath,
             pr_bgl::make_lazysp_incsp_rlpastar(mg,
                og[ov_singlestart].core_vertex,
                og[ov_singlegoal].core_vertex,
-               get(&EProps::w_lazy,g),
+               ompl_lemur::WLazyMap(*this),
                boost::make_iterator_property_map(v_hsvalues.begin(), get(boost::vertex_index,g)), // heuristic_map
-               boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-               boost::make_iterator_property_map(v_gvalues.begin(), get(boost::vertex_index,g)), // gvalues_map
-               boost::make_iterator_property_map(v_rhsvalues.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+               boost::make_iterator_property_map(_incsp_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+               boost::make_iterator_property_map(_incsp_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
+               boost::make_iterator_property_map(_incsp_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
                1.0e-9, // goal_margin
                std::less<double>(), // compare
                boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
-               std::numeric_limits<double>::infinity(), 0.0));
+               std::numeric_limits<double>::infinity(), 0.0,
+               do_resume, 1.0 + _search_epsilon,
+               &_solution_suboptimality));
       }
       break;
    case SEARCH_TYPE_DIJKSTRAS:
@@ -1012,12 +1505,7 @@ bool ompl_lemur::LEMUR::do_lazysp_a(MyGraph & mg, std::vector<Edge> & epath)
       break;
    case SEARCH_TYPE_INCBI:
       {
-         std::vector<Vertex> v_startpreds(num_vertices(eig));
-         std::vector<double> v_startdist(num_vertices(eig));
-         std::vector<double> v_startdistlookahead(num_vertices(eig));
-         std::vector<Vertex> v_goalpreds(num_vertices(eig));
-         std::vector<double> v_goaldist(num_vertices(eig));
-         std::vector<double> v_goaldistlookahead(num_vertices(eig));
+         bool do_resume = incsp_prepare();
          
          switch (_search_incbi_balancer_type)
          {
@@ -1026,39 +1514,41 @@ bool ompl_lemur::LEMUR::do_lazysp_a(MyGraph & mg, std::vector<Edge> & epath)
                pr_bgl::make_lazysp_incsp_incbi(mg,
                   og[ov_singlestart].core_vertex,
                   og[ov_singlegoal].core_vertex,
-                  get(&EProps::w_lazy,g),
-                  boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-                  boost::make_iterator_property_map(v_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
-                  boost::make_iterator_property_map(v_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
-                  boost::make_iterator_property_map(v_goalpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-                  boost::make_iterator_property_map(v_goaldist.begin(), get(boost::vertex_index,g)), // gvalues_map
-                  boost::make_iterator_property_map(v_goaldistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+                  ompl_lemur::WLazyMap(*this),
+                  boost::make_iterator_property_map(_incsp_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+                  boost::make_iterator_property_map(_incsp_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
+                  boost::make_iterator_property_map(_incsp_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+                  boost::make_iterator_property_map(_incsp_goalpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+                  boost::make_iterator_property_map(_incsp_goaldist.begin(), get(boost::vertex_index,g)), // gvalues_map
+                  boost::make_iterator_property_map(_incsp_goaldistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
                   get(&EProps::index, g), eig.edge_vector_map,
                   1.0e-9, // goal_margin
                   std::less<double>(), // compare
                   boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
                   std::numeric_limits<double>::infinity(), 0.0,
                   pr_bgl::incbi_visitor_null<Graph>(),
-                  pr_bgl::incbi_balancer_distance<Vertex,double>(_search_incbi_balancer_goalfrac)));
+                  pr_bgl::incbi_balancer_distance<Vertex,double>(_search_incbi_balancer_goalfrac),
+                  do_resume, _search_incbi_parallel));
          case SEARCH_INCBI_BALANCER_TYPE_CARDINALITY:
             return do_lazysp_b(mg, epath,
                pr_bgl::make_lazysp_incsp_incbi(mg,
                   og[ov_singlestart].core_vertex,
                   og[ov_singlegoal].core_vertex,
-                  get(&EProps::w_lazy,g),
-                  boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-                  boost::make_iterator_property_map(v_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
-                  boost::make_iterator_property_map(v_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
-                  boost::make_iterator_property_map(v_goalpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-                  boost::make_iterator_property_map(v_goaldist.begin(), get(boost::vertex_index,g)), // gvalues_map
-                  boost::make_iterator_property_map(v_goaldistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+                  ompl_lemur::WLazyMap(*this),
+                  boost::make_iterator_property_map(_incsp_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+                  boost::make_iterator_property_map(_incsp_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
+                  boost::make_iterator_property_map(_incsp_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+                  boost::make_iterator_property_map(_incsp_goalpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+                  boost::make_iterator_property_map(_incsp_goaldist.begin(), get(boost::vertex_index,g)), // gvalues_map
+                  boost::make_iterator_property_map(_incsp_goaldistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
                   get(&EProps::index, g), eig.edge_vector_map,
                   1.0e-9, // goal_margin
                   std::less<double>(), // compare
                   boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
                   std::numeric_limits<double>::infinity(), 0.0,
                   pr_bgl::incbi_visitor_null<Graph>(),
-                  pr_bgl::incbi_balancer_cardinality<Vertex,double>(_search_incbi_balancer_goalfrac)));
+                  pr_bgl::incbi_balancer_cardinality<Vertex,double>(_search_incbi_balancer_goalfrac),
+                  do_resume, _search_incbi_parallel));
          default:
             throw std::runtime_error("corrupted _search_incbi_balancer_type!");
          }
@@ -1066,12 +1556,7 @@ bool ompl_lemur::LEMUR::do_lazysp_a(MyGraph & mg, std::vector<Edge> & epath)
       break;
    case SEARCH_TYPE_WINCBI:
       {
-         std::vector<Vertex> v_startpreds(num_vertices(eig));
-         std::vector<double> v_startdist(num_vertices(eig));
-         std::vector<double> v_startdistlookahead(num_vertices(eig));
-         std::vector<Vertex> v_goalpreds(num_vertices(eig));
-         std::vector<double> v_goaldist(num_vertices(eig));
-         std::vector<double> v_goaldistlookahead(num_vertices(eig));
+         bool do_resume = incsp_prepare();
          
          // compute averaged potential function
          std::vector<double> v_hvalues(num_vertices(eig));
@@ -1086,52 +1571,159 @@ bool ompl_lemur::LEMUR::do_lazysp_a(MyGraph & mg, std::vector<Edge> & epath)
                pr_bgl::make_lazysp_incsp_incbi(mg,
                   og[ov_singlestart].core_vertex,
                   og[ov_singlegoal].core_vertex,
-                  pr_bgl::make_waste_edge_map(g, get(&EProps::w_lazy,g),
+                  pr_bgl::make_waste_edge_map(g, ompl_lemur::WLazyMap(*this),
                      boost::make_iterator_property_map(v_hvalues.begin(), get(boost::vertex_index,g))),
-                  boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-                  boost::make_iterator_property_map(v_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
-                  boost::make_iterator_property_map(v_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
-                  boost::make_iterator_property_map(v_goalpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-                  boost::make_iterator_property_map(v_goaldist.begin(), get(boost::vertex_index,g)), // gvalues_map
-                  boost::make_iterator_property_map(v_goaldistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+                  boost::make_iterator_property_map(_incsp_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+                  boost::make_iterator_property_map(_incsp_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
+                  boost::make_iterator_property_map(_incsp_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+                  boost::make_iterator_property_map(_incsp_goalpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+                  boost::make_iterator_property_map(_incsp_goaldist.begin(), get(boost::vertex_index,g)), // gvalues_map
+                  boost::make_iterator_property_map(_incsp_goaldistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
                   get(&EProps::index, g), eig.edge_vector_map,
                   1.0e-9, // goal_margin
                   std::less<double>(), // compare
                   boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
                   std::numeric_limits<double>::infinity(), 0.0,
                   pr_bgl::incbi_visitor_null<Graph>(),
-                  pr_bgl::incbi_balancer_distance<Vertex,double>(_search_incbi_balancer_goalfrac)));
+                  pr_bgl::incbi_balancer_distance<Vertex,double>(_search_incbi_balancer_goalfrac),
+                  do_resume, _search_incbi_parallel));
          case SEARCH_INCBI_BALANCER_TYPE_CARDINALITY:
             return do_lazysp_b(mg, epath,
                pr_bgl::make_lazysp_incsp_incbi(mg,
                   og[ov_singlestart].core_vertex,
                   og[ov_singlegoal].core_vertex,
-                  pr_bgl::make_waste_edge_map(g, get(&EProps::w_lazy,g),
+                  pr_bgl::make_waste_edge_map(g, ompl_lemur::WLazyMap(*this),
                      boost::make_iterator_property_map(v_hvalues.begin(), get(boost::vertex_index,g))),
-                  boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-                  boost::make_iterator_property_map(v_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
-                  boost::make_iterator_property_map(v_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
-                  boost::make_iterator_property_map(v_goalpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
-                  boost::make_iterator_property_map(v_goaldist.begin(), get(boost::vertex_index,g)), // gvalues_map
-                  boost::make_iterator_property_map(v_goaldistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+                  boost::make_iterator_property_map(_incsp_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+                  boost::make_iterator_property_map(_incsp_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
+                  boost::make_iterator_property_map(_incsp_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+                  boost::make_iterator_property_map(_incsp_goalpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+                  boost::make_iterator_property_map(_incsp_goaldist.begin(), get(boost::vertex_index,g)), // gvalues_map
+                  boost::make_iterator_property_map(_incsp_goaldistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
                   get(&EProps::index, g), eig.edge_vector_map,
                   1.0e-9, // goal_margin
                   std::less<double>(), // compare
                   boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
                   std::numeric_limits<double>::infinity(), 0.0,
                   pr_bgl::incbi_visitor_null<Graph>(),
-                  pr_bgl::incbi_balancer_cardinality<Vertex,double>(_search_incbi_balancer_goalfrac)));
+                  pr_bgl::incbi_balancer_cardinality<Vertex,double>(_search_incbi_balancer_goalfrac),
+                  do_resume, _search_incbi_parallel));
          default:
             throw std::runtime_error("corrupted _search_incbi_balancer_type!");
          }
       }
       break;
+   case SEARCH_TYPE_CCH:
+      {
+         // contraction hierarchy over this batch's topology
+         return do_lazysp_b(mg, epath,
+            pr_bgl::make_lazysp_incsp_cch(mg,
+               ompl_lemur::WLazyMap(*this),
+               std::less<double>(), // compare
+               boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
+               std::numeric_limits<double>::infinity(), 0.0));
+      }
+      break;
    }
    OMPL_ERROR("switch error.");
    return false;
 }
 
 
+void ompl_lemur::LEMUR::batch_prefix_apply(unsigned int num_batches)
+{
+   size_t num_v = num_vertices(g);
+   _batch_prefix_degrees.resize(num_v);
+   for (size_t vidx=0; vidx<num_v; vidx++)
+   {
+      Vertex v = vertex(vidx, g);
+      _batch_prefix_degrees[vidx] = stored_edges_batch_prefix(
+         g.out_edge_list(v), stored_edge_batch_less(g,v), num_batches);
+   }
+}
+
+bool ompl_lemur::LEMUR::incsp_prepare()
+{
+   size_t num_overlay = overlay_manager.applied_vertices.size();
+   size_t num_core = num_vertices(g) - num_overlay;
+   
+   // within a solve(), only core vertices are added (new batches)
+   size_t core_from = _incsp_num_core_vertices;
+   size_t overlay_from = _incsp_startdist.size() - core_from;
+   if (_incsp_resumable && (num_core < core_from || num_overlay < overlay_from))
+      _incsp_resumable = false;
+   
+   if (!_incsp_resumable)
+   {
+      // nothing left over from an earlier search survives
+      // (the searches reset only the values they read on a fresh start)
+      _incsp_startpreds.resize(num_vertices(g));
+      _incsp_startdist.resize(num_vertices(g));
+      _incsp_startdistlookahead.resize(num_vertices(g));
+      _incsp_goalpreds.resize(num_vertices(g));
+      _incsp_goaldist.resize(num_vertices(g));
+      _incsp_goaldistlookahead.resize(num_vertices(g));
+      for (size_t vidx=0; vidx<num_vertices(g); vidx++)
+         incsp_reset_vertex(vidx);
+      _incsp_num_core_vertices = num_core;
+      _incsp_resumable = true;
+      return false;
+   }
+   
+   // move values for overlay vertices past the new core vertices
+   // (iterate backwards, since the ranges may overlap)
+   size_t shift = num_core - core_from;
+   _incsp_startpreds.resize(num_vertices(g));
+   _incsp_startdist.resize(num_vertices(g));
+   _incsp_startdistlookahead.resize(num_vertices(g));
+   _incsp_goalpreds.resize(num_vertices(g));
+   _incsp_goaldist.resize(num_vertices(g));
+   _incsp_goaldistlookahead.resize(num_vertices(g));
+   for (size_t ui=overlay_from; shift && ui>0; ui--)
+   {
+      size_t vidx_old = core_from + ui - 1;
+      size_t vidx_new = num_core + ui - 1;
+      _incsp_startpreds[vidx_new] = _incsp_startpreds[vidx_old];
+      _incsp_startdist[vidx_new] = _incsp_startdist[vidx_old];
+      _incsp_startdistlookahead[vidx_new] = _incsp_startdistlookahead[vidx_old];
+      _incsp_goalpreds[vidx_new] = _incsp_goalpreds[vidx_old];
+      _incsp_goaldist[vidx_new] = _incsp_goaldist[vidx_old];
+      _incsp_goaldistlookahead[vidx_new] = _incsp_goaldistlookahead[vidx_old];
+   }
+   
+   // predecessors which are overlay vertices have moved too
+   for (size_t vidx=0; shift && vidx<num_vertices(g); vidx++)
+   {
+      if (core_from <= vidx && vidx < num_core)
+         continue;
+      if (core_from <= _incsp_startpreds[vidx])
+         _incsp_startpreds[vidx] += shift;
+      if (core_from <= _incsp_goalpreds[vidx])
+         _incsp_goalpreds[vidx] += shift;
+   }
+   
+   // new core and overlay vertices have not been reached yet
+   for (size_t vidx=core_from; vidx<num_vertices(g); vidx++)
+   {
+      if (num_core <= vidx && vidx < num_core + overlay_from)
+         continue;
+      incsp_reset_vertex(vidx);
+   }
+   
+   _incsp_num_core_vertices = num_core;
+   return true;
+}
+
+void ompl_lemur::LEMUR::incsp_reset_vertex(size_t vidx)
+{
+   _incsp_startpreds[vidx] = vertex(vidx,g);
+   _incsp_startdist[vidx] = std::numeric_limits<double>::infinity();
+   _incsp_startdistlookahead[vidx] = std::numeric_limits<double>::infinity();
+   _incsp_goalpreds[vidx] = vertex(vidx,g);
+   _incsp_goaldist[vidx] = std::numeric_limits<double>::infinity();
+   _incsp_goaldistlookahead[vidx] = std::numeric_limits<double>::infinity();
+}
+
 ompl::base::PlannerStatus
 ompl_lemur::LEMUR::solve(
    const ompl::base::PlannerTerminationCondition & ptc)
@@ -1154,24 +1746,48 @@ ompl_lemur::LEMUR::solve(
       _dur_selector_notify = boost::chrono::high_resolution_clock::duration();
       time_total_begin = boost::chrono::high_resolution_clock::now();
    }
+   _num_speculative_checks_useful = 0;
+   _num_w_lazy_updates = 0;
+   _num_w_lazy_recalcs = 0;
+   _num_w_lazy_recalcs_full = 0;
+   _num_speculative_checks_wasted = 0;
+   _num_search_expansions = 0;
    
-   if (_utility_checker->hasChanged())
+   bool checker_changed = _utility_checker->hasChanged();
+   tag_table_refresh(checker_changed);
+   if (checker_changed)
    {
-      overlay_apply();
+      // memoized root tags and failprob evidence may no longer hold
+      _root_tag_memo_epoch++;
+      _failprob_active = false;
       
       // route target si to family effort model
       // this will re-run reverse dijkstra's on the family graph
       //family_effort_model.set_target(si_new);
       
-      // recalculate wlazy if necessary
-      // we probably always need to recalc wlazy for overlay states!
-      EdgeIter ei, ei_end;
-      for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei)
-         calculate_w_lazy(*ei);
+      // every edge's w_lazy (and partial progress,
+      // which was relative to the old target) is now stale
+      _w_lazy_epoch++;
+      _landmarks_valid = false;
       
-      overlay_unapply();
+      // root edges are recalculated when the overlay is next applied
+      OverEdgeIter oei, oei_end;
+      for (boost::tie(oei,oei_end)=edges(og); oei!=oei_end; ++oei)
+         og[*oei].num_edge_states_passed = 0;
+      
+      // the stale core edges are recalculated when they are next used
+      // (see w_lazy_get), unless that would race with other threads
+      if (!_defer_w_lazy || !w_lazy_deferrable())
+         calculate_w_lazy_stale();
    }
    
+   // likewise, dirty edges left from an earlier solve
+   if (_w_lazy_dirty_any && !w_lazy_deferrable())
+      calculate_w_lazy_stale();
+   
+   // roots from this query may have been checked by earlier queries
+   root_tag_memo_load();
+   
    // ok, do some sweet sweet lazy search!
    
    if (_solve_all)
@@ -1243,6 +1859,14 @@ ompl_lemur::LEMUR::solve(
    }
    
    unsigned int num_batches = 0;
+   
+   // incremental search state is only carried across batches,
+   // not across calls to solve()
+   _incsp_resumable = false;
+
+   // lazysp checks ptc before each iteration, and the inner search
+   // polls it every 64 vertex expansions
+   _lazysp_cancel = pr_bgl::cancel_poll(boost::cref(ptc), 64);
 
    // run batches of lazy search
    ompl::base::PlannerStatus ret = ompl::base::PlannerStatus::TIMEOUT;
@@ -1283,32 +1907,7 @@ ompl_lemur::LEMUR::solve(
             // note, this will solve only core vertices
             // even though we're applied
             // because we're guaranteed to have no roots!
-            
-            OMPL_INFORM("Evaluating all %lu vertices and %lu edges...",
-               num_vertices(eig), num_edges(eig));
-
-            // evaluate all vertices first
-            OMPL_INFORM("Evaluating vertices ...");
-            VertexIter vi, vi_end;
-            for (boost::tie(vi,vi_end)=vertices(g); vi!=vi_end; ++vi)
-            {
-               if (!g[*vi].state)
-                  continue;
-               while (!_utility_checker->isKnown(g[*vi].tag))
-                  _utility_checker->isValidPartialEval(g[*vi].tag, g[*vi].state);
-            }
-            
-            OMPL_INFORM("Evaluating edges ...");
-            unsigned int count = 0;
-            EdgeIter ei, ei_end;
-            for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei)
-            {
-               if (count % 100 == 0)
-                  OMPL_INFORM("Calculating edge [%u] of %lu ...", count, num_edges(eig));
-               while (!isevaledmap_get(*ei))
-                  wmap_get(*ei);
-               count++;
-            }
+            solve_all_evaluate();
          }
          else
          {
@@ -1323,9 +1922,10 @@ ompl_lemur::LEMUR::solve(
             
             if (num_batches < _roadmap->num_batches_generated)
             {
-               filter_num_batches filter(get(&EProps::batch,g), num_batches);
-               boost::filtered_graph<Graph,filter_num_batches> fg(g, filter);
-               do_return_solution = do_lazysp_a(fg, epath);
+               batch_prefix_apply(num_batches);
+               pr_bgl::prefix_graph<Graph,BatchPrefixMap> pg(g,
+                  BatchPrefixMap(_batch_prefix_degrees.begin(), get(boost::vertex_index,g)));
+               do_return_solution = do_lazysp_a(pg, epath);
             }
             else
             {
@@ -1348,6 +1948,21 @@ ompl_lemur::LEMUR::solve(
                path->append(g[target(*it,g)].state);
             
             pdef_->addSolutionPath(ompl::base::PathPtr(path));
+            
+            // weighted inner searches bound the lazy path length
+            // (the incremental searches store the bound they achieved)
+            switch (_search_type)
+            {
+            case SEARCH_TYPE_ASTAR:
+               _solution_suboptimality = 1.0 + _search_epsilon;
+               break;
+            case SEARCH_TYPE_LPASTAR:
+            case SEARCH_TYPE_RLPASTAR:
+               break;
+            default:
+               _solution_suboptimality = 1.0;
+            }
+            OMPL_INFORM("Solution is within %f of the shortest path.", _solution_suboptimality);
          }
          
          overlay_unapply();
@@ -1357,6 +1972,11 @@ ompl_lemur::LEMUR::solve(
             ret = ompl::base::PlannerStatus::EXACT_SOLUTION;
             break;
          }
+         
+         // lazysp stopped part way; evaluations so far are kept,
+         // and the incremental search state remains resumable
+         if (_lazysp_cancel.cancelled())
+            break;
       }
       
       // did we run out of batches?
@@ -1392,6 +2012,7 @@ ompl_lemur::LEMUR::solve(
          // add a batch!
          //nn.sync();
          _roadmap->generate();
+         _landmarks_valid = false;
          
          // timing
          boost::chrono::high_resolution_clock::time_point time_roadmapinit_begin;
@@ -1419,6 +2040,8 @@ ompl_lemur::LEMUR::solve(
             //   g[e].edge_states);
             //g[e].edge_tags.resize(g[e].edge_states.size(), 0);
             g[e].edge_tag = 0;
+            g[e].num_edge_states_passed = 0;
+            g[e].w_lazy_epoch = _w_lazy_epoch;
          }
          
          OMPL_INFORM("Loading from tag cache ...");
@@ -1434,6 +2057,8 @@ ompl_lemur::LEMUR::solve(
          }
          
          // calculate w_lazy for these new edges
+         // (the loaded tags may be new to the checker)
+         tag_table_refresh(false);
          for (size_t eidx=e_from; eidx<e_to; eidx++)
          {
             Edge e = get(eig.edge_vector_map,eidx);
@@ -1489,14 +2114,22 @@ ompl_lemur::LEMUR::solve(
                //og[oe].edge_tags.resize(og[oe].edge_states.size(), 0);
                //og[e].tag = 0;
                og[oe].edge_tag = 0;
+               og[oe].num_edge_states_passed = 0;
             }
          }
          
+         // as may the new root edges
+         root_tag_memo_load();
+         
          if (_do_timing)
             _dur_roadmapinit += boost::chrono::high_resolution_clock::now() - time_roadmapinit_begin;
       }
    }
    
+   // drop the reference to ptc
+   _num_search_expansions = _lazysp_cancel.num_polls();
+   _lazysp_cancel = pr_bgl::cancel_poll();
+   
    if (_do_timing)
       _dur_total = boost::chrono::high_resolution_clock::now() - time_total_begin;
 
@@ -1527,6 +2160,120 @@ void ompl_lemur::LEMUR::dump_graph(std::ostream & os_graph)
 }
 
 // saves only core vertices
+void ompl_lemur::LEMUR::solve_all_evaluate()
+{
+   OMPL_INFORM("Evaluating all %lu vertices and %lu edges...",
+      num_vertices(eig), num_edges(eig));
+   
+   // each batch's vertex and edge index ranges are split evenly
+   // into contiguous shards, so the assignment is deterministic
+   std::vector< std::pair<size_t,size_t> > v_ranges;
+   std::vector< std::pair<size_t,size_t> > e_ranges;
+   for (size_t ibatch=0; ibatch<_subgraph_sizes.size(); ibatch++)
+   {
+      std::pair<size_t,size_t> from(0,0);
+      if (ibatch)
+         from = _subgraph_sizes[ibatch-1];
+      std::pair<size_t,size_t> to = _subgraph_sizes[ibatch];
+      v_ranges.push_back(std::make_pair(
+         from.first + (to.first-from.first)*_solve_all_shard/_solve_all_num_shards,
+         from.first + (to.first-from.first)*(_solve_all_shard+1)/_solve_all_num_shards));
+      e_ranges.push_back(std::make_pair(
+         from.second + (to.second-from.second)*_solve_all_shard/_solve_all_num_shards,
+         from.second + (to.second-from.second)*(_solve_all_shard+1)/_solve_all_num_shards));
+   }
+   if (_solve_all_num_shards > 1)
+      OMPL_INFORM("Evaluating shard %u of %u ...", _solve_all_shard, _solve_all_num_shards);
+   
+   // evaluate all vertices first
+   // (elements already known, e.g. from a checkpoint, are skipped)
+   std::vector<Vertex> vs_todo;
+   for (size_t ir=0; ir<v_ranges.size(); ir++)
+   for (size_t vidx=v_ranges[ir].first; vidx<v_ranges[ir].second; vidx++)
+   {
+      Vertex v = vertex(vidx, g);
+      if (!g[v].state)
+         continue;
+      if (!tag_known(g[v].tag))
+         vs_todo.push_back(v);
+   }
+   OMPL_INFORM("Evaluating %lu unknown vertices ...", vs_todo.size());
+   if (vs_todo.size())
+   {
+      boost::mutex mutex;
+      size_t next = 0;
+      vertex_check_worker worker(*_utility_checker, g, vs_todo, mutex, next);
+      unsigned int num_threads = std::min<size_t>(_num_eval_threads, vs_todo.size());
+      boost::thread_group threads;
+      for (unsigned int ti=1; ti<num_threads; ti++)
+         threads.create_thread(worker);
+      worker();
+      threads.join_all();
+      for (size_t ui=0; ui<vs_todo.size(); ui++)
+         vertex_tag_changed(vs_todo[ui], true);
+      if (_solve_all_checkpoint)
+         saveTagCache();
+   }
+   
+   // then all edges, in chunks
+   // (since all endpoints are known, each edge's checks,
+   // and so its tag, do not depend on the other edges;
+   // endpoints outside this shard are checked as needed)
+   std::vector<Edge> es_all;
+   for (size_t ir=0; ir<e_ranges.size(); ir++)
+   for (size_t eidx=e_ranges[ir].first; eidx<e_ranges[ir].second; eidx++)
+      es_all.push_back(get(eig.edge_vector_map, eidx));
+   OMPL_INFORM("Evaluating edges ...");
+   const size_t chunk_size = 1000;
+   size_t count_since_checkpoint = 0;
+   std::vector<Edge> es_todo;
+   std::vector<Edge> es_changed;
+   for (size_t chunk_from=0; chunk_from<es_all.size(); chunk_from+=chunk_size)
+   {
+      size_t chunk_to = std::min(chunk_from+chunk_size, es_all.size());
+      OMPL_INFORM("Calculating edges [%lu,%lu) of %lu ...", chunk_from, chunk_to, es_all.size());
+      es_todo.clear();
+      for (size_t ui=chunk_from; ui<chunk_to; ui++)
+         if (!isevaledmap_get(es_all[ui]))
+            es_todo.push_back(es_all[ui]);
+      count_since_checkpoint += es_todo.size();
+      
+      // as in wmap_get(), repeated until each edge is evaluated
+      while (es_todo.size())
+      {
+         _eval_interior_edges.clear();
+         for (unsigned int ui=0; ui<es_todo.size(); ui++)
+         {
+            if (!wmap_check_endpoints(es_todo[ui]))
+               continue;
+            if (g[es_todo[ui]].num_edge_states != g[es_todo[ui]].edge_states.size())
+               edge_init_states(es_todo[ui]);
+            _eval_interior_edges.push_back(es_todo[ui]);
+         }
+         wmap_check_interiors(_eval_interior_edges);
+         es_changed.clear();
+         size_t num_todo = 0;
+         for (unsigned int ui=0; ui<es_todo.size(); ui++)
+         {
+            wmap_update(es_todo[ui], es_changed);
+            if (!isevaledmap_get(es_todo[ui]))
+               es_todo[num_todo++] = es_todo[ui];
+         }
+         es_todo.resize(num_todo);
+      }
+      
+      if (_solve_all_checkpoint && _solve_all_checkpoint <= count_since_checkpoint)
+      {
+         OMPL_INFORM("Saving checkpoint ...");
+         saveTagCache();
+         count_since_checkpoint = 0;
+      }
+   }
+   
+   if (_solve_all_checkpoint && count_since_checkpoint)
+      saveTagCache();
+}
+
 void ompl_lemur::LEMUR::saveTagCache()
 {
    if (!_tag_cache)
@@ -1553,7 +2300,12 @@ void ompl_lemur::LEMUR::saveTagCache()
    _tag_cache->saveEnd();
 }
 
-double ompl_lemur::LEMUR::getDurTotal()
+double ompl_lemur::LEMUR::getSolutionSuboptimality()
+{
+   return _solution_suboptimality;
+}
+
+double ompl_lemur::LEMUR::getDurTotal()
 {
    return boost::chrono::duration<double>(_dur_total).count();
 }
@@ -1598,6 +2350,103 @@ double ompl_lemur::LEMUR::getDurSelectorNotify()
    return boost::chrono::duration<double>(_dur_selector_notify).count();
 }
 
+size_t ompl_lemur::LEMUR::getNumSpeculativeChecksUseful()
+{
+   return _num_speculative_checks_useful;
+}
+
+size_t ompl_lemur::LEMUR::getNumSpeculativeChecksWasted()
+{
+   return _num_speculative_checks_wasted;
+}
+
+size_t ompl_lemur::LEMUR::getNumWLazyUpdates()
+{
+   return _num_w_lazy_updates;
+}
+
+size_t ompl_lemur::LEMUR::getNumWLazyRecalcs()
+{
+   return _num_w_lazy_recalcs;
+}
+
+size_t ompl_lemur::LEMUR::getNumWLazyRecalcsFull()
+{
+   return _num_w_lazy_recalcs_full;
+}
+
+size_t ompl_lemur::LEMUR::getNumSearchExpansions()
+{
+   return _num_search_expansions;
+}
+
+void ompl_lemur::LEMUR::root_tag_memo_save()
+{
+   if (!_root_tag_memo)
+      return;
+   _root_tag_memo->validate(_utility_checker.get(), _root_tag_memo_epoch);
+   
+   // non-anchor root vertices
+   OverVertexIter ovi, ovi_end;
+   for (boost::tie(ovi,ovi_end)=vertices(og); ovi!=ovi_end; ++ovi)
+   {
+      if (!og[*ovi].state || og[*ovi].core_vertex != boost::graph_traits<Graph>::null_vertex())
+         continue;
+      if (!og[*ovi].tag)
+         continue;
+      _root_tag_memo->set_vertex(_root_tag_memo->key(space.get(), og[*ovi].state), og[*ovi].tag);
+   }
+   
+   // root edges (without partial progress)
+   OverEdgeIter oei, oei_end;
+   for (boost::tie(oei,oei_end)=edges(og); oei!=oei_end; ++oei)
+   {
+      OverVertex ova = source(*oei,og);
+      OverVertex ovb = target(*oei,og);
+      if (!og[ova].state || !og[ovb].state)
+         continue;
+      if (!og[*oei].edge_tag || og[*oei].num_edge_states_passed)
+         continue;
+      _root_tag_memo->set_edge(
+         _root_tag_memo->key(space.get(), og[ova].state),
+         _root_tag_memo->key(space.get(), og[ovb].state),
+         og[*oei].edge_tag);
+   }
+}
+
+void ompl_lemur::LEMUR::root_tag_memo_load()
+{
+   if (!_root_tag_memo)
+      return;
+   _root_tag_memo->validate(_utility_checker.get(), _root_tag_memo_epoch);
+   if (!_root_tag_memo->size())
+      return;
+   
+   OverVertexIter ovi, ovi_end;
+   for (boost::tie(ovi,ovi_end)=vertices(og); ovi!=ovi_end; ++ovi)
+   {
+      if (!og[*ovi].state || og[*ovi].core_vertex != boost::graph_traits<Graph>::null_vertex())
+         continue;
+      if (og[*ovi].tag)
+         continue;
+      og[*ovi].tag = _root_tag_memo->get_vertex(_root_tag_memo->key(space.get(), og[*ovi].state));
+   }
+   
+   OverEdgeIter oei, oei_end;
+   for (boost::tie(oei,oei_end)=edges(og); oei!=oei_end; ++oei)
+   {
+      OverVertex ova = source(*oei,og);
+      OverVertex ovb = target(*oei,og);
+      if (!og[ova].state || !og[ovb].state)
+         continue;
+      if (og[*oei].edge_tag || og[*oei].num_edge_states_passed)
+         continue;
+      og[*oei].edge_tag = _root_tag_memo->get_edge(
+         _root_tag_memo->key(space.get(), og[ova].state),
+         _root_tag_memo->key(space.get(), og[ovb].state));
+   }
+}
+
 void ompl_lemur::LEMUR::overlay_apply()
 {
    if (overlay_manager.is_applied)
@@ -1614,6 +2463,13 @@ void ompl_lemur::LEMUR::overlay_apply()
       g[vcore].batch = og[vover].batch;
       g[vcore].is_shadow = og[vover].is_shadow;
       g[vcore].tag = og[vover].tag;
+      // the root's edges are recalculated below with this tag
+      size_t vidx = get(get(boost::vertex_index,g), vcore);
+      if (vidx < _v_tag_changed.size())
+         _v_tag_changed[vidx] = 0;
+      // and its state is noted as evidence by failprob_extend()
+      if (vidx < _failprob_vertex_noted.size())
+         _failprob_vertex_noted[vidx] = false;
    }
    
    for (unsigned int ui=0; ui<overlay_manager.applied_edges.size(); ui++)
@@ -1629,8 +2485,16 @@ void ompl_lemur::LEMUR::overlay_apply()
       g[ecore].edge_tags = og[eover].edge_tags;
 #endif
       g[ecore].edge_tag = og[eover].edge_tag;
+      g[ecore].num_edge_states_passed = og[eover].num_edge_states_passed;
       //g[ecore].tag = og[eover].tag;
+      g[ecore].w_lazy_epoch = _w_lazy_epoch;
       calculate_w_lazy(ecore);
+      size_t eidx = g[ecore].index;
+      if (eidx < _failprob_edge_noted.size())
+      {
+         _failprob_edge_noted[eidx] = false;
+         _failprob_edge_num_seen[eidx] = 0;
+      }
    }
 }
 
@@ -1663,6 +2527,7 @@ void ompl_lemur::LEMUR::overlay_unapply()
       og[eover].edge_tags = g[ecore].edge_tags;
 #endif
       og[eover].edge_tag = g[ecore].edge_tag;
+      og[eover].num_edge_states_passed = g[ecore].num_edge_states_passed;
       //og[eover].tag = g[ecore].tag;
    }
    
@@ -1702,27 +2567,44 @@ void ompl_lemur::LEMUR::edge_init_states(const Edge & e)
    //g[e].edge_tags.resize(n, 0);
 }
 
+void ompl_lemur::LEMUR::tag_table_refresh(bool changed)
+{
+   if (changed)
+   {
+      _tag_table.known.clear();
+      _tag_table.known_invalid.clear();
+      _tag_table.cost.clear();
+   }
+   _utility_checker->updateTagTable(_tag_table);
+}
+
 void ompl_lemur::LEMUR::calculate_w_lazy(const Edge & e)
 {
+   if (g[e].w_lazy_epoch != _w_lazy_epoch)
+   {
+      g[e].num_edge_states_passed = 0;
+      g[e].w_lazy_epoch = _w_lazy_epoch;
+   }
+   g[e].w_lazy_dirty = false;
    Vertex va = source(e,g);
    Vertex vb = target(e,g);
    // special case for singleroot edges
    if (!g[va].state)
    {
       double singleroot_cost = (va == og[ov_singlestart].core_vertex) ? _singlestart_cost : _singlegoal_cost;
-      if (_utility_checker->isKnownInvalid(g[vb].tag))
+      if (tag_known_invalid(g[vb].tag))
          g[e].w_lazy = std::numeric_limits<double>::infinity();
       else
-         g[e].w_lazy = singleroot_cost + 0.5 * _coeff_checkcost * _utility_checker->getPartialEvalCost(g[vb].tag, g[vb].state);
+         g[e].w_lazy = singleroot_cost + 0.5 * _coeff_checkcost * tag_cost(g[vb].tag, g[vb].state);
       return;
    }
    if (!g[vb].state)
    {
       double singleroot_cost = (vb == og[ov_singlestart].core_vertex) ? _singlestart_cost : _singlegoal_cost;
-      if (_utility_checker->isKnownInvalid(g[va].tag))
+      if (tag_known_invalid(g[va].tag))
          g[e].w_lazy = std::numeric_limits<double>::infinity();
       else
-         g[e].w_lazy = singleroot_cost + 0.5 * _coeff_checkcost * _utility_checker->getPartialEvalCost(g[va].tag, g[va].state);
+         g[e].w_lazy = singleroot_cost + 0.5 * _coeff_checkcost * tag_cost(g[va].tag, g[va].state);
       return;
    }
    // ok, its a non-singleroot edge
@@ -1740,9 +2622,9 @@ void ompl_lemur::LEMUR::calculate_w_lazy(const Edge & e)
       return;
    }
 #endif
-   if (_utility_checker->isKnownInvalid(g[e].edge_tag)
-      || _utility_checker->isKnownInvalid(g[va].tag)
-      || _utility_checker->isKnownInvalid(g[vb].tag))
+   if (tag_known_invalid(g[e].edge_tag)
+      || tag_known_invalid(g[va].tag)
+      || tag_known_invalid(g[vb].tag))
    {
       g[e].w_lazy = std::numeric_limits<double>::infinity();
       return;
@@ -1752,8 +2634,8 @@ void ompl_lemur::LEMUR::calculate_w_lazy(const Edge & e)
    g[e].w_lazy += _coeff_distance * g[e].distance;
    g[e].w_lazy += _coeff_batch * g[e].distance * g[e].batch;
    // half bounary vertices
-   g[e].w_lazy += 0.5 * _coeff_checkcost * _utility_checker->getPartialEvalCost(g[va].tag, g[va].state);
-   g[e].w_lazy += 0.5 * _coeff_checkcost * _utility_checker->getPartialEvalCost(g[vb].tag, g[vb].state);
+   g[e].w_lazy += 0.5 * _coeff_checkcost * tag_cost(g[va].tag, g[va].state);
+   g[e].w_lazy += 0.5 * _coeff_checkcost * tag_cost(g[vb].tag, g[vb].state);
 #if 0
    // interior states
    if (g[e].edge_tags.size() == 0)
@@ -1767,121 +2649,583 @@ void ompl_lemur::LEMUR::calculate_w_lazy(const Edge & e)
          g[e].w_lazy += _coeff_checkcost * _utility_checker->getPartialEvalCost(g[e].edge_tags[ui], g[e].edge_states[ui]);
    }
 #endif
-   g[e].w_lazy += _coeff_checkcost * g[e].num_edge_states * _utility_checker->getPartialEvalCost(g[e].edge_tag,0);
+   g[e].w_lazy += _coeff_checkcost * (g[e].num_edge_states - g[e].num_edge_states_passed)
+      * tag_cost(g[e].edge_tag,0);
+}
+
+void ompl_lemur::LEMUR::calculate_w_lazy_stale()
+{
+   _w_lazy_dirty_any = false;
+   std::vector<Edge> es;
+   es.reserve(num_edges(g));
+   EdgeIter ei, ei_end;
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei)
+      es.push_back(*ei);
+   
+   if (_num_eval_threads <= 1 || es.size() < 2)
+   {
+      for (unsigned int ui=0; ui<es.size(); ui++)
+         w_lazy_get(es[ui]);
+      return;
+   }
+   
+   // each edge's w_lazy depends only on its own properties
+   // and the (unchanging) tags of its endpoints,
+   // and the checker's tables are locked internally
+   boost::mutex mutex;
+   size_t next = 0;
+   w_lazy_worker worker(*this, es, mutex, next);
+   boost::thread_group threads;
+   for (unsigned int ti=0; ti<_num_eval_threads; ti++)
+      threads.create_thread(worker);
+   threads.join_all();
+}
+
+bool ompl_lemur::LEMUR::w_lazy_deferrable()
+{
+   // the parallel bidirectional search reads w_lazy from two threads,
+   // and speculative checks change the tags it is calculated from
+   return !_search_incbi_parallel && !_num_speculative_threads;
+}
+
+double ompl_lemur::LEMUR::w_lazy_lower_bound(const Edge & e)
+{
+   Vertex va = source(e,g);
+   Vertex vb = target(e,g);
+   // special case for singleroot edges
+   if (!g[va].state)
+      return (va == og[ov_singlestart].core_vertex) ? _singlestart_cost : _singlegoal_cost;
+   if (!g[vb].state)
+      return (vb == og[ov_singlestart].core_vertex) ? _singlestart_cost : _singlegoal_cost;
+   return _coeff_distance * g[e].distance
+      + _coeff_batch * g[e].distance * g[e].batch;
 }
 
 bool ompl_lemur::LEMUR::isevaledmap_get(const Edge & e)
 {
    // this directly calls the family effort model (distance not needed!)
    Vertex va = source(e, g);
-   if (g[va].state && !_utility_checker->isKnown(g[va].tag))
+   if (g[va].state && !tag_known(g[va].tag))
       return false;
    Vertex vb = target(e, g);
-   if (g[vb].state && !_utility_checker->isKnown(g[vb].tag))
+   if (g[vb].state && !tag_known(g[vb].tag))
       return false;
 #if 0
    for (unsigned int ui=0; ui<g[e].edge_tags.size(); ui++)
       if (!_utility_checker->isKnown(g[e].edge_tags[ui]))
          return false;
 #endif
-   if (g[e].num_edge_states && !_utility_checker->isKnown(g[e].edge_tag))
+   if (g[e].num_edge_states && !tag_known(g[e].edge_tag))
       return false;
    return true;
 }
 
 std::pair<double, std::vector<ompl_lemur::LEMUR::Edge> > ompl_lemur::LEMUR::wmap_get(const Edge & e)
 {
-   // check all points!
-   Vertex va = source(e, g);
-   Vertex vb = target(e, g);
+   std::vector<Edge> es_changed;
+   double w_lazy = wmap_get(e, es_changed);
+   return std::make_pair(w_lazy, es_changed);
+}
+
+double ompl_lemur::LEMUR::wmap_get(const Edge & e, std::vector<Edge> & es_changed)
+{
+   if (wmap_check_endpoints(e))
+   {
+      // make sure we've generated internal edges
+      if (g[e].num_edge_states != g[e].edge_states.size())
+         edge_init_states(e);
+      wmap_check_interior(e, _interior_tags);
+   }
+   return wmap_update(e, es_changed);
+}
+
+void ompl_lemur::LEMUR::wmap_get_batch(const std::vector<Edge> & es,
+   std::vector<double> & weights, std::vector<Edge> & es_changed,
+   std::vector<size_t> & changed_ends)
+{
+   if (_eval_type == EVAL_TYPE_PATH_BISECT)
+   {
+      wmap_get_path_bisect(es, weights, es_changed, changed_ends);
+      return;
+   }
    
-   // check endpoints first
-   do
+   if (_num_eval_threads < 2 || es.size() < 2)
    {
-      if (g[va].state && !_utility_checker->isKnown(g[va].tag))
+      for (unsigned int ui=0; ui<es.size(); ui++)
       {
-         bool success = _utility_checker->isValidPartialEval(g[va].tag, g[va].state);
-         if (!success)
-            break;
+         weights.push_back(wmap_get(es[ui], es_changed));
+         changed_ends.push_back(es_changed.size());
+      }
+      return;
+   }
+   
+   // endpoints may be shared between edges, so they are checked
+   // serially in order (as wmap_get() would);
+   // the interior states are also generated here,
+   // since the bisection permutation cache is shared
+   _eval_interior_edges.clear();
+   for (unsigned int ui=0; ui<es.size(); ui++)
+   {
+      const Edge & e = es[ui];
+      if (!wmap_check_endpoints(e))
+         continue;
+      if (g[e].num_edge_states != g[e].edge_states.size())
+         edge_init_states(e);
+      _eval_interior_edges.push_back(e);
+   }
+   
+   // check the interiors concurrently
+   wmap_check_interiors(_eval_interior_edges);
+   
+   // recalculate the weights serially in order
+   for (unsigned int ui=0; ui<es.size(); ui++)
+   {
+      weights.push_back(wmap_update(es[ui], es_changed));
+      changed_ends.push_back(es_changed.size());
+   }
+}
+
+void ompl_lemur::LEMUR::wmap_check_interiors(const std::vector<Edge> & es)
+{
+   if (!es.size())
+      return;
+   boost::mutex mutex;
+   size_t next = 0;
+   interior_check_worker worker(*this, es, mutex, next);
+   unsigned int num_threads = std::min<size_t>(_num_eval_threads, es.size());
+   boost::thread_group threads;
+   for (unsigned int ti=1; ti<num_threads; ti++)
+      threads.create_thread(worker);
+   worker();
+   threads.join_all();
+}
+
+void ompl_lemur::LEMUR::wmap_get_path_bisect(const std::vector<Edge> & es,
+   std::vector<double> & weights, std::vector<Edge> & es_changed,
+   std::vector<size_t> & changed_ends)
+{
+   // the endpoints are the coarsest points, so they go first
+   _path_bisect_checks.assign(es.size(), 0);
+   bool found_invalid = false;
+   for (unsigned int ui=0; ui<es.size(); ui++)
+   {
+      if (!wmap_check_endpoints(es[ui], &_path_bisect_checks[ui]))
+      {
+         found_invalid = true;
+         break;
       }
-      if (g[vb].state && !_utility_checker->isKnown(g[vb].tag))
+   }
+   
+   // look up each unknown interior's bisection order once
+   _path_bisect_perms.clear();
+   for (unsigned int ui=0; !found_invalid && ui<es.size(); ui++)
+   {
+      const Edge & e = es[ui];
+      if (!g[e].num_edge_states || tag_known(g[e].edge_tag))
       {
-         bool success = _utility_checker->isValidPartialEval(g[vb].tag, g[vb].state);
-         if (!success)
-            break;
+         _path_bisect_perms.push_back(0);
+         continue;
+      }
+      if (g[e].num_edge_states != g[e].edge_states.size())
+         edge_init_states(e);
+      _path_bisect_perms.push_back(&bisect_perm.get(g[e].num_edge_states));
+   }
+   
+   // then each step checks the next interior state (in bisection order)
+   // of the edge whose next state is farthest from that edge's checked
+   // states (ties to the earliest edge), until one fails
+   while (!found_invalid)
+   {
+      size_t ui_best = es.size();
+      int gap_best = 0;
+      for (unsigned int ui=0; ui<es.size(); ui++)
+      {
+         const Edge & e = es[ui];
+         if (!_path_bisect_perms[ui])
+            continue;
+         int gap = (*_path_bisect_perms[ui])[g[e].num_edge_states_passed].second;
+         if (gap_best < gap)
+         {
+            gap_best = gap;
+            ui_best = ui;
+         }
       }
+      if (ui_best == es.size())
+         break;
+      
+      const Edge & e = es[ui_best];
+      size_t tag = g[e].edge_tag;
+      _path_bisect_checks[ui_best]++;
+      if (_utility_checker->isValidPartialEval(tag, g[e].edge_states[g[e].num_edge_states_passed]))
+      {
+         g[e].num_edge_states_passed++;
+         if (g[e].num_edge_states_passed < g[e].num_edge_states)
+            continue;
+      }
+      else
+         found_invalid = true;
+      g[e].edge_tag = tag;
+      g[e].num_edge_states_passed = 0;
+      _path_bisect_perms[ui_best] = 0;
+   }
+   
+   // all checks are done, so each edge's w_lazy is now final;
+   // the neighbors of edges without checks are covered by those with
+   for (unsigned int ui=0; ui<es.size(); ui++)
+   {
+      const Edge & e = es[ui];
+      if (_path_bisect_checks[ui])
+         weights.push_back(wmap_update(e, es_changed));
+      else
+      {
+         double val_old = g[e].w_lazy;
+         calculate_w_lazy(e);
+         if (g[e].w_lazy != val_old && g[e].batch < (int)_num_batches_searched)
+            es_changed.push_back(e);
+         weights.push_back(g[e].w_lazy);
+      }
+      changed_ends.push_back(es_changed.size());
+   }
+}
 
-      // make sure we've generated internal edges
+double ompl_lemur::LEMUR::wmap_speculate(const std::vector<Edge> & es_speculate,
+   boost::function<double ()> search, const std::vector<Edge> & path,
+   std::vector<Edge> & es, std::vector<double> & weights,
+   std::vector<Edge> & es_changed, std::vector<size_t> & changed_ends)
+{
+   // the interior states are generated up front,
+   // since the bisection permutation cache is shared
+   for (unsigned int ui=0; ui<es_speculate.size(); ui++)
+   {
+      const Edge & e = es_speculate[ui];
       if (g[e].num_edge_states != g[e].edge_states.size())
          edge_init_states(e);
+   }
+   
+   // the workers change vertex and edge tags, which the search reads
+   // only to recalculate stale or dirty w_lazy values; there are none
+   // while speculating (see w_lazy_deferrable), so it reads only w_lazy,
+   // which the workers leave alone
+   _speculative_checks.assign(es_speculate.size(), 0);
+   boost::mutex mutex;
+   size_t next = 0;
+   bool stop = false;
+   speculative_check_worker worker(*this, es_speculate, _speculative_checks, mutex, next, stop);
+   boost::thread_group threads;
+   for (unsigned int ti=0; ti<_num_speculative_threads; ti++)
+      threads.create_thread(worker);
+   double pathlen = search();
+   {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      stop = true;
+   }
+   threads.join_all();
+   
+   // merge the completed edges in order
+   for (unsigned int ui=0; ui<next; ui++)
+   {
+      const Edge & e = es_speculate[ui];
+      es.push_back(e);
+      weights.push_back(wmap_update(e, es_changed));
+      changed_ends.push_back(es_changed.size());
+      if (std::find(path.begin(), path.end(), e) != path.end())
+         _num_speculative_checks_useful += _speculative_checks[ui];
+      else
+         _num_speculative_checks_wasted += _speculative_checks[ui];
+   }
+   return pathlen;
+}
+
+bool ompl_lemur::LEMUR::wmap_check_endpoints(const Edge & e, size_t * num_checks)
+{
+   // partial progress from before the utility checker changed
+   // is discarded first (see w_lazy_get)
+   if (g[e].w_lazy_epoch != _w_lazy_epoch)
+      calculate_w_lazy(e);
+   Vertex va = source(e, g);
+   Vertex vb = target(e, g);
+   // endpoints whose tags change here have their incident edges
+   // recalculated by the next wmap_update
+   if (g[va].state && !tag_known(g[va].tag))
+   {
+      if (num_checks)
+         (*num_checks)++;
+      size_t tag_before = g[va].tag;
+      bool success = _utility_checker->isValidPartialEval(g[va].tag, g[va].state);
+      vertex_tag_changed(va, g[va].tag != tag_before);
+      if (!success)
+         return false;
+   }
+   if (g[vb].state && !tag_known(g[vb].tag))
+   {
+      if (num_checks)
+         (*num_checks)++;
+      size_t tag_before = g[vb].tag;
+      bool success = _utility_checker->isValidPartialEval(g[vb].tag, g[vb].state);
+      vertex_tag_changed(vb, g[vb].tag != tag_before);
+      if (!success)
+         return false;
+   }
+   return true;
+}
 
-      // check each internal edge state (once)
+void ompl_lemur::LEMUR::wmap_check_interior(const Edge & e,
+   std::vector<size_t> & tags, size_t * num_checks)
+{
+   // check each internal edge state (once)
 #if 0
-      for (unsigned ui=0; ui<g[e].edge_tags.size(); ui++)
+   for (unsigned ui=0; ui<g[e].edge_tags.size(); ui++)
+   {
+      if (!_utility_checker->isKnown(g[e].edge_tags[ui]))
       {
-         if (!_utility_checker->isKnown(g[e].edge_tags[ui]))
-         {
-            bool success = _utility_checker->isValidPartialEval(g[e].edge_tags[ui], g[e].edge_states[ui]);
-            if (!success)
-               break;
-         }
+         bool success = _utility_checker->isValidPartialEval(g[e].edge_tags[ui], g[e].edge_states[ui]);
+         if (!success)
+            break;
       }
+   }
 #endif
-      size_t old_tag = g[e].edge_tag;
-      size_t new_tag = 0;
-      if (!_utility_checker->isKnown(old_tag))
+   size_t old_tag = g[e].edge_tag;
+   size_t new_tag = 0;
+   size_t num_prev_passed = g[e].num_edge_states_passed;
+   size_t num_states = g[e].edge_states.size() - num_prev_passed;
+   if (!tag_known(old_tag) && num_states)
+   {
+      // all states start from the edge's tag, and are checked
+      // together (in order, stopping at the first failure),
+      // resuming after any which have already passed
+      tags.assign(num_states, old_tag);
+      size_t num_passed = _utility_checker->isValidPartialEvalBatch(
+         &tags[0], &g[e].edge_states[num_prev_passed], num_states);
+      if (num_checks)
+         (*num_checks) += std::min(num_passed+1, num_states);
+      if (num_passed < num_states)
+         new_tag = tags[num_passed];
+      else
+         new_tag = tags[0];
+      for (size_t ui=1; ui<num_passed; ui++)
       {
-         for (unsigned ui=0; ui<g[e].edge_states.size(); ui++)
+         if (tags[ui] != tags[0])
          {
-            size_t this_new_tag = old_tag;
-            bool success = _utility_checker->isValidPartialEval(this_new_tag, g[e].edge_states[ui]);
-            if (ui == 0)
-               new_tag = this_new_tag;
-            if (!success)
-            {
-               new_tag = this_new_tag;
-               break;
-            }
-            if (this_new_tag != new_tag)
-            {
-               OMPL_ERROR("Within-edge tag mismatch!");
-               abort();
-            }
+            OMPL_ERROR("Within-edge tag mismatch!");
+            abort();
          }
       }
-      g[e].edge_tag = new_tag;
-
    }
-   while (0);
-   
-   std::vector<Edge> es_changed;
+   g[e].edge_tag = new_tag;
+   g[e].num_edge_states_passed = 0;
+}
+
+double ompl_lemur::LEMUR::wmap_update(const Edge & e, std::vector<Edge> & es_changed)
+{
+   Vertex va = source(e, g);
+   Vertex vb = target(e, g);
    double val_old;
    
-   // recalculate wlazy for this edge and any incident edges
+   if (_failprob_active)
+      failprob_note(e);
+   
+   // the evaluation may have added tags
+   tag_table_refresh(false);
+   
+   _num_w_lazy_updates++;
+   _num_w_lazy_recalcs_full += 1 + out_degree(va,g) + out_degree(vb,g);
+   
+   // recalculate wlazy for this edge
    val_old = g[e].w_lazy;
    calculate_w_lazy(e);
+   _num_w_lazy_recalcs++;
    if (g[e].w_lazy != val_old && g[e].batch < (int)_num_batches_searched)
       es_changed.push_back(e);
    
-   OutEdgeIter ei, ei_end;
+   // and for the incident edges of endpoints whose tags changed
+   wmap_update_incident(va, e, es_changed);
+   wmap_update_incident(vb, e, es_changed);
+
+   return g[e].w_lazy;
+}
+
+void ompl_lemur::LEMUR::wmap_update_incident(Vertex v, const Edge & e, std::vector<Edge> & es_changed)
+{
+   // only endpoints whose tags changed since the last update
+   // (see wmap_check_endpoints); edges added since (e.g. by a new
+   // batch or the overlay) have their w_lazy calculated with the
+   // vertex's current tag
+   size_t vidx = get(get(boost::vertex_index,g), v);
+   if (_v_tag_changed.size() <= vidx || !_v_tag_changed[vidx])
+      return;
+   _v_tag_changed[vidx] = 0;
    
-   for (boost::tie(ei,ei_end)=out_edges(va,g); ei!=ei_end; ei++)
+   OutEdgeIter ei, ei_end;
+   for (boost::tie(ei,ei_end)=out_edges(v,g); ei!=ei_end; ei++)
    {
-      val_old = g[*ei].w_lazy;
+      if (*ei == e)
+         continue;
+      // edges outside the searched batches are recalculated
+      // when they are next used (see w_lazy_get)
+      if (_num_batches_searched <= (unsigned int)g[*ei].batch)
+      {
+         if (w_lazy_deferrable())
+         {
+            g[*ei].w_lazy_dirty = true;
+            _w_lazy_dirty_any = true;
+         }
+         else
+         {
+            calculate_w_lazy(*ei);
+            _num_w_lazy_recalcs++;
+         }
+         continue;
+      }
+      double val_old = g[*ei].w_lazy;
       calculate_w_lazy(*ei);
-      if (g[*ei].w_lazy != val_old && g[*ei].batch < (int)_num_batches_searched)
+      _num_w_lazy_recalcs++;
+      if (g[*ei].w_lazy != val_old)
          es_changed.push_back(*ei);
    }
+}
+
+void ompl_lemur::LEMUR::vertex_tag_changed(Vertex v, bool changed)
+{
+   size_t vidx = get(get(boost::vertex_index,g), v);
+   if (_v_tag_changed.size() <= vidx)
+   {
+      if (!changed)
+         return;
+      _v_tag_changed.resize(num_vertices(g), 0);
+   }
+   if (changed)
+      _v_tag_changed[vidx] = 1;
+}
+
+double ompl_lemur::LEMUR::failprob_get(const Edge & e)
+{
+   Vertex va = source(e, g);
+   Vertex vb = target(e, g);
+   if (!g[va].state || !g[vb].state)
+      return 0.0;
+   
+   // query at the edge midpoint
+   space->interpolate(g[va].state, g[vb].state, 0.5, _failprob_states[0]);
    
-   for (boost::tie(ei,ei_end)=out_edges(vb,g); ei!=ei_end; ei++)
+   // gaussian kernel estimate, with one pseudo-observation at 0.5
+   // so that edges far from any evidence are neither likely nor unlikely;
+   // the sums are cached, so that only the evidence noted since the
+   // edge was last queried is added
+   size_t eidx = g[e].index;
+   double & sum_weight = _failprob_edge_sum_weight[eidx];
+   double & sum_invalid = _failprob_edge_sum_invalid[eidx];
+   size_t & num_seen = _failprob_edge_num_seen[eidx];
+   if (!num_seen)
    {
-      val_old = g[*ei].w_lazy;
-      calculate_w_lazy(*ei);
-      if (g[*ei].w_lazy != val_old && g[*ei].batch < (int)_num_batches_searched)
-         es_changed.push_back(*ei);
+      sum_weight = 1.0;
+      sum_invalid = 0.5;
+      _failprob_near.clear();
+      _failprob_nn->nearestR(0, 3.0*_failprob_h, _failprob_near);
    }
+   else
+   {
+      _failprob_near.clear();
+      for (size_t idx=num_seen; idx<_failprob_states.size(); idx++)
+         if (space->distance(_failprob_states[0], _failprob_states[idx]) <= 3.0*_failprob_h)
+            _failprob_near.push_back(idx);
+   }
+   for (unsigned int ui=0; ui<_failprob_near.size(); ui++)
+   {
+      double dist = space->distance(_failprob_states[0], _failprob_states[_failprob_near[ui]]);
+      double weight = exp(-0.5*dist*dist/(_failprob_h*_failprob_h));
+      sum_weight += weight;
+      if (_failprob_invalid[_failprob_near[ui]])
+         sum_invalid += weight;
+   }
+   num_seen = _failprob_states.size();
+   return sum_invalid / sum_weight;
+}
+
+void ompl_lemur::LEMUR::failprob_reset()
+{
+   for (unsigned int ui=0; ui<_failprob_states.size(); ui++)
+      space->freeState(_failprob_states[ui]);
+   _failprob_states.clear();
+   _failprob_invalid.clear();
+   _failprob_states.push_back(space->allocState());
+   _failprob_invalid.push_back(false);
+   
+   _failprob_nn.reset(new ompl::NearestNeighborsGNAT<size_t>());
+   _failprob_nn->setDistanceFunction(boost::bind(&ompl_lemur::LEMUR::failprob_dist, this, _1, _2));
+   _failprob_h = _failprob_bandwidth;
+   if (!_failprob_h)
+      _failprob_h = 0.1 * space->getMaximumExtent();
+   
+   _failprob_vertex_noted.clear();
+   _failprob_edge_noted.clear();
+   _failprob_edge_sum_weight.clear();
+   _failprob_edge_sum_invalid.clear();
+   _failprob_edge_num_seen.clear();
+   _failprob_active = true;
+   failprob_extend();
+}
+
+void ompl_lemur::LEMUR::failprob_extend()
+{
+   // edges of new batches are appended
+   size_t num_edges_noted = _failprob_edge_noted.size();
+   _failprob_vertex_noted.resize(num_vertices(g), false);
+   _failprob_edge_noted.resize(num_edges(eig), false);
+   _failprob_edge_sum_weight.resize(num_edges(eig), 0.0);
+   _failprob_edge_sum_invalid.resize(num_edges(eig), 0.0);
+   _failprob_edge_num_seen.resize(num_edges(eig), 0);
+   for (size_t eidx=num_edges_noted; eidx<num_edges(eig); eidx++)
+      failprob_note(get(eig.edge_vector_map, eidx));
+   
+   // while root vertices and edges may reuse indices
+   // (see overlay_apply)
+   if (overlay_manager.is_applied)
+      for (unsigned int ui=0; ui<overlay_manager.applied_edges.size(); ui++)
+         failprob_note(og[overlay_manager.applied_edges[ui]].core_edge);
+}
+
+void ompl_lemur::LEMUR::failprob_note(const Edge & e)
+{
+   Vertex va = source(e, g);
+   Vertex vb = target(e, g);
+   Vertex vs[2] = {va, vb};
+   for (unsigned int ui=0; ui<2; ui++)
+   {
+      size_t vidx = get(get(boost::vertex_index,g), vs[ui]);
+      if (!g[vs[ui]].state || _failprob_vertex_noted[vidx])
+         continue;
+      if (!tag_known(g[vs[ui]].tag))
+         continue;
+      _failprob_vertex_noted[vidx] = true;
+      failprob_note_state(g[vs[ui]].state,
+         tag_known_invalid(g[vs[ui]].tag));
+   }
+   
+   // edges with known interiors are noted at their midpoints
+   if (!g[va].state || !g[vb].state || !g[e].num_edge_states)
+      return;
+   if (_failprob_edge_noted[g[e].index])
+      return;
+   if (!tag_known(g[e].edge_tag))
+      return;
+   _failprob_edge_noted[g[e].index] = true;
+   space->interpolate(g[va].state, g[vb].state, 0.5, _failprob_states[0]);
+   failprob_note_state(_failprob_states[0],
+      tag_known_invalid(g[e].edge_tag));
+}
 
-   return std::make_pair(g[e].w_lazy, es_changed);
+void ompl_lemur::LEMUR::failprob_note_state(const ompl::base::State * state, bool invalid)
+{
+   size_t idx = _failprob_states.size();
+   _failprob_states.push_back(space->allocState());
+   space->copyState(_failprob_states[idx], state);
+   _failprob_invalid.push_back(invalid);
+   _failprob_nn->add(idx);
+}
+
+double ompl_lemur::LEMUR::failprob_dist(const size_t & a, const size_t & b)
+{
+   return space->distance(_failprob_states[a], _failprob_states[b]);
 }
 
 double ompl_lemur::LEMUR::nn_dist(const Vertex & va, const Vertex & vb)
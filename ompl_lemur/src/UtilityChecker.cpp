@@ -5,6 +5,7 @@
  */
 
 #include <stdexcept>
+#include <vector>
 #include <ompl/base/StateValidityChecker.h>
 #include <ompl_lemur/config.h>
 #include <ompl_lemur/UtilityChecker.h>
@@ -80,6 +81,24 @@ double ompl_lemur::BinaryUtilityChecker::getPartialEvalCost(size_t tag, const om
    }
 }
 
+bool ompl_lemur::BinaryUtilityChecker::updateTagTable(TagTable & table) const
+{
+   // the three tags never change
+   table.known.resize(3);
+   table.known_invalid.resize(3);
+   table.cost.resize(3);
+   table.known[TAG_UNKNOWN] = false;
+   table.known_invalid[TAG_UNKNOWN] = false;
+   table.cost[TAG_UNKNOWN] = _check_cost;
+   table.known[TAG_KNOWN_VALID] = true;
+   table.known_invalid[TAG_KNOWN_VALID] = false;
+   table.cost[TAG_KNOWN_VALID] = 0.0;
+   table.known[TAG_KNOWN_INVALID] = true;
+   table.known_invalid[TAG_KNOWN_INVALID] = true;
+   table.cost[TAG_KNOWN_INVALID] = 0.0;
+   return true;
+}
+
 bool ompl_lemur::BinaryUtilityChecker::isValidPartialEval(size_t & tag, const ompl::base::State * state) const
 {
    if (tag != TAG_UNKNOWN)
@@ -88,3 +107,26 @@ bool ompl_lemur::BinaryUtilityChecker::isValidPartialEval(size_t & tag, const om
    tag = is_valid ? TAG_KNOWN_VALID : TAG_KNOWN_INVALID;
    return is_valid;
 }
+
+size_t ompl_lemur::BinaryUtilityChecker::isValidPartialEvalBatch(size_t * tags,
+   const ompl::base::State * const * states, size_t n) const
+{
+   // ompl validity checkers have no batch interface, so the wrapped
+   // checker is still called once per state; this only saves the
+   // virtual call through isValidPartialEval() for each state
+   // (the tags are validated up front)
+   for (size_t i=0; i<n; i++)
+      if (tags[i] != TAG_UNKNOWN)
+         throw std::runtime_error("isValidPartialEvalBatch called on known edge!");
+   const ompl::base::StateValidityChecker & wrapped = *_wrapped;
+   for (size_t i=0; i<n; i++)
+   {
+      if (!wrapped.isValid(states[i]))
+      {
+         tags[i] = TAG_KNOWN_INVALID;
+         return i;
+      }
+      tags[i] = TAG_KNOWN_VALID;
+   }
+   return n;
+}
@@ -0,0 +1,217 @@
+/*! \file merge_tag_caches.cpp
+ * \author Chris Dellin <cdellin@gmail.com>
+ * \copyright 2015 Carnegie Mellon University
+ * \copyright License: BSD
+ *
+ * Merges family tag cache files (e.g. written by separate LEMUR
+ * solve_all runs over different shards) into a single file.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <boost/program_options.hpp>
+#include <ompl/util/Console.h>
+
+struct CacheBatch
+{
+   size_t batch;
+   std::string vertices; // one of 'U' 'V' 'I' per vertex
+   std::string edges; // one of 'U' 'V' 'I' per edge
+};
+
+struct CacheFile
+{
+   std::string header;
+   std::vector<CacheBatch> batches;
+};
+
+bool read_cache_file(const std::string & filename, CacheFile & file)
+{
+   std::ifstream fs(filename.c_str());
+   if (!fs.is_open())
+   {
+      OMPL_ERROR("Could not open file \"%s\".", filename.c_str());
+      return false;
+   }
+   std::string line;
+   // header is everything before the first batch line
+   // (the header itself is written without a trailing newline,
+   // so the first batch line may follow it directly)
+   std::stringstream ss;
+   ss << fs.rdbuf();
+   std::string contents = ss.str();
+   size_t pos = contents.find("batch ");
+   if (pos == contents.npos)
+   {
+      OMPL_ERROR("No batches in file \"%s\".", filename.c_str());
+      return false;
+   }
+   file.header = contents.substr(0, pos);
+   std::stringstream body(contents.substr(pos));
+   while (std::getline(body, line))
+   {
+      if (!line.size())
+         continue;
+      CacheBatch cb;
+      size_t num_vertices;
+      size_t num_edges;
+      int n;
+      int ret = sscanf(line.c_str(), "batch %lu num_vertices %lu num_edges %lu%n",
+         &cb.batch, &num_vertices, &num_edges, &n);
+      if (ret != 3 || n != (int)line.size())
+      {
+         OMPL_ERROR("Bad batch line in file \"%s\".", filename.c_str());
+         return false;
+      }
+      if (!std::getline(body, line) || line.substr(0,9) != "vertices "
+         || line.size() != 9 + num_vertices)
+      {
+         OMPL_ERROR("Vertex mismatch in file \"%s\".", filename.c_str());
+         return false;
+      }
+      cb.vertices = line.substr(9);
+      if (!std::getline(body, line) || line.substr(0,6) != "edges "
+         || line.size() != 6 + num_edges)
+      {
+         OMPL_ERROR("Edge mismatch in file \"%s\".", filename.c_str());
+         return false;
+      }
+      cb.edges = line.substr(6);
+      if (cb.vertices.find_first_not_of("UVI") != cb.vertices.npos
+         || cb.edges.find_first_not_of("UVI") != cb.edges.npos)
+      {
+         OMPL_ERROR("Unknown character in file \"%s\".", filename.c_str());
+         return false;
+      }
+      file.batches.push_back(cb);
+   }
+   return true;
+}
+
+// merges src into dst, returns the number of conflicting elements
+size_t merge_knowledge(std::string & dst, const std::string & src)
+{
+   size_t conflicts = 0;
+   for (size_t i=0; i<dst.size(); i++)
+   {
+      if (src[i] == 'U')
+         continue;
+      if (dst[i] == 'U')
+         dst[i] = src[i];
+      else if (dst[i] != src[i])
+         conflicts++;
+   }
+   return conflicts;
+}
+
+int main(int argc, char **argv)
+{
+   boost::program_options::options_description desc("Allowed options");
+   desc.add_options()
+      ("help", "produce help message")
+      ("in-file", boost::program_options::value< std::vector<std::string> >(), "input tag cache file (pass once per shard)")
+      ("out-file", boost::program_options::value<std::string>(), "output tag cache file")
+   ;
+   
+   boost::program_options::variables_map args;
+   boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), args);
+   boost::program_options::notify(args);
+   
+   if (args.count("help"))
+   {
+      std::cout << desc << std::endl;
+      return 0;
+   }
+   
+   if (!args.count("in-file"))
+   {
+      OMPL_ERROR("--in-file must be passed.");
+      return 1;
+   }
+   if (args.count("out-file") != 1)
+   {
+      OMPL_ERROR("--out-file must be passed.");
+      return 1;
+   }
+   
+   const std::vector<std::string> & in_files = args["in-file"].as< std::vector<std::string> >();
+   
+   CacheFile merged;
+   for (unsigned int ui=0; ui<in_files.size(); ui++)
+   {
+      CacheFile file;
+      if (!read_cache_file(in_files[ui], file))
+         return 1;
+      if (ui == 0)
+      {
+         merged = file;
+         continue;
+      }
+      
+      // consistency checks
+      if (file.header != merged.header)
+      {
+         OMPL_ERROR("Header of \"%s\" does not match \"%s\".",
+            in_files[ui].c_str(), in_files[0].c_str());
+         return 1;
+      }
+      if (file.batches.size() != merged.batches.size())
+      {
+         OMPL_ERROR("Number of batches in \"%s\" does not match \"%s\".",
+            in_files[ui].c_str(), in_files[0].c_str());
+         return 1;
+      }
+      for (unsigned int ib=0; ib<file.batches.size(); ib++)
+      {
+         CacheBatch & dst = merged.batches[ib];
+         const CacheBatch & src = file.batches[ib];
+         if (src.batch != dst.batch
+            || src.vertices.size() != dst.vertices.size()
+            || src.edges.size() != dst.edges.size())
+         {
+            OMPL_ERROR("Batch %u of \"%s\" does not match \"%s\".",
+               ib, in_files[ui].c_str(), in_files[0].c_str());
+            return 1;
+         }
+         size_t conflicts = merge_knowledge(dst.vertices, src.vertices)
+            + merge_knowledge(dst.edges, src.edges);
+         if (conflicts)
+         {
+            OMPL_ERROR("Batch %u of \"%s\" has %lu elements conflicting with earlier files.",
+               ib, in_files[ui].c_str(), conflicts);
+            return 1;
+         }
+      }
+   }
+   
+   // write output in the same format read by FamilyTagCache
+   const std::string out_file = args["out-file"].as<std::string>();
+   FILE * fp = fopen(out_file.c_str(), "w");
+   if (!fp)
+   {
+      OMPL_ERROR("Could not save to file \"%s\".", out_file.c_str());
+      return 1;
+   }
+   fprintf(fp, "%s", merged.header.c_str());
+   size_t num_unknown = 0;
+   for (unsigned int ib=0; ib<merged.batches.size(); ib++)
+   {
+      const CacheBatch & cb = merged.batches[ib];
+      fprintf(fp, "batch %lu num_vertices %lu num_edges %lu\n",
+         cb.batch, cb.vertices.size(), cb.edges.size());
+      fprintf(fp, "vertices %s\n", cb.vertices.c_str());
+      fprintf(fp, "edges %s\n", cb.edges.c_str());
+      num_unknown += std::count(cb.vertices.begin(), cb.vertices.end(), 'U');
+      num_unknown += std::count(cb.edges.begin(), cb.edges.end(), 'U');
+   }
+   fclose(fp);
+   
+   OMPL_INFORM("Merged %lu files into \"%s\" (%lu elements unknown).",
+      in_files.size(), out_file.c_str(), num_unknown);
+   
+   return 0;
+}
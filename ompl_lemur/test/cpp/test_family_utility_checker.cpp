@@ -4,8 +4,15 @@
  * \copyright License: BSD
  */
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <set>
+#include <stdint.h>
+#include <unistd.h>
 #include <boost/graph/adjacency_list.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <ompl/base/SpaceInformation.h>
 #include <ompl/base/spaces/RealVectorStateSpace.h>
@@ -44,6 +51,370 @@ TEST(FamilyUtilityCheckerCase, InclusionTest)
    ASSERT_TRUE(family_checker.getPartialEvalCost(0,0) == 1.0);
 }
 
+// valid below a threshold on the first coordinate, counting checks
+class ThresholdChecker : public ompl::base::StateValidityChecker
+{
+public:
+   double threshold;
+   mutable unsigned int num_checks;
+   ThresholdChecker(const ompl::base::SpaceInformationPtr & si, double threshold):
+      ompl::base::StateValidityChecker(si), threshold(threshold), num_checks(0)
+   {
+   }
+   bool isValid(const ompl::base::State * state) const
+   {
+      num_checks++;
+      return state->as<ompl::base::RealVectorStateSpace::StateType>()->values[0] < threshold;
+   }
+};
+
+// the batch call matches checking each state in turn
+// (same checks, same stopping point, same tags)
+TEST(FamilyUtilityCheckerCase, BatchEvalTest)
+{
+   ompl::base::StateSpacePtr space(
+      new ompl::base::RealVectorStateSpace(1));
+   ompl::base::SpaceInformationPtr si(
+      new ompl::base::SpaceInformation(space));
+   
+   ompl_lemur::Family family;
+   family.sets.insert("si1");
+   family.sets.insert("si2");
+   family.add_inclusion("si1","si2");
+   
+   const double xs[] = {0.1, 0.2, 0.25, 0.4, 0.1};
+   const size_t n = sizeof(xs)/sizeof(xs[0]);
+   std::vector<ompl::base::State *> states(n);
+   for (size_t i=0; i<n; i++)
+   {
+      states[i] = space->allocState();
+      states[i]->as<ompl::base::RealVectorStateSpace::StateType>()->values[0] = xs[i];
+   }
+   
+   // each prefix of the batch, with fresh checkers
+   for (size_t len=1; len<=n; len++)
+   {
+      std::vector<size_t> tags_single(len, 0);
+      std::vector<size_t> tags_batch(len, 0);
+      size_t num_passed_single;
+      unsigned int checks_single[2];
+      unsigned int checks_batch[2];
+      for (int pass=0; pass<2; pass++)
+      {
+         ompl_lemur::FamilyUtilityChecker family_checker(si, family);
+         ThresholdChecker * c1 = new ThresholdChecker(si, 0.3);
+         ThresholdChecker * c2 = new ThresholdChecker(si, 0.6);
+         std::map<std::string, ompl_lemur::FamilyUtilityChecker::SetChecker> set_checkers;
+         set_checkers["si1"] = std::make_pair(1.0, ompl::base::StateValidityCheckerPtr(c1));
+         set_checkers["si2"] = std::make_pair(2.0, ompl::base::StateValidityCheckerPtr(c2));
+         family_checker.start_checking("si2", set_checkers);
+         if (pass == 0)
+         {
+            for (num_passed_single=0; num_passed_single<len; num_passed_single++)
+               if (!family_checker.isValidPartialEval(tags_single[num_passed_single], states[num_passed_single]))
+                  break;
+            checks_single[0] = c1->num_checks;
+            checks_single[1] = c2->num_checks;
+         }
+         else
+         {
+            size_t num_passed_batch = family_checker.isValidPartialEvalBatch(
+               &tags_batch[0], &states[0], len);
+            ASSERT_EQ(num_passed_single, num_passed_batch);
+            checks_batch[0] = c1->num_checks;
+            checks_batch[1] = c2->num_checks;
+         }
+      }
+      ASSERT_TRUE(tags_single == tags_batch);
+      ASSERT_EQ(checks_single[0], checks_batch[0]);
+      ASSERT_EQ(checks_single[1], checks_batch[1]);
+      if (len == n)
+         ASSERT_EQ(3, num_passed_single);
+   }
+   
+   for (size_t i=0; i<n; i++)
+      space->freeState(states[i]);
+}
+
+// the tag table matches the per-tag queries,
+// and is extended to cover tags added by later checks
+TEST(FamilyUtilityCheckerCase, TagTableTest)
+{
+   ompl::base::StateSpacePtr space(
+      new ompl::base::RealVectorStateSpace(1));
+   ompl::base::SpaceInformationPtr si(
+      new ompl::base::SpaceInformation(space));
+   
+   ompl_lemur::Family family;
+   family.sets.insert("si1");
+   family.sets.insert("si2");
+   family.add_inclusion("si1","si2");
+   
+   ompl_lemur::FamilyUtilityChecker family_checker(si, family);
+   ompl_lemur::UtilityChecker::TagTable table;
+   ASSERT_FALSE(family_checker.updateTagTable(table));
+   ASSERT_EQ(0, table.known.size());
+   
+   std::map<std::string, ompl_lemur::FamilyUtilityChecker::SetChecker> set_checkers;
+   set_checkers["si1"] = std::make_pair(1.0, ompl::base::StateValidityCheckerPtr(new ThresholdChecker(si, 0.3)));
+   set_checkers["si2"] = std::make_pair(2.0, ompl::base::StateValidityCheckerPtr(new ThresholdChecker(si, 0.6)));
+   family_checker.start_checking("si2", set_checkers);
+   ASSERT_TRUE(family_checker.updateTagTable(table));
+   ASSERT_EQ(1, table.known.size());
+   
+   // valid via si1, then valid via si2, then invalid via si2
+   const double xs[] = {0.1, 0.5, 0.9};
+   ompl::base::State * state = space->allocState();
+   for (size_t i=0; i<sizeof(xs)/sizeof(xs[0]); i++)
+   {
+      state->as<ompl::base::RealVectorStateSpace::StateType>()->values[0] = xs[i];
+      size_t tag = 0;
+      while (!family_checker.isKnown(tag))
+         family_checker.isValidPartialEval(tag, state);
+      ASSERT_TRUE(family_checker.updateTagTable(table));
+      ASSERT_EQ(family_checker.numTags(), table.known.size());
+      ASSERT_EQ(family_checker.numTags(), table.known_invalid.size());
+      ASSERT_EQ(family_checker.numTags(), table.cost.size());
+      for (size_t t=0; t<table.known.size(); t++)
+      {
+         ASSERT_EQ(family_checker.isKnown(t), (bool)table.known[t]);
+         ASSERT_EQ(family_checker.isKnownInvalid(t), (bool)table.known_invalid[t]);
+         ASSERT_EQ(family_checker.getPartialEvalCost(t,0), table.cost[t]);
+      }
+   }
+   ASSERT_TRUE(table.known_invalid.back());
+   space->freeState(state);
+}
+
+// with a chain s1 < s2 < s3 < s4 < s5, each check result
+// implies the knowledge of the sets on one side, and equal
+// beliefs reached in different ways share a tag
+TEST(FamilyUtilityCheckerCase, ImplicationTest)
+{
+   ompl::base::StateSpacePtr space(
+      new ompl::base::RealVectorStateSpace(1));
+   ompl::base::SpaceInformationPtr si(
+      new ompl::base::SpaceInformation(space));
+   
+   ompl_lemur::Family family;
+   const char * names[] = {"s1", "s2", "s3", "s4", "s5"};
+   for (size_t i=0; i<5; i++)
+      family.sets.insert(names[i]);
+   for (size_t i=0; i+1<5; i++)
+      family.add_inclusion(names[i], names[i+1]);
+   
+   ompl_lemur::FamilyUtilityChecker family_checker(si, family);
+   size_t is[5];
+   for (size_t i=0; i<5; i++)
+      is[i] = family_checker.getSetIndex(names[i]);
+   ASSERT_EQ(1, family_checker.numTags());
+   
+   // s3 valid implies s4 and s5 valid
+   size_t tag_s3v = family_checker.tagIfSetKnown(0, is[2], true);
+   ASSERT_EQ(2, family_checker.numTags());
+   const char expect_s3v[] = "UUVVV";
+   for (size_t i=0; i<5; i++)
+      ASSERT_EQ(expect_s3v[i], family_checker.tagSetKnowledge(tag_s3v, is[i]));
+   
+   // then s2 invalid implies s1 invalid
+   size_t tag_s3v_s2i = family_checker.tagIfSetKnown(tag_s3v, is[1], false);
+   const char expect_s3v_s2i[] = "IIVVV";
+   for (size_t i=0; i<5; i++)
+      ASSERT_EQ(expect_s3v_s2i[i], family_checker.tagSetKnowledge(tag_s3v_s2i, is[i]));
+   
+   // the same belief the other way round
+   size_t tag_s2i = family_checker.tagIfSetKnown(0, is[1], false);
+   ASSERT_EQ(tag_s3v_s2i, family_checker.tagIfSetKnown(tag_s2i, is[2], true));
+   ASSERT_EQ(4, family_checker.numTags());
+   
+   // known beliefs are not re-added
+   ASSERT_EQ(tag_s3v, family_checker.tagIfSetKnown(0, is[2], true));
+   ASSERT_EQ(tag_s3v, family_checker.tagIfSetKnown(tag_s3v, is[3], true));
+   ASSERT_EQ(4, family_checker.numTags());
+}
+
+// a chain of 70 sets (more than fit in one word)
+// is set up without enumerating assignments
+TEST(FamilyUtilityCheckerCase, LargeFamilyTest)
+{
+   ompl::base::StateSpacePtr space(
+      new ompl::base::RealVectorStateSpace(1));
+   ompl::base::SpaceInformationPtr si(
+      new ompl::base::SpaceInformation(space));
+   
+   const size_t n = 70;
+   std::vector<std::string> names;
+   ompl_lemur::Family family;
+   for (size_t i=0; i<n; i++)
+   {
+      char name[8];
+      sprintf(name, "s%02lu", i);
+      names.push_back(name);
+      family.sets.insert(name);
+   }
+   for (size_t i=0; i+1<n; i++)
+      family.add_inclusion(names[i], names[i+1]);
+   
+   ompl_lemur::FamilyUtilityChecker family_checker(si, family);
+   
+   // s30 valid implies s31..s69 valid, and then
+   // s65 invalid contradicts it (all unknown sets become invalid)
+   size_t tag_valid = family_checker.tagIfSetKnown(0, family_checker.getSetIndex("s30"), true);
+   size_t tag_invalid = family_checker.tagIfSetKnown(0, family_checker.getSetIndex("s65"), false);
+   size_t tag_both = family_checker.tagIfSetKnown(tag_valid, family_checker.getSetIndex("s65"), false);
+   for (size_t i=0; i<n; i++)
+   {
+      size_t iset = family_checker.getSetIndex(names[i]);
+      ASSERT_EQ(i < 30 ? 'U' : 'V', family_checker.tagSetKnowledge(tag_valid, iset));
+      ASSERT_EQ(i < 66 ? 'I' : 'U', family_checker.tagSetKnowledge(tag_invalid, iset));
+      ASSERT_EQ(i == 65 ? 'I' : (i < 30 ? 'I' : 'V'), family_checker.tagSetKnowledge(tag_both, iset));
+   }
+   
+   // the cheapest way to show s40 valid is to check s40 itself,
+   // unless a subset of it is cheaper to check
+   std::map<std::string, ompl_lemur::FamilyUtilityChecker::SetChecker> set_checkers;
+   for (size_t i=0; i<n; i++)
+      set_checkers[names[i]] = std::make_pair(i == 35 ? 1.0 : 5.0, ompl::base::StateValidityCheckerPtr());
+   family_checker.start_checking("s40", set_checkers);
+   ASSERT_EQ(1.0, family_checker.getPartialEvalCost(0,0));
+   size_t tag_s38_invalid = family_checker.tagIfSetKnown(0, family_checker.getSetIndex("s38"), false);
+   ASSERT_EQ(5.0, family_checker.getPartialEvalCost(tag_s38_invalid,0));
+   ASSERT_EQ(0.0, family_checker.getPartialEvalCost(tag_valid,0));
+}
+
+// policies computed in bulk by a backward search have the same costs
+// as those computed per tag, both for tags existing at start_checking()
+// and for tags added afterwards
+TEST(FamilyUtilityCheckerCase, PrecomputePoliciesTest)
+{
+   ompl::base::StateSpacePtr space(
+      new ompl::base::RealVectorStateSpace(1));
+   ompl::base::SpaceInformationPtr si(
+      new ompl::base::SpaceInformation(space));
+   
+   // s0 < s1 < s3, s0 < s2 < s3, and s4 = s1 n s2 < s5
+   ompl_lemur::Family family;
+   const char * names[] = {"s0", "s1", "s2", "s3", "s4", "s5"};
+   for (size_t i=0; i<6; i++)
+      family.sets.insert(names[i]);
+   family.add_inclusion("s0", "s1");
+   family.add_inclusion("s0", "s2");
+   family.add_inclusion("s1", "s3");
+   family.add_inclusion("s2", "s3");
+   std::set<std::string> s1_s2;
+   s1_s2.insert("s1");
+   s1_s2.insert("s2");
+   family.add_intersection("s4", s1_s2);
+   family.add_inclusion("s4", "s5");
+   
+   ompl_lemur::FamilyUtilityChecker checker_lazy(si, family);
+   ompl_lemur::FamilyUtilityChecker checker_bulk(si, family);
+   checker_bulk.set_precompute_policies(true);
+   
+   std::map<std::string, ompl_lemur::FamilyUtilityChecker::SetChecker> set_checkers;
+   const double costs[] = {1.0, 3.0, 2.5, 9.0, 4.0, 6.0};
+   for (size_t i=0; i<6; i++)
+      set_checkers[names[i]] = std::make_pair(costs[i], ompl::base::StateValidityCheckerPtr());
+   
+   // the same tags in both checkers, half before and half after
+   srand(1);
+   for (size_t target=3; target<6; target++)
+   {
+      for (size_t k=0; k<40; k++)
+      {
+         if (k == 20)
+         {
+            checker_lazy.start_checking(names[target], set_checkers);
+            checker_bulk.start_checking(names[target], set_checkers);
+         }
+         size_t tag = rand() % checker_lazy.numTags();
+         size_t iset = checker_lazy.getSetIndex(names[rand() % 6]);
+         bool value = rand() % 2;
+         ASSERT_EQ(checker_lazy.tagIfSetKnown(tag, iset, value),
+            checker_bulk.tagIfSetKnown(tag, iset, value));
+      }
+      for (size_t tag=0; tag<checker_lazy.numTags(); tag++)
+      {
+         if (checker_lazy.isKnownInvalid(tag))
+            continue;
+         ASSERT_EQ(checker_lazy.getPartialEvalCost(tag,0),
+            checker_bulk.getPartialEvalCost(tag,0));
+      }
+   }
+}
+
+// a new checker for the same family loads the tags (with the same
+// numbering) and the policies of each target saved by another
+// a uniquely named temporary file, removed on scope exit
+// (even if an assertion returns from the test early)
+struct temp_file
+{
+   char path[64];
+   temp_file()
+   {
+      strcpy(path, "/tmp/test_family_tables_XXXXXX");
+      int fd = mkstemp(path);
+      if (fd != -1)
+         close(fd);
+   }
+   ~temp_file()
+   {
+      std::remove(path);
+   }
+};
+
+TEST(FamilyUtilityCheckerCase, SaveLoadTablesTest)
+{
+   ompl::base::StateSpacePtr space(
+      new ompl::base::RealVectorStateSpace(1));
+   ompl::base::SpaceInformationPtr si(
+      new ompl::base::SpaceInformation(space));
+   
+   ompl_lemur::Family family;
+   const char * names[] = {"s1", "s2", "s3", "s4"};
+   for (size_t i=0; i<4; i++)
+      family.sets.insert(names[i]);
+   for (size_t i=0; i+1<4; i++)
+      family.add_inclusion(names[i], names[i+1]);
+   
+   std::map<std::string, ompl_lemur::FamilyUtilityChecker::SetChecker> set_checkers;
+   const double costs[] = {1.0, 4.0, 2.0, 8.0};
+   for (size_t i=0; i<4; i++)
+      set_checkers[names[i]] = std::make_pair(costs[i], ompl::base::StateValidityCheckerPtr());
+   
+   // policies for two targets, the first with more tags added later
+   ompl_lemur::FamilyUtilityChecker checker_saved(si, family);
+   size_t tag_s3i = checker_saved.tagIfSetKnown(0, checker_saved.getSetIndex("s3"), false);
+   checker_saved.start_checking("s4", set_checkers);
+   double cost_s4 = checker_saved.getPartialEvalCost(tag_s3i,0);
+   checker_saved.start_checking("s2", set_checkers);
+   double cost_s2 = checker_saved.getPartialEvalCost(0,0);
+   size_t tag_s1v = checker_saved.tagIfSetKnown(0, checker_saved.getSetIndex("s1"), true);
+   temp_file tables;
+   ASSERT_TRUE(checker_saved.save_tables(tables.path));
+   
+   ompl_lemur::FamilyUtilityChecker checker_loaded(si, family);
+   ASSERT_TRUE(checker_loaded.load_tables(tables.path));
+   ASSERT_EQ(checker_saved.numTags(), checker_loaded.numTags());
+   for (size_t tag=0; tag<checker_saved.numTags(); tag++)
+      for (size_t i=0; i<4; i++)
+         ASSERT_EQ(checker_saved.tagSetKnowledge(tag, i), checker_loaded.tagSetKnowledge(tag, i));
+   ASSERT_EQ(tag_s1v, checker_loaded.tagIfSetKnown(0, checker_loaded.getSetIndex("s1"), true));
+   checker_loaded.start_checking("s4", set_checkers);
+   ASSERT_EQ(cost_s4, checker_loaded.getPartialEvalCost(tag_s3i,0));
+   checker_loaded.start_checking("s2", set_checkers);
+   ASSERT_EQ(cost_s2, checker_loaded.getPartialEvalCost(0,0));
+   
+   // but not into a checker whose tags differ, or for another family
+   ompl_lemur::FamilyUtilityChecker checker_other(si, family);
+   checker_other.tagIfSetKnown(0, checker_other.getSetIndex("s4"), true);
+   ASSERT_FALSE(checker_other.load_tables(tables.path));
+   ASSERT_EQ(2, checker_other.numTags());
+   family.add_inclusion("s1", "s3");
+   ompl_lemur::FamilyUtilityChecker checker_family(si, family);
+   ASSERT_FALSE(checker_family.load_tables(tables.path));
+}
+
 int main(int argc, char **argv)
 {
    testing::InitGoogleTest(&argc, argv);
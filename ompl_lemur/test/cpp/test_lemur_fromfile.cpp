@@ -26,6 +26,7 @@
 #include <pr_bgl/edge_indexed_graph.h>
 #include <pr_bgl/heap_indexed.h>
 #include <pr_bgl/string_map.h>
+#include <pr_bgl/cancel_poll.h>
 #include <pr_bgl/overlay_manager.h>
 #include <ompl_lemur/config.h>
 #include <ompl_lemur/util.h>
@@ -35,6 +36,7 @@
 #include <ompl_lemur/Roadmap.h>
 #include <ompl_lemur/TagCache.h>
 #include <ompl_lemur/UtilityChecker.h>
+#include <ompl_lemur/RootTagMemo.h>
 #include <ompl_lemur/LEMUR.h>
 #include <ompl_lemur/RoadmapFromFile.h>
 
@@ -8,6 +8,7 @@
 #include <boost/function.hpp>
 #include <boost/chrono.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/graph/adjacency_list.hpp>
 
 #include <ompl/base/ScopedState.h>
@@ -23,6 +24,7 @@
 #include <pr_bgl/edge_indexed_graph.h>
 #include <pr_bgl/heap_indexed.h>
 #include <pr_bgl/string_map.h>
+#include <pr_bgl/cancel_poll.h>
 #include <pr_bgl/overlay_manager.h>
 #include <ompl_lemur/config.h>
 #include <ompl_lemur/util.h>
@@ -31,6 +33,7 @@
 #include <ompl_lemur/Roadmap.h>
 #include <ompl_lemur/TagCache.h>
 #include <ompl_lemur/UtilityChecker.h>
+#include <ompl_lemur/RootTagMemo.h>
 #include <ompl_lemur/LEMUR.h>
 #include <ompl_lemur/RoadmapHalton.h>
 
@@ -168,6 +171,530 @@ TEST(LemurSimpleTestCase, LemurSimpleTest)
    ASSERT_EQ(1323, space->as<CountingRealVectorStateSpace>()->states_freed);
 }
 
+// same as isvalid, but counts checks (from any thread)
+boost::mutex num_checks_mutex;
+unsigned int num_checks = 0;
+bool isvalid_counting(const ompl::base::State * state)
+{
+   {
+      boost::mutex::scoped_lock lock(num_checks_mutex);
+      num_checks++;
+   }
+   return isvalid(state);
+}
+
+// binary checker which reports a change before every solve,
+// as a family checker does on each target switch
+class ChangingUtilityChecker: public ompl_lemur::BinaryUtilityChecker
+{
+public:
+   ChangingUtilityChecker(const ompl::base::SpaceInformationPtr & si,
+      const ompl::base::StateValidityCheckerPtr & checker, double resolution):
+      ompl_lemur::BinaryUtilityChecker(si, checker, resolution)
+   {
+   }
+   bool hasChanged() { return true; }
+};
+
+// the simple problem's space (checked with isvalid_counting)
+// and a LEMUR planner over its 30-vertex Halton roadmap,
+// for the tests below to configure and query
+struct SimpleProblem
+{
+   ompl::base::StateSpacePtr space;
+   ompl::base::SpaceInformationPtr si;
+   ompl::base::PlannerPtr planner;
+   ompl_lemur::LEMUR * lemur;
+   
+   SimpleProblem(bool changing_checker = false):
+      space(new ompl::base::RealVectorStateSpace(2))
+   {
+      space->as<ompl::base::RealVectorStateSpace>()->setBounds(0.0, 1.0);
+      space->setLongestValidSegmentFraction(
+         0.001 / space->getMaximumExtent());
+      space->setup();
+      
+      si.reset(new ompl::base::SpaceInformation(space));
+      si->setStateValidityChecker(isvalid_counting);
+      if (changing_checker)
+         si->setStateValidityChecker(ompl::base::StateValidityCheckerPtr(
+            new ChangingUtilityChecker(si, si->getStateValidityChecker(),
+               space->getLongestValidSegmentLength())));
+      else
+         si->setStateValidityChecker(ompl::base::StateValidityCheckerPtr(
+            new ompl_lemur::BinaryUtilityChecker(si, si->getStateValidityChecker(),
+               space->getLongestValidSegmentLength())));
+      si->setup();
+      
+      planner.reset(new ompl_lemur::LEMUR(si));
+      lemur = planner->as<ompl_lemur::LEMUR>();
+      lemur->registerRoadmapType<ompl_lemur::RoadmapHalton>("Halton");
+      lemur->setRoadmapType("Halton");
+      planner->params().setParam("roadmap.num", "30");
+      planner->params().setParam("roadmap.radius", "0.3");
+   }
+   
+   // sets a new problem definition from (x1,y1) to (x2,y2)
+   // (by default, the simple problem's query)
+   ompl::base::ProblemDefinitionPtr query(
+      double x1=0.25, double y1=0.75, double x2=0.75, double y2=0.25)
+   {
+      ompl::base::ProblemDefinitionPtr pdef(
+         new ompl::base::ProblemDefinition(si));
+      pdef->addStartState(make_state(space, x1, y1));
+      pdef->setGoalState(make_state(space, x2, y2));
+      planner->setProblemDefinition(pdef);
+      return pdef;
+   }
+   
+   // solves the current problem definition, counting checks
+   ompl::base::PlannerStatus solve(unsigned int & checks)
+   {
+      num_checks = 0;
+      ompl::base::PlannerStatus status = planner->solve(
+         ompl::base::plannerNonTerminatingCondition());
+      checks = num_checks;
+      return status;
+   }
+};
+
+// the states of the solution path (empty if there is none;
+// the planner also reports success without a path
+// once it runs out of batches)
+std::vector< std::pair<double,double> > solution_states(
+   const ompl::base::ProblemDefinitionPtr & pdef)
+{
+   std::vector< std::pair<double,double> > states;
+#ifdef OMPL_LEMUR_HAS_BOOSTSMARTPTRS
+   boost::shared_ptr<ompl::geometric::PathGeometric> path = 
+      boost::dynamic_pointer_cast<ompl::geometric::PathGeometric>(
+      pdef->getSolutionPath());
+#else
+   std::shared_ptr<ompl::geometric::PathGeometric> path = 
+      std::dynamic_pointer_cast<ompl::geometric::PathGeometric>(
+      pdef->getSolutionPath());
+#endif
+   if (!path)
+      return states;
+   for (size_t idx=0; idx<path->getStateCount(); idx++)
+   {
+      ompl::base::ScopedState<ompl::base::RealVectorStateSpace>
+         state = get_path_state(path,idx);
+      states.push_back(std::make_pair(state->values[0], state->values[1]));
+   }
+   return states;
+}
+
+// solves the simple problem with the given selector and threads,
+// returning the solution path states and the number of checks
+// (and of speculative checks)
+std::vector< std::pair<double,double> > solve_counting(
+   std::string eval_type,
+   unsigned int num_eval_threads, unsigned int num_speculative_threads,
+   unsigned int & checks, size_t & speculative_checks)
+{
+   SimpleProblem problem;
+   problem.planner->params().setParam("eval_type", eval_type);
+   problem.lemur->setNumEvalThreads(num_eval_threads);
+   problem.lemur->setNumSpeculativeThreads(num_speculative_threads);
+   
+   ompl::base::ProblemDefinitionPtr pdef = problem.query();
+   ompl::base::PlannerStatus status = problem.solve(checks);
+   speculative_checks
+      = problem.lemur->getNumSpeculativeChecksUseful()
+      + problem.lemur->getNumSpeculativeChecksWasted();
+   if (status != ompl::base::PlannerStatus::EXACT_SOLUTION)
+      return std::vector< std::pair<double,double> >();
+   return solution_states(pdef);
+}
+
+// the interiors of the selected edges are checked on several threads,
+// with the same results as checking them in turn
+TEST(LemurSimpleTestCase, LemurParallelEvalTest)
+{
+   unsigned int checks_serial;
+   size_t speculative_serial;
+   std::vector< std::pair<double,double> > states_serial
+      = solve_counting("all", 1, 0, checks_serial, speculative_serial);
+   unsigned int checks_parallel;
+   size_t speculative_parallel;
+   std::vector< std::pair<double,double> > states_parallel
+      = solve_counting("all", 4, 0, checks_parallel, speculative_parallel);
+   
+   ASSERT_EQ(4, states_serial.size());
+   ASSERT_EQ(0.40625, states_serial[1].first);
+   ASSERT_EQ(14./27., states_serial[1].second);
+   ASSERT_TRUE(states_serial == states_parallel);
+   ASSERT_EQ(checks_serial, checks_parallel);
+   ASSERT_EQ(0, speculative_parallel);
+}
+
+// the remaining edges of the last lazy path are checked in the
+// background during each search; however many of those checks complete
+// (this depends on scheduling), the same path is found
+TEST(LemurSimpleTestCase, LemurSpeculativeEvalTest)
+{
+   unsigned int checks_serial;
+   size_t speculative_serial;
+   std::vector< std::pair<double,double> > states_serial
+      = solve_counting("fwd", 1, 0, checks_serial, speculative_serial);
+   unsigned int checks_speculative;
+   size_t speculative_speculative;
+   std::vector< std::pair<double,double> > states_speculative
+      = solve_counting("fwd", 1, 2, checks_speculative, speculative_speculative);
+   
+   ASSERT_EQ(4, states_serial.size());
+   ASSERT_EQ(0, speculative_serial);
+   ASSERT_TRUE(states_serial == states_speculative);
+   ASSERT_LE(speculative_speculative, checks_speculative);
+}
+
+// the alt selector keeps state between selections; speculation orders
+// the edges on a copy of it, so the same path is found
+TEST(LemurSimpleTestCase, LemurSpeculativeAltEvalTest)
+{
+   unsigned int checks_serial;
+   size_t speculative_serial;
+   std::vector< std::pair<double,double> > states_serial
+      = solve_counting("alt", 1, 0, checks_serial, speculative_serial);
+   unsigned int checks_speculative;
+   size_t speculative_speculative;
+   std::vector< std::pair<double,double> > states_speculative
+      = solve_counting("alt", 1, 2, checks_speculative, speculative_speculative);
+   
+   ASSERT_EQ(4, states_serial.size());
+   ASSERT_EQ(0, speculative_serial);
+   ASSERT_TRUE(states_serial == states_speculative);
+   ASSERT_LE(speculative_speculative, checks_speculative);
+}
+
+// checking the whole path coarse-to-fine finds the same path
+TEST(LemurSimpleTestCase, LemurPathBisectTest)
+{
+   unsigned int checks_fwd;
+   size_t speculative_fwd;
+   std::vector< std::pair<double,double> > states_fwd
+      = solve_counting("fwd", 1, 0, checks_fwd, speculative_fwd);
+   unsigned int checks_path_bisect;
+   size_t speculative_path_bisect;
+   std::vector< std::pair<double,double> > states_path_bisect
+      = solve_counting("path_bisect", 1, 0, checks_path_bisect, speculative_path_bisect);
+   
+   ASSERT_EQ(4, states_path_bisect.size());
+   ASSERT_TRUE(states_fwd == states_path_bisect);
+}
+
+// selecting by estimated failure probability finds the same path
+TEST(LemurSimpleTestCase, LemurFailProbTest)
+{
+   unsigned int checks_fwd;
+   size_t speculative_fwd;
+   std::vector< std::pair<double,double> > states_fwd
+      = solve_counting("fwd", 1, 0, checks_fwd, speculative_fwd);
+   unsigned int checks_failprob;
+   size_t speculative_failprob;
+   std::vector< std::pair<double,double> > states_failprob
+      = solve_counting("failprob", 1, 0, checks_failprob, speculative_failprob);
+   
+   ASSERT_EQ(4, states_failprob.size());
+   ASSERT_TRUE(states_fwd == states_failprob);
+}
+
+// solves the simple problem twice (from fresh roots each time),
+// returning the number of checks performed by the second solve
+unsigned int solve_twice_counting(bool use_memo)
+{
+   SimpleProblem problem;
+   if (use_memo)
+      problem.lemur->_root_tag_memo.reset(new ompl_lemur::RootTagMemo());
+   
+   unsigned int checks = 0;
+   for (unsigned int iquery=0; iquery<2; iquery++)
+   {
+      problem.query();
+      EXPECT_EQ(ompl::base::PlannerStatus::EXACT_SOLUTION, problem.solve(checks));
+   }
+   return checks;
+}
+
+// with the root tag memo, a repeated query re-checks nothing
+TEST(LemurSimpleTestCase, LemurRootTagMemoTest)
+{
+   ASSERT_LT(0u, solve_twice_counting(false));
+   ASSERT_EQ(0u, solve_twice_counting(true));
+}
+
+// after each evaluation, only the incident edges of endpoints
+// whose tags changed are recalculated
+TEST(LemurSimpleTestCase, LemurWLazyRecalcsTest)
+{
+   SimpleProblem problem;
+   problem.planner->params().setParam("eval_type", "fwd");
+   problem.query();
+   unsigned int checks;
+   ASSERT_EQ(ompl::base::PlannerStatus::EXACT_SOLUTION, problem.solve(checks));
+   
+   size_t updates = problem.lemur->getNumWLazyUpdates();
+   size_t recalcs = problem.lemur->getNumWLazyRecalcs();
+   size_t recalcs_full = problem.lemur->getNumWLazyRecalcsFull();
+   ASSERT_LT(0u, updates);
+   ASSERT_LE(updates, recalcs);
+   ASSERT_LT(recalcs, recalcs_full);
+}
+
+// solves the simple problem for several queries with a checker
+// which changes before each, returning the total number of checks
+unsigned int solve_changing_counting(bool defer_w_lazy,
+   unsigned int num_eval_threads,
+   std::vector< std::pair<double,double> > & states)
+{
+   SimpleProblem problem(true);
+   problem.lemur->setCoeffCheckcost(1.);
+   problem.planner->params().setParam("eval_type", "path_bisect");
+   problem.lemur->setNumEvalThreads(num_eval_threads);
+   problem.lemur->setDeferWLazy(defer_w_lazy);
+   
+   const double queries[][4] = {
+      {0.25, 0.75, 0.75, 0.25},
+      {0.75, 0.25, 0.25, 0.75},
+      {0.1, 0.1, 0.9, 0.9}};
+   unsigned int checks_total = 0;
+   states.clear();
+   for (unsigned int iquery=0; iquery<sizeof(queries)/sizeof(queries[0]); iquery++)
+   {
+      ompl::base::ProblemDefinitionPtr pdef = problem.query(
+         queries[iquery][0], queries[iquery][1], queries[iquery][2], queries[iquery][3]);
+      unsigned int checks;
+      ompl::base::PlannerStatus status = problem.solve(checks);
+      checks_total += checks;
+      if (status != ompl::base::PlannerStatus::EXACT_SOLUTION)
+         continue;
+      std::vector< std::pair<double,double> > query_states = solution_states(pdef);
+      states.insert(states.end(), query_states.begin(), query_states.end());
+   }
+   return checks_total;
+}
+
+// recalculating w_lazy on several threads, or when each edge is
+// first used, finds the same paths with the same checks
+TEST(LemurSimpleTestCase, LemurDeferWLazyTest)
+{
+   std::vector< std::pair<double,double> > states_serial;
+   unsigned int checks_serial = solve_changing_counting(false, 1, states_serial);
+   std::vector< std::pair<double,double> > states_parallel;
+   unsigned int checks_parallel = solve_changing_counting(false, 4, states_parallel);
+   std::vector< std::pair<double,double> > states_deferred;
+   unsigned int checks_deferred = solve_changing_counting(true, 1, states_deferred);
+   
+   ASSERT_LT(0u, checks_serial);
+   ASSERT_LT(0u, states_serial.size());
+   ASSERT_TRUE(states_serial == states_parallel);
+   ASSERT_EQ(checks_serial, checks_parallel);
+   ASSERT_TRUE(states_serial == states_deferred);
+   ASSERT_EQ(checks_serial, checks_deferred);
+}
+
+// tag cache which keeps the most recently saved tags in memory,
+// and counts the saves
+class RecordingTagCache: public ompl_lemur::TagCache<
+   ompl_lemur::LEMUR::VIdxTagMap,ompl_lemur::LEMUR::EIdxTagsMap>
+{
+public:
+   unsigned int num_saves;
+   std::vector<size_t> v_tags;
+   std::vector<size_t> e_tags;
+   RecordingTagCache(): num_saves(0) {}
+   bool hasChanged() { return false; }
+   void loadBegin() {}
+   void loadBatch(size_t batch,
+      ompl_lemur::LEMUR::VIdxTagMap v_tag_map, size_t v_from, size_t v_to,
+      ompl_lemur::LEMUR::EIdxTagsMap e_tag_map, size_t e_from, size_t e_to)
+   {
+   }
+   void loadEnd() {}
+   void saveBegin()
+   {
+      num_saves++;
+      v_tags.clear();
+      e_tags.clear();
+   }
+   void saveBatch(size_t batch,
+      ompl_lemur::LEMUR::VIdxTagMap v_tag_map, size_t v_from, size_t v_to,
+      ompl_lemur::LEMUR::EIdxTagsMap e_tag_map, size_t e_from, size_t e_to)
+   {
+      for (size_t v_index=v_from; v_index<v_to; v_index++)
+         v_tags.push_back(v_tag_map[v_index]);
+      for (size_t e_index=e_from; e_index<e_to; e_index++)
+         e_tags.push_back(e_tag_map[e_index]);
+   }
+   void saveEnd() {}
+};
+
+// evaluates the first batch of the simple problem's roadmap
+// with solve_all, returning the saved tag cache
+boost::shared_ptr<RecordingTagCache> solve_all_recording(
+   unsigned int num_eval_threads, unsigned int solve_all_checkpoint,
+   std::string solve_all_shard = "0/1")
+{
+   SimpleProblem problem;
+   problem.lemur->setSolveAll(true);
+   problem.lemur->setMaxBatches(1);
+   problem.lemur->setNumEvalThreads(num_eval_threads);
+   problem.lemur->setSolveAllCheckpoint(solve_all_checkpoint);
+   problem.lemur->setSolveAllShard(solve_all_shard);
+   boost::shared_ptr<RecordingTagCache> tag_cache(new RecordingTagCache());
+   problem.lemur->_tag_cache = tag_cache;
+   
+   problem.planner->setProblemDefinition(ompl::base::ProblemDefinitionPtr(
+      new ompl::base::ProblemDefinition(problem.si)));
+   problem.planner->solve(ompl::base::plannerNonTerminatingCondition());
+   if (!solve_all_checkpoint)
+      problem.lemur->saveTagCache();
+   return tag_cache;
+}
+
+// solve_all on several threads, with checkpoints,
+// saves the same tags as a serial run
+TEST(LemurSimpleTestCase, LemurSolveAllTest)
+{
+   boost::shared_ptr<RecordingTagCache> serial = solve_all_recording(1, 0);
+   boost::shared_ptr<RecordingTagCache> parallel = solve_all_recording(4, 1);
+   
+   ASSERT_EQ(30, serial->v_tags.size());
+   ASSERT_LT(0u, serial->e_tags.size());
+   ASSERT_TRUE(serial->v_tags == parallel->v_tags);
+   ASSERT_TRUE(serial->e_tags == parallel->e_tags);
+   
+   // a checkpoint after the vertices and after the only chunk of edges
+   ASSERT_EQ(1u, serial->num_saves);
+   ASSERT_EQ(2u, parallel->num_saves);
+}
+
+// merging the tags saved by each solve_all shard
+// gives the tags of an unsharded run
+TEST(LemurSimpleTestCase, LemurSolveAllShardTest)
+{
+   boost::shared_ptr<RecordingTagCache> full = solve_all_recording(1, 0);
+   std::vector<size_t> v_merged(full->v_tags.size(), 0);
+   std::vector<size_t> e_merged(full->e_tags.size(), 0);
+   const char * shards[] = {"0/3", "1/3", "2/3"};
+   for (unsigned int ui=0; ui<sizeof(shards)/sizeof(shards[0]); ui++)
+   {
+      boost::shared_ptr<RecordingTagCache> shard = solve_all_recording(1, 0, shards[ui]);
+      ASSERT_EQ(full->v_tags.size(), shard->v_tags.size());
+      ASSERT_EQ(full->e_tags.size(), shard->e_tags.size());
+      for (size_t i=0; i<shard->v_tags.size(); i++)
+      {
+         if (!shard->v_tags[i])
+            continue;
+         ASSERT_TRUE(!v_merged[i] || v_merged[i] == shard->v_tags[i]);
+         v_merged[i] = shard->v_tags[i];
+      }
+      for (size_t i=0; i<shard->e_tags.size(); i++)
+      {
+         if (!shard->e_tags[i])
+            continue;
+         ASSERT_TRUE(!e_merged[i] || e_merged[i] == shard->e_tags[i]);
+         e_merged[i] = shard->e_tags[i];
+      }
+   }
+   ASSERT_TRUE(full->v_tags == v_merged);
+   ASSERT_TRUE(full->e_tags == e_merged);
+   
+   ASSERT_THROW(solve_all_recording(1, 0, "3/3"), std::runtime_error);
+}
+
+// termination condition which is met on its num_calls_cancel'th call
+struct terminate_after
+{
+   unsigned int * num_calls;
+   unsigned int num_calls_cancel;
+   terminate_after(unsigned int * num_calls, unsigned int num_calls_cancel):
+      num_calls(num_calls), num_calls_cancel(num_calls_cancel)
+   {
+   }
+   bool operator()()
+   {
+      return num_calls_cancel <= ++(*num_calls);
+   }
+};
+
+// a solve which times out between lazysp iterations keeps its
+// evaluations, so that the next solve finds the same path as an
+// uninterrupted one with the same total number of checks
+TEST(LemurSimpleTestCase, LemurCancelTest)
+{
+   unsigned int checks_uninterrupted;
+   size_t speculative;
+   std::vector< std::pair<double,double> > states_uninterrupted
+      = solve_counting("fwd", 1, 0, checks_uninterrupted, speculative);
+   
+   SimpleProblem problem;
+   problem.planner->params().setParam("eval_type", "fwd");
+   ompl::base::ProblemDefinitionPtr pdef = problem.query();
+   
+   // the batch loop and each lazysp iteration call it once;
+   // the roots alone have no path (calls 1-2), then the first batch
+   // is searched, with edges evaluated in two lazysp iterations
+   // (calls 3-5), after which the next iteration is interrupted
+   num_checks = 0;
+   unsigned int num_calls = 0;
+   ompl::base::PlannerStatus status = problem.planner->solve(
+      ompl::base::PlannerTerminationCondition(terminate_after(&num_calls, 6)));
+   ASSERT_EQ(ompl::base::PlannerStatus::TIMEOUT, status);
+   ASSERT_EQ(6u, num_calls);
+   ASSERT_FALSE(pdef->getSolutionPath());
+   unsigned int checks_interrupted = num_checks;
+   ASSERT_LT(0u, checks_interrupted);
+   
+   unsigned int checks;
+   ASSERT_EQ(ompl::base::PlannerStatus::EXACT_SOLUTION, problem.solve(checks));
+   ASSERT_LT(0u, checks);
+   ASSERT_EQ(checks_uninterrupted, checks_interrupted + checks);
+   ASSERT_TRUE(states_uninterrupted == solution_states(pdef));
+}
+
+// solves the simple problem with the given inner search,
+// returning the solution path length and the number of
+// inner search expansions
+double solve_landmarks(std::string search_type,
+   unsigned int num_landmarks, size_t & expansions)
+{
+   SimpleProblem problem;
+   problem.planner->params().setParam("eval_type", "fwd");
+   problem.planner->params().setParam("search_type", search_type);
+   problem.lemur->setSearchNumLandmarks(num_landmarks);
+   ompl::base::ProblemDefinitionPtr pdef = problem.query();
+   unsigned int checks;
+   EXPECT_EQ(ompl::base::PlannerStatus::EXACT_SOLUTION, problem.solve(checks));
+   expansions = problem.lemur->getNumSearchExpansions();
+   std::vector< std::pair<double,double> > states = solution_states(pdef);
+   double length = 0.0;
+   for (unsigned int ui=1; ui<states.size(); ui++)
+      length += sqrt(pow(states[ui].first - states[ui-1].first, 2.)
+         + pow(states[ui].second - states[ui-1].second, 2.));
+   return length;
+}
+
+// landmark (alt) heuristics find a path as short as the plain
+// distance heuristic, without expanding more vertices
+TEST(LemurSimpleTestCase, LemurLandmarksTest)
+{
+   const char * search_types[] = {"astar", "lpastar", "rlpastar"};
+   for (unsigned int ui=0; ui<sizeof(search_types)/sizeof(search_types[0]); ui++)
+   {
+      size_t expansions_plain;
+      double length_plain = solve_landmarks(search_types[ui], 0, expansions_plain);
+      size_t expansions_landmarks;
+      double length_landmarks = solve_landmarks(search_types[ui], 4, expansions_landmarks);
+      
+      ASSERT_LT(0.0, length_plain);
+      ASSERT_NEAR(length_plain, length_landmarks, 1.0e-9);
+      ASSERT_LT(0u, expansions_landmarks);
+      ASSERT_LE(expansions_landmarks, expansions_plain);
+   }
+}
+
 int main(int argc, char **argv)
 {
    testing::InitGoogleTest(&argc, argv);
@@ -25,11 +25,25 @@ public:
    bool has_family_setcaches;
    std::vector< SetCache > family_setcaches;
    
+   // file of the family checker's belief states and policies
+   // (loaded when the family is created, if it exists)
+   bool has_family_tables;
+   std::string family_tables;
+   
+   // whether the family checker computes the policies of all belief
+   // states in one search when the target set changes
+   bool has_precompute_policies;
+   bool precompute_policies;
+   
    FamilyParameters():
-      has_family_module(false)
+      has_family_module(false),
+      has_family_tables(false),
+      has_precompute_policies(false)
    {
       _vXMLParameters.push_back("family_module");
       _vXMLParameters.push_back("family_setcaches");
+      _vXMLParameters.push_back("family_tables");
+      _vXMLParameters.push_back("precompute_policies");
    }
    
 private:
@@ -56,6 +70,10 @@ protected:
          }
          sout << "</family_setcaches>";
       }
+      if (has_family_tables)
+         sout << "<family_tables>" << family_tables << "</family_tables>";
+      if (has_precompute_policies)
+         sout << "<precompute_policies>" << (precompute_policies?"true":"false") << "</precompute_policies>";
       return !!sout;
    }
    
@@ -66,7 +84,9 @@ protected:
       if (family_path == "")
       {
          if (name == "family_module"
-            || name == "family_setcaches")
+            || name == "family_setcaches"
+            || name == "family_tables"
+            || name == "precompute_policies")
          {
             family_path = name;
             ret = PE_Support;
@@ -114,6 +134,23 @@ protected:
          family_path = "";
          return false;
       }
+      if (family_path == "family_tables")
+      {
+         family_tables = _ss.str();
+         has_family_tables = true;
+         family_path = "";
+         return false;
+      }
+      if (family_path == "precompute_policies")
+      {
+         std::ios state(0);
+         state.copyfmt(_ss);
+         _ss >> std::boolalpha >> precompute_policies;
+         _ss.copyfmt(state);
+         has_precompute_policies = true;
+         family_path = "";
+         return false;
+      }
       if (family_path == "family_setcaches/setcache/name")
       {
          if (name != "name")
@@ -69,12 +69,27 @@ public:
    bool has_search_incbi_balancer_goalfrac;
    double search_incbi_balancer_goalfrac;
    
+   bool has_search_incbi_parallel;
+   bool search_incbi_parallel;
+   
+   bool has_search_num_landmarks;
+   unsigned int search_num_landmarks;
+   
+   bool has_search_epsilon;
+   double search_epsilon;
+   
    bool has_eval_type;
    std::string eval_type;
    
    bool has_solve_all;
    bool solve_all;
    
+   bool has_solve_all_shard;
+   std::string solve_all_shard;
+   
+   bool has_defer_w_lazy;
+   bool defer_w_lazy;
+   
    bool has_do_baked;
    bool do_baked;
    
@@ -97,8 +112,13 @@ public:
       has_search_incbi_heur_interp(false),
       has_search_incbi_balancer_type(false),
       has_search_incbi_balancer_goalfrac(false),
+      has_search_incbi_parallel(false),
+      has_search_num_landmarks(false),
+      has_search_epsilon(false),
       has_eval_type(false),
       has_solve_all(false),
+      has_solve_all_shard(false),
+      has_defer_w_lazy(false),
       has_do_baked(false)
    {
       // top-level tags we can process
@@ -121,8 +141,13 @@ public:
       _vXMLParameters.push_back("search_incbi_heur_interp");
       _vXMLParameters.push_back("search_incbi_balancer_type");
       _vXMLParameters.push_back("search_incbi_balancer_goalfrac");
+      _vXMLParameters.push_back("search_incbi_parallel");
+      _vXMLParameters.push_back("search_num_landmarks");
+      _vXMLParameters.push_back("search_epsilon");
       _vXMLParameters.push_back("eval_type");
       _vXMLParameters.push_back("solve_all");
+      _vXMLParameters.push_back("solve_all_shard");
+      _vXMLParameters.push_back("defer_w_lazy");
       _vXMLParameters.push_back("do_baked");
    }
    
@@ -176,10 +201,20 @@ protected:
          sout << "<search_incbi_balancer_type>" << search_incbi_balancer_type << "</search_incbi_balancer_type>";
       if (has_search_incbi_balancer_goalfrac)
          sout << "<search_incbi_balancer_goalfrac>" << search_incbi_balancer_goalfrac << "</search_incbi_balancer_goalfrac>";
+      if (has_search_incbi_parallel)
+         sout << "<search_incbi_parallel>" << (search_incbi_parallel?"true":"false") << "</search_incbi_parallel>";
+      if (has_search_num_landmarks)
+         sout << "<search_num_landmarks>" << search_num_landmarks << "</search_num_landmarks>";
+      if (has_search_epsilon)
+         sout << "<search_epsilon>" << search_epsilon << "</search_epsilon>";
       if (has_eval_type)
          sout << "<eval_type>" << eval_type << "</eval_type>";
       if (has_solve_all)
          sout << "<solve_all>" << (solve_all?"true":"false") << "</solve_all>";
+      if (has_solve_all_shard)
+         sout << "<solve_all_shard>" << solve_all_shard << "</solve_all_shard>";
+      if (has_defer_w_lazy)
+         sout << "<defer_w_lazy>" << (defer_w_lazy?"true":"false") << "</defer_w_lazy>";
       if (has_do_baked)
          sout << "<do_baked>" << (do_baked?"true":"false") << "</do_baked>";
       return !!sout;
@@ -214,8 +249,13 @@ protected:
          || name == "search_incbi_heur_interp"
          || name == "search_incbi_balancer_type"
          || name == "search_incbi_balancer_goalfrac"
+         || name == "search_incbi_parallel"
+         || name == "search_num_landmarks"
+         || name == "search_epsilon"
          || name == "eval_type"
          || name == "solve_all"
+         || name == "solve_all_shard"
+         || name == "defer_w_lazy"
          || name == "do_baked")
       {
          lemur_deserializing = name;
@@ -343,6 +383,24 @@ protected:
             _ss >> search_incbi_balancer_goalfrac;
             has_search_incbi_balancer_goalfrac = true;
          }
+         if (lemur_deserializing == "search_incbi_parallel")
+         {
+            std::ios state(0);
+            state.copyfmt(_ss);
+            _ss >> std::boolalpha >> search_incbi_parallel;
+            _ss.copyfmt(state);
+            has_search_incbi_parallel = true;
+         }
+         if (lemur_deserializing == "search_num_landmarks")
+         {
+            _ss >> search_num_landmarks;
+            has_search_num_landmarks = true;
+         }
+         if (lemur_deserializing == "search_epsilon")
+         {
+            _ss >> search_epsilon;
+            has_search_epsilon = true;
+         }
          if (lemur_deserializing == "eval_type")
          {
             eval_type = _ss.str();
@@ -356,6 +414,19 @@ protected:
             _ss.copyfmt(state);
             has_solve_all = true;
          }
+         if (lemur_deserializing == "solve_all_shard")
+         {
+            solve_all_shard = _ss.str();
+            has_solve_all_shard = true;
+         }
+         if (lemur_deserializing == "defer_w_lazy")
+         {
+            std::ios state(0);
+            state.copyfmt(_ss);
+            _ss >> std::boolalpha >> defer_w_lazy;
+            _ss.copyfmt(state);
+            has_defer_w_lazy = true;
+         }
          if (lemur_deserializing == "do_baked")
          {
             std::ios state(0);
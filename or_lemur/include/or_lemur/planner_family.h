@@ -75,6 +75,8 @@ public:
       boost::shared_ptr<ompl_lemur::LEMUR> ompl_lemur;
       // roadmap header (known once planner initializes)
       std::string roadmap_header;
+      // family checker tables file (from params, may be empty)
+      std::string tables_filename;
       
       // put this here for now
       FamilyParametersConstPtr params_last;
@@ -26,6 +26,11 @@ def rr_get_filename(url):
 #     --roadmap-type=HaltonOffDens --roadmap-param=num_per_batch=1000
 #     --roadmap-param=radius_first_batch=2.0 --roadmap-param=seed=0
 #     --num-batches=1 --setcache=setcache-Self.txt
+#
+# to split the work across processes, run each shard k of n
+# with --shard=k/n --setcache=setcache-Self-k.txt, and then:
+# $ rosrun ompl_lemur merge-tag-caches
+#     --in-file=setcache-Self-0.txt ... --out-file=setcache-Self.txt
 
 parser = argparse.ArgumentParser(description='family self setcache')
 parser.add_argument('--robot-xml') # e.g. barrettwam.robot.xml
@@ -37,6 +42,7 @@ parser.add_argument('--roadmap-type', required=True)
 parser.add_argument('--roadmap-param', action='append') # values name=value
 parser.add_argument('--num-batches', type=int, required=True)
 parser.add_argument('--setcache', required=True)
+parser.add_argument('--shard') # e.g. 0/4
 args = parser.parse_args()
 
 # load environment
@@ -114,6 +120,8 @@ for kv in args.roadmap_param:
    paramsxml.append('<roadmap_param>{}</roadmap_param>'.format(kv))
 paramsxml.append('<max_batches>{}</max_batches>'.format(args.num_batches))
 paramsxml.append('<solve_all>true</solve_all>')
+if args.shard is not None:
+   paramsxml.append('<solve_all_shard>{}</solve_all_shard>'.format(args.shard))
 paramsxml.append('<family_module>{}</family_module>'.format(family.SendCommand('GetInstanceId')))
 paramsxml.append('<family_setcaches><setcache><name>Self</name><filename>{}</filename></setcache></family_setcaches>'.format(args.setcache))
 paramsstr = '\n'.join(paramsxml)
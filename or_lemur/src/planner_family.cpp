@@ -4,14 +4,19 @@
  * \copyright License: BSD
  */
 
+#include <stdint.h>
+
 #include <openrave/openrave.h>
 #include <openrave/utils.h>
 
 #include <boost/chrono.hpp>
+#include <boost/function.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graphml.hpp>
 #include <boost/property_map/dynamic_property_map.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <ompl/base/State.h>
 #include <ompl/base/StateSpace.h>
@@ -28,6 +33,7 @@
 #include <pr_bgl/compose_property_map.hpp>
 #include <pr_bgl/vector_ref_property_map.h>
 #include <pr_bgl/edge_indexed_graph.h>
+#include <pr_bgl/cancel_poll.h>
 #include <pr_bgl/overlay_manager.h>
 #include <pr_bgl/string_map.h>
 #include <pr_bgl/heap_indexed.h>
@@ -38,6 +44,7 @@
 #include <ompl_lemur/TagCache.h>
 #include <ompl_lemur/Family.h>
 #include <ompl_lemur/UtilityChecker.h>
+#include <ompl_lemur/RootTagMemo.h>
 #include <ompl_lemur/FamilyUtilityChecker.h>
 #include <ompl_lemur/FamilyTagCache.h>
 #include <ompl_lemur/SpaceID.h>
@@ -308,6 +315,15 @@ or_lemur::FamilyPlanner::InitPlan(OpenRAVE::RobotBasePtr robot, OpenRAVE::Planne
       fam->ompl_family_checker.reset(new ompl_lemur::FamilyUtilityChecker(
          fam->ompl_si.get(), *fam->ompl_family));
       
+      // load its belief states and policies from an earlier run
+      // (before any tags are assigned, so tag numbering is the same)
+      if (params->has_family_tables)
+      {
+         fam->tables_filename = params->family_tables;
+         if (boost::filesystem::exists(fam->tables_filename))
+            fam->ompl_family_checker->load_tables(fam->tables_filename);
+      }
+      
       fam->ompl_si->setStateValidityChecker(
          ompl::base::StateValidityCheckerPtr(fam->ompl_family_checker));
       fam->ompl_si->setup();
@@ -421,6 +437,10 @@ or_lemur::FamilyPlanner::InitPlan(OpenRAVE::RobotBasePtr robot, OpenRAVE::Planne
       _current_family->ompl_lemur->setMaxBatches(params->max_batches);
    if (params->has_solve_all)
       _current_family->ompl_lemur->setSolveAll(params->solve_all);
+   if (params->has_solve_all_shard)
+      _current_family->ompl_lemur->setSolveAllShard(params->solve_all_shard);
+   if (params->has_defer_w_lazy)
+      _current_family->ompl_lemur->setDeferWLazy(params->defer_w_lazy);
    if (params->has_search_type)
       _current_family->ompl_lemur->setSearchType(params->search_type);
    if (params->has_search_incbi_heur_interp)
@@ -429,8 +449,16 @@ or_lemur::FamilyPlanner::InitPlan(OpenRAVE::RobotBasePtr robot, OpenRAVE::Planne
       _current_family->ompl_lemur->setSearchIncbiBalancerType(params->search_incbi_balancer_type);
    if (params->has_search_incbi_balancer_goalfrac)
       _current_family->ompl_lemur->setSearchIncbiBalancerGoalfrac(params->search_incbi_balancer_goalfrac);
+   if (params->has_search_incbi_parallel)
+      _current_family->ompl_lemur->setSearchIncbiParallel(params->search_incbi_parallel);
+   if (params->has_search_num_landmarks)
+      _current_family->ompl_lemur->setSearchNumLandmarks(params->search_num_landmarks);
+   if (params->has_search_epsilon)
+      _current_family->ompl_lemur->setSearchEpsilon(params->search_epsilon);
    if (params->has_eval_type)
       _current_family->ompl_lemur->setEvalType(params->eval_type);
+   if (params->has_precompute_policies)
+      _current_family->ompl_family_checker->set_precompute_policies(params->precompute_policies);
    
    // reset current set
    _current_family->set_current = mod_family->GetCurrentSet();
@@ -643,6 +671,9 @@ bool or_lemur::FamilyPlanner::CmdSaveSetCaches(std::ostream & sout, std::istream
    
    fam->ompl_lemur->saveTagCache();
    
+   if (fam->tables_filename.size())
+      fam->ompl_family_checker->save_tables(fam->tables_filename);
+   
    return true;
 }
 
@@ -680,5 +711,9 @@ bool or_lemur::FamilyPlanner::CmdGetTimes(std::ostream & sout, std::istream & si
    sout << " dur_selector_init " <<  fam->ompl_lemur->getDurSelectorInit();
    sout << " dur_selector " <<  fam->ompl_lemur->getDurSelector();
    sout << " dur_selector_notify " <<  fam->ompl_lemur->getDurSelectorNotify();
+   sout << " solution_suboptimality " <<  fam->ompl_lemur->getSolutionSuboptimality();
+   sout << " n_wlazy_updates " <<  fam->ompl_lemur->getNumWLazyUpdates();
+   sout << " n_wlazy_recalcs " <<  fam->ompl_lemur->getNumWLazyRecalcs();
+   sout << " n_wlazy_recalcs_full " <<  fam->ompl_lemur->getNumWLazyRecalcsFull();
    return true;
 }
@@ -8,6 +8,7 @@
 #include <openrave/utils.h>
 
 #include <boost/chrono.hpp>
+#include <boost/function.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graphml.hpp>
@@ -28,6 +29,7 @@
 #include <pr_bgl/compose_property_map.hpp>
 #include <pr_bgl/vector_ref_property_map.h>
 #include <pr_bgl/edge_indexed_graph.h>
+#include <pr_bgl/cancel_poll.h>
 #include <pr_bgl/overlay_manager.h>
 #include <pr_bgl/string_map.h>
 #include <pr_bgl/heap_indexed.h>
@@ -37,6 +39,7 @@
 #include <ompl_lemur/rvstate_map_string_adaptor.h>
 #include <ompl_lemur/TagCache.h>
 #include <ompl_lemur/UtilityChecker.h>
+#include <ompl_lemur/RootTagMemo.h>
 #include <ompl_lemur/SpaceID.h>
 #include <ompl_lemur/SamplerGenMonkeyPatch.h>
 #include <ompl_lemur/NearestNeighborsLinearBGL.h>
@@ -191,6 +194,10 @@ or_lemur::LEMUR::InitPlan(OpenRAVE::RobotBasePtr inrobot, OpenRAVE::PlannerBase:
       ompl_planner->setMaxBatches(params->max_batches);
    if (params->has_solve_all)
       ompl_planner->setSolveAll(params->solve_all);
+   if (params->has_solve_all_shard)
+      ompl_planner->setSolveAllShard(params->solve_all_shard);
+   if (params->has_defer_w_lazy)
+      ompl_planner->setDeferWLazy(params->defer_w_lazy);
    if (params->has_search_type)
       ompl_planner->setSearchType(params->search_type);
    if (params->has_search_incbi_heur_interp)
@@ -199,6 +206,12 @@ or_lemur::LEMUR::InitPlan(OpenRAVE::RobotBasePtr inrobot, OpenRAVE::PlannerBase:
       ompl_planner->setSearchIncbiBalancerType(params->search_incbi_balancer_type);
    if (params->has_search_incbi_balancer_goalfrac)
       ompl_planner->setSearchIncbiBalancerGoalfrac(params->search_incbi_balancer_goalfrac);
+   if (params->has_search_incbi_parallel)
+      ompl_planner->setSearchIncbiParallel(params->search_incbi_parallel);
+   if (params->has_search_num_landmarks)
+      ompl_planner->setSearchNumLandmarks(params->search_num_landmarks);
+   if (params->has_search_epsilon)
+      ompl_planner->setSearchEpsilon(params->search_epsilon);
    if (params->has_eval_type)
       ompl_planner->setEvalType(params->eval_type);
    
@@ -325,5 +338,9 @@ bool or_lemur::LEMUR::GetTimes(std::ostream & sout, std::istream & sin) const
    sout << " dur_selector_init " <<  ompl_planner->as<ompl_lemur::LEMUR>()->getDurSelectorInit();
    sout << " dur_selector " <<  ompl_planner->as<ompl_lemur::LEMUR>()->getDurSelector();
    sout << " dur_selector_notify " <<  ompl_planner->as<ompl_lemur::LEMUR>()->getDurSelectorNotify();
+   sout << " solution_suboptimality " <<  ompl_planner->as<ompl_lemur::LEMUR>()->getSolutionSuboptimality();
+   sout << " n_wlazy_updates " <<  ompl_planner->as<ompl_lemur::LEMUR>()->getNumWLazyUpdates();
+   sout << " n_wlazy_recalcs " <<  ompl_planner->as<ompl_lemur::LEMUR>()->getNumWLazyRecalcs();
+   sout << " n_wlazy_recalcs_full " <<  ompl_planner->as<ompl_lemur::LEMUR>()->getNumWLazyRecalcsFull();
    return true;
 }
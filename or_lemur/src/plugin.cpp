@@ -5,9 +5,13 @@
  */
 
 #include <algorithm>
+#include <stdint.h>
 
 #include <boost/chrono.hpp>
+#include <boost/function.hpp>
 #include <boost/graph/adjacency_list.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <openrave/openrave.h>
 #include <openrave/plugin.h>
@@ -23,6 +27,7 @@
 #include <pr_bgl/compose_property_map.hpp>
 #include <pr_bgl/vector_ref_property_map.h>
 #include <pr_bgl/edge_indexed_graph.h>
+#include <pr_bgl/cancel_poll.h>
 #include <pr_bgl/overlay_manager.h>
 #include <pr_bgl/string_map.h>
 #include <pr_bgl/heap_indexed.h>
@@ -33,6 +38,7 @@
 #include <ompl_lemur/Roadmap.h>
 #include <ompl_lemur/TagCache.h>
 #include <ompl_lemur/UtilityChecker.h>
+#include <ompl_lemur/RootTagMemo.h>
 #include <ompl_lemur/LEMUR.h>
 #include <ompl_lemur/Family.h>
 #include <ompl_lemur/FamilyUtilityChecker.h>
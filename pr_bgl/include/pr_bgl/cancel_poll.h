@@ -0,0 +1,82 @@
+/*! \file cancel_poll.h
+ * \author Chris Dellin <cdellin@gmail.com>
+ * \copyright 2015 Carnegie Mellon University
+ * \copyright License: BSD
+ *
+ * \brief Contains pr_bgl::cancel_poll.
+ */
+
+namespace pr_bgl
+{
+
+/*! \brief Polls a cancellation predicate from within a search.
+ *
+ * The cancel_poll class wraps a nullary predicate (e.g. an
+ * ompl::base::PlannerTerminationCondition).  poll() is meant to be
+ * called once per unit of work (e.g. each heap pop), and calls the
+ * predicate only once every interval calls; once the predicate has
+ * returned true, poll() and cancelled() keep returning true.
+ * num_polls() counts the calls to poll() (e.g. vertex expansions).
+ * A default-constructed instance never cancels.
+ *
+ * Searches which accept a cancel_poll stop only at points where their
+ * state is consistent, so that they can be resumed later.
+ * The instance is not thread-safe; concurrent searches must poll it
+ * under a common lock.
+ */
+class cancel_poll
+{
+public:
+   
+   cancel_poll():
+      _interval(1), _count(0), _num_polls(0), _cancelled(false)
+   {
+   }
+   
+   cancel_poll(boost::function<bool ()> pred, unsigned int interval = 1):
+      _pred(pred), _interval(interval ? interval : 1),
+      _count(0), _num_polls(0), _cancelled(false)
+   {
+   }
+   
+   inline bool poll()
+   {
+      _num_polls++;
+      if (_cancelled)
+         return true;
+      if (!_pred)
+         return false;
+      if (++_count < _interval)
+         return false;
+      _count = 0;
+      _cancelled = _pred();
+      return _cancelled;
+   }
+   
+   // calls the predicate regardless of the interval
+   inline bool check()
+   {
+      if (!_cancelled && _pred)
+         _cancelled = _pred();
+      return _cancelled;
+   }
+   
+   inline bool cancelled() const
+   {
+      return _cancelled;
+   }
+   
+   inline unsigned long num_polls() const
+   {
+      return _num_polls;
+   }
+   
+private:
+   boost::function<bool ()> _pred;
+   unsigned int _interval;
+   unsigned int _count;
+   unsigned long _num_polls;
+   bool _cancelled;
+};
+
+} // namespace pr_bgl
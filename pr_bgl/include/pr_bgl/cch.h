@@ -0,0 +1,562 @@
+/*! \file cch.h
+ * \author Chris Dellin <cdellin@gmail.com>
+ * \copyright 2015 Carnegie Mellon University
+ * \copyright License: BSD
+ * 
+ * \brief Contains pr_bgl::cch, a customizable contraction hierarchy.
+ */
+
+namespace pr_bgl
+{
+
+/*! \brief Customizable contraction hierarchy over an undirected graph.
+ * 
+ * Implements the three phases of:
+ * 
+ * Julian Dibbelt, Ben Strasser, and Dorothea Wagner. 2016.
+ * Customizable Contraction Hierarchies. J. Exp. Algorithmics 21, 1.
+ * 
+ * The metric-independent phase (the constructor) computes a nested
+ * dissection order (by recursive breadth-first bisection, since no
+ * vertex coordinates are available) and its chordal shortcut graph.
+ * customize() then computes all shortcut weights from w_map;
+ * after the weights of a few edges change, update_edge() and
+ * recustomize() repair only the shortcuts which depend on them.
+ * Queries walk the elimination tree, without a priority queue.
+ * 
+ * All neighbors are found via out_edges(), and edge weights
+ * are assumed symmetric.
+ * Vertices and arcs are addressed by rank internally.
+ */
+template <class Graph, class WeightMap,
+   typename CompareFunction, typename CombineFunction>
+class cch
+{
+public:
+   typedef typename boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef typename boost::graph_traits<Graph>::edge_descriptor Edge;
+   typedef typename boost::graph_traits<Graph>::out_edge_iterator OutEdgeIter;
+   typedef typename boost::property_traits<WeightMap>::value_type weight_type;
+   
+   const Graph & g;
+   WeightMap w_map;
+   CompareFunction compare;
+   CombineFunction combine;
+   weight_type inf;
+   weight_type zero;
+   size_t none;
+   
+   // parts no larger than this are not dissected further
+   size_t leaf_size;
+   
+   // nested dissection order
+   std::vector<size_t> rank; // by vertex index
+   std::vector<Vertex> vertex_at; // by rank
+   std::vector<size_t> parent; // elimination tree, by rank
+   
+   // upward arcs (by tail rank, sorted by head rank)
+   std::vector<size_t> up_first;
+   std::vector<size_t> arc_head;
+   std::vector<size_t> arc_tail;
+   
+   // downward arcs (by head rank, sorted by tail rank)
+   std::vector<size_t> down_first;
+   std::vector<size_t> down_arc;
+   
+   // original edges underlying each arc
+   std::vector<size_t> arc_edges_first;
+   std::vector<Edge> arc_edges;
+   
+   // metric
+   std::vector<weight_type> arc_weight;
+   std::vector<size_t> arc_mid; // lower triangle vertex, or none
+   std::vector<size_t> arc_edge_best; // cheapest of arc_edges, or none
+   
+   // arcs awaiting recustomization, keyed by tail rank
+   heap_indexed<size_t> queue;
+   
+   // query scratch space (by rank)
+   std::vector<weight_type> dist_s;
+   std::vector<weight_type> dist_t;
+   std::vector<size_t> pred_s;
+   std::vector<size_t> pred_t;
+   std::vector<size_t> anc_s;
+   std::vector<size_t> anc_t;
+   std::vector<size_t> anc_s_stamp;
+   size_t stamp;
+   
+   cch(const Graph & g, WeightMap w_map,
+      CompareFunction compare, CombineFunction combine,
+      weight_type inf, weight_type zero,
+      size_t leaf_size = 4):
+      g(g), w_map(w_map),
+      compare(compare), combine(combine),
+      inf(inf), zero(zero),
+      none(std::numeric_limits<size_t>::max()),
+      leaf_size(leaf_size),
+      stamp(0)
+   {
+      size_t n = num_vertices(g);
+      
+      // gather undirected adjacency (by vertex index)
+      std::vector<size_t> adj_first(n+1, 0);
+      std::vector<size_t> adj;
+      for (size_t vi=0; vi<n; vi++)
+      {
+         OutEdgeIter ei, ei_end;
+         for (boost::tie(ei,ei_end)=out_edges(vertex(vi,g),g); ei!=ei_end; ++ei)
+         {
+            size_t ui = get(get(boost::vertex_index,g), target(*ei,g));
+            if (ui != vi)
+               adj.push_back(ui);
+         }
+         adj_first[vi+1] = adj.size();
+      }
+      
+      compute_order(adj_first, adj);
+      
+      // eliminate vertices in rank order, collecting the
+      // upward neighbors (in rank space) of each
+      std::vector< std::vector<size_t> > ups(n);
+      for (size_t vi=0; vi<n; vi++)
+         for (size_t ai=adj_first[vi]; ai<adj_first[vi+1]; ai++)
+            if (rank[vi] < rank[adj[ai]])
+               ups[rank[vi]].push_back(rank[adj[ai]]);
+      std::vector<size_t> merged;
+      parent.resize(n, none);
+      for (size_t r=0; r<n; r++)
+      {
+         std::sort(ups[r].begin(), ups[r].end());
+         ups[r].erase(std::unique(ups[r].begin(), ups[r].end()), ups[r].end());
+         if (!ups[r].size())
+            continue;
+         size_t p = ups[r][0];
+         parent[r] = p;
+         // the remaining upward neighbors become neighbors of p
+         std::sort(ups[p].begin(), ups[p].end());
+         merged.clear();
+         std::set_union(ups[p].begin(), ups[p].end(),
+            ups[r].begin()+1, ups[r].end(), std::back_inserter(merged));
+         ups[p].swap(merged);
+      }
+      
+      // upward arcs
+      up_first.resize(n+1, 0);
+      for (size_t r=0; r<n; r++)
+      {
+         for (size_t ui=0; ui<ups[r].size(); ui++)
+         {
+            arc_head.push_back(ups[r][ui]);
+            arc_tail.push_back(r);
+         }
+         up_first[r+1] = arc_head.size();
+         std::vector<size_t>().swap(ups[r]);
+      }
+      size_t num_arcs = arc_head.size();
+      
+      // downward arcs
+      down_first.resize(n+1, 0);
+      for (size_t a=0; a<num_arcs; a++)
+         down_first[arc_head[a]+1]++;
+      for (size_t r=0; r<n; r++)
+         down_first[r+1] += down_first[r];
+      down_arc.resize(num_arcs);
+      std::vector<size_t> down_fill(down_first.begin(), down_first.end()-1);
+      for (size_t a=0; a<num_arcs; a++)
+         down_arc[down_fill[arc_head[a]]++] = a;
+      
+      // original edges, each attached to the arc from its lower endpoint
+      std::vector< std::pair<size_t,Edge> > edge_arcs;
+      for (size_t vi=0; vi<n; vi++)
+      {
+         OutEdgeIter ei, ei_end;
+         for (boost::tie(ei,ei_end)=out_edges(vertex(vi,g),g); ei!=ei_end; ++ei)
+         {
+            size_t ui = get(get(boost::vertex_index,g), target(*ei,g));
+            if (!(rank[vi] < rank[ui]))
+               continue;
+            edge_arcs.push_back(std::make_pair(find_arc(rank[vi],rank[ui]), *ei));
+         }
+      }
+      arc_edges_first.resize(num_arcs+1, 0);
+      for (size_t ui=0; ui<edge_arcs.size(); ui++)
+         arc_edges_first[edge_arcs[ui].first+1]++;
+      for (size_t a=0; a<num_arcs; a++)
+         arc_edges_first[a+1] += arc_edges_first[a];
+      arc_edges.resize(edge_arcs.size());
+      std::vector<size_t> arc_fill(arc_edges_first.begin(), arc_edges_first.end()-1);
+      for (size_t ui=0; ui<edge_arcs.size(); ui++)
+         arc_edges[arc_fill[edge_arcs[ui].first]++] = edge_arcs[ui].second;
+      
+      arc_weight.resize(num_arcs, inf);
+      arc_mid.resize(num_arcs, none);
+      arc_edge_best.resize(num_arcs, none);
+      
+      dist_s.resize(n, inf);
+      dist_t.resize(n, inf);
+      pred_s.resize(n, none);
+      pred_t.resize(n, none);
+      anc_s_stamp.resize(n, 0);
+   }
+   
+   // the arc between ranks lo < hi, or none
+   inline size_t find_arc(size_t lo, size_t hi) const
+   {
+      std::vector<size_t>::const_iterator it = std::lower_bound(
+         arc_head.begin()+up_first[lo], arc_head.begin()+up_first[lo+1], hi);
+      if (it == arc_head.begin()+up_first[lo+1] || *it != hi)
+         return none;
+      return it - arc_head.begin();
+   }
+   
+   // cheapest original edge weight underlying arc a
+   // (best is set to that edge's index in arc_edges, or none)
+   inline weight_type input_weight(size_t a, size_t & best) const
+   {
+      weight_type w = inf;
+      best = none;
+      for (size_t ui=arc_edges_first[a]; ui<arc_edges_first[a+1]; ui++)
+      {
+         weight_type w_edge = get(w_map, arc_edges[ui]);
+         if (best == none || compare(w_edge, w))
+         {
+            w = w_edge;
+            best = ui;
+         }
+      }
+      return w;
+   }
+   
+   // computes all arc weights from scratch
+   void customize()
+   {
+      queue.reset();
+      for (size_t a=0; a<arc_head.size(); a++)
+      {
+         arc_weight[a] = input_weight(a, arc_edge_best[a]);
+         arc_mid[a] = none;
+      }
+      // each lower triangle (r; h1, h2) relaxes arc (h1,h2);
+      // arcs from r are final once all lower ranks are done
+      for (size_t r=0; r<parent.size(); r++)
+      {
+         for (size_t a1=up_first[r]; a1<up_first[r+1]; a1++)
+         {
+            if (arc_weight[a1] == inf)
+               continue;
+            // the heads of the later arcs from r are all upward
+            // neighbors of h1 (the graph is chordal), so find their
+            // arcs from h1 by a single merge
+            size_t b = up_first[arc_head[a1]];
+            for (size_t a2=a1+1; a2<up_first[r+1]; a2++)
+            {
+               while (arc_head[b] != arc_head[a2])
+                  b++;
+               weight_type w = combine(arc_weight[a1], arc_weight[a2]);
+               if (compare(w, arc_weight[b]))
+               {
+                  arc_weight[b] = w;
+                  arc_mid[b] = r;
+               }
+            }
+         }
+      }
+   }
+   
+   // call after the weight of e has changed;
+   // the change is applied on the next recustomize()
+   inline void update_edge(Edge e)
+   {
+      size_t ru = rank[get(get(boost::vertex_index,g), source(e,g))];
+      size_t rv = rank[get(get(boost::vertex_index,g), target(e,g))];
+      if (ru == rv)
+         return;
+      size_t a = (ru < rv) ? find_arc(ru,rv) : find_arc(rv,ru);
+      if (a != none && !queue.contains(a))
+         queue.insert(a, arc_tail[a]);
+   }
+   
+   // recomputes arcs affected by updated edges, in order of tail rank,
+   // so that all of an arc's lower triangles are final when it is done
+   void recustomize()
+   {
+      while (queue.size())
+         recustomize_next();
+   }
+   
+   // recomputes the next queued arc (see recustomize());
+   // stopping between calls leaves the rest queued
+   void recustomize_next()
+   {
+      size_t a = queue.top_idx();
+      queue.remove_min();
+      size_t lo = arc_tail[a];
+      size_t hi = arc_head[a];
+      
+      // recompute from the input edge and all lower triangles
+      weight_type w = input_weight(a, arc_edge_best[a]);
+      size_t mid = none;
+      size_t i = down_first[lo];
+      size_t j = down_first[hi];
+      while (i<down_first[lo+1] && j<down_first[hi+1])
+      {
+         size_t ti = arc_tail[down_arc[i]];
+         size_t tj = arc_tail[down_arc[j]];
+         if (ti < tj) { i++; continue; }
+         if (tj < ti) { j++; continue; }
+         weight_type w_tri = combine(arc_weight[down_arc[i]], arc_weight[down_arc[j]]);
+         if (compare(w_tri, w))
+         {
+            w = w_tri;
+            mid = ti;
+         }
+         i++;
+         j++;
+      }
+      arc_mid[a] = mid;
+      if (w == arc_weight[a])
+         return;
+      arc_weight[a] = w;
+      
+      // a is a lower arc of each triangle (lo; hi, h)
+      for (size_t a2=up_first[lo]; a2<up_first[lo+1]; a2++)
+      {
+         size_t h = arc_head[a2];
+         if (h == hi)
+            continue;
+         size_t b = (h < hi) ? find_arc(h,hi) : find_arc(hi,h);
+         if (!queue.contains(b))
+            queue.insert(b, arc_tail[b]);
+      }
+   }
+   
+   // returns the distance from v_s to v_t (or inf),
+   // and appends the path edges (from v_s to v_t) to path
+   weight_type query(Vertex v_s, Vertex v_t, std::vector<Edge> & path)
+   {
+      size_t rs = rank[get(get(boost::vertex_index,g), v_s)];
+      size_t rt = rank[get(get(boost::vertex_index,g), v_t)];
+      stamp++;
+      
+      // upward searches over each elimination tree ancestor path
+      upward(rs, anc_s, dist_s, pred_s);
+      for (size_t ui=0; ui<anc_s.size(); ui++)
+         anc_s_stamp[anc_s[ui]] = stamp;
+      upward(rt, anc_t, dist_t, pred_t);
+      
+      // meet at a common ancestor
+      weight_type best = inf;
+      size_t r_meet = none;
+      for (size_t ui=0; ui<anc_t.size(); ui++)
+      {
+         size_t r = anc_t[ui];
+         if (anc_s_stamp[r] != stamp)
+            continue;
+         weight_type w = combine(dist_s[r], dist_t[r]);
+         if (compare(w, best))
+         {
+            best = w;
+            r_meet = r;
+         }
+      }
+      if (r_meet == none)
+         return inf;
+      
+      // unpack the start half (gathered backwards)
+      std::vector<size_t> arcs;
+      for (size_t r=r_meet; r!=rs; r=arc_tail[pred_s[r]])
+         arcs.push_back(pred_s[r]);
+      for (size_t ui=arcs.size(); ui>0; ui--)
+         unpack(arc_tail[arcs[ui-1]], arc_head[arcs[ui-1]], arcs[ui-1], path);
+      // unpack the goal half
+      for (size_t r=r_meet; r!=rt; r=arc_tail[pred_t[r]])
+         unpack(r, arc_tail[pred_t[r]], pred_t[r], path);
+      
+      return best;
+   }
+
+private:
+   
+   // relaxes the upward arcs of each ancestor of r_root in turn;
+   // every upward neighbor of an ancestor is itself an ancestor
+   void upward(size_t r_root, std::vector<size_t> & anc,
+      std::vector<weight_type> & dist, std::vector<size_t> & pred)
+   {
+      anc.clear();
+      for (size_t r=r_root; r!=none; r=parent[r])
+      {
+         anc.push_back(r);
+         dist[r] = inf;
+         pred[r] = none;
+      }
+      dist[r_root] = zero;
+      for (size_t ui=0; ui<anc.size(); ui++)
+      {
+         size_t r = anc[ui];
+         if (dist[r] == inf)
+            continue;
+         for (size_t a=up_first[r]; a<up_first[r+1]; a++)
+         {
+            weight_type w = combine(dist[r], arc_weight[a]);
+            if (compare(w, dist[arc_head[a]]))
+            {
+               dist[arc_head[a]] = w;
+               pred[arc_head[a]] = a;
+            }
+         }
+      }
+   }
+   
+   // appends the original edges of arc a, traversed from r_from to r_to
+   void unpack(size_t r_from, size_t r_to, size_t a, std::vector<Edge> & path)
+   {
+      size_t mid = arc_mid[a];
+      if (mid == none)
+      {
+         // the cheapest parallel edge (which the arc weight is from),
+         // as seen from r_from (it is stored from the lower rank)
+         BOOST_ASSERT(arc_edge_best[a] != none);
+         Edge e = arc_edges[arc_edge_best[a]];
+         if (r_from < r_to)
+         {
+            path.push_back(e);
+            return;
+         }
+         OutEdgeIter ei, ei_end;
+         for (boost::tie(ei,ei_end)=out_edges(vertex_at[r_from],g); ei!=ei_end; ++ei)
+         {
+            if (*ei == e)
+            {
+               path.push_back(*ei);
+               return;
+            }
+         }
+         // (no undirected match, e.g. a directed graph)
+         std::pair<Edge,bool> ret = edge(vertex_at[r_from], vertex_at[r_to], g);
+         BOOST_ASSERT(ret.second);
+         path.push_back(ret.first);
+         return;
+      }
+      unpack(r_from, mid,
+         (r_from < mid) ? find_arc(r_from,mid) : find_arc(mid,r_from), path);
+      unpack(mid, r_to,
+         (mid < r_to) ? find_arc(mid,r_to) : find_arc(r_to,mid), path);
+   }
+   
+   // nested dissection: each part receives a contiguous range of ranks
+   // ending at hi, with its separator ranked highest
+   void compute_order(const std::vector<size_t> & adj_first,
+      const std::vector<size_t> & adj)
+   {
+      size_t n = adj_first.size() - 1;
+      rank.resize(n, none);
+      vertex_at.resize(n);
+      std::vector<size_t> in_part(n, 0); // stamps
+      std::vector<size_t> visited(n, 0); // stamps
+      std::vector<size_t> in_half(n, 0); // stamps
+      size_t part_stamp = 0;
+      
+      std::vector< std::pair<std::vector<size_t>,size_t> > parts;
+      parts.push_back(std::make_pair(std::vector<size_t>(), n));
+      for (size_t vi=0; vi<n; vi++)
+         parts.back().first.push_back(vi);
+      
+      std::vector<size_t> order;
+      while (parts.size())
+      {
+         std::vector<size_t> part;
+         part.swap(parts.back().first);
+         size_t hi = parts.back().second;
+         parts.pop_back();
+         
+         if (part.size() <= leaf_size)
+         {
+            for (size_t ui=0; ui<part.size(); ui++)
+               assign_rank(part[ui], hi-part.size()+ui);
+            continue;
+         }
+         
+         part_stamp++;
+         for (size_t ui=0; ui<part.size(); ui++)
+            in_part[part[ui]] = part_stamp;
+         
+         // split into connected components if necessary
+         bfs(part[0], adj_first, adj, in_part, part_stamp, visited, part_stamp, order);
+         if (order.size() < part.size())
+         {
+            size_t comp_hi = hi;
+            for (size_t ui=0; ui<part.size(); ui++)
+            {
+               if (ui && visited[part[ui]] == part_stamp)
+                  continue;
+               if (ui)
+                  bfs(part[ui], adj_first, adj, in_part, part_stamp, visited, part_stamp, order);
+               parts.push_back(std::make_pair(order, comp_hi));
+               comp_hi -= order.size();
+            }
+            continue;
+         }
+         
+         // bisect the breadth-first order from a pseudo-peripheral vertex
+         part_stamp++;
+         for (size_t ui=0; ui<part.size(); ui++)
+            in_part[part[ui]] = part_stamp;
+         size_t v_far = order.back();
+         bfs(v_far, adj_first, adj, in_part, part_stamp, visited, part_stamp, order);
+         size_t half = order.size() / 2;
+         for (size_t ui=0; ui<half; ui++)
+            in_half[order[ui]] = part_stamp;
+         std::vector<size_t> part_a;
+         std::vector<size_t> part_b(order.begin()+half, order.end());
+         std::vector<size_t> sep;
+         for (size_t ui=0; ui<half; ui++)
+         {
+            size_t vi = order[ui];
+            bool on_boundary = false;
+            for (size_t ai=adj_first[vi]; ai<adj_first[vi+1]; ai++)
+               if (in_part[adj[ai]] == part_stamp && in_half[adj[ai]] != part_stamp)
+                  on_boundary = true;
+            if (on_boundary)
+               sep.push_back(vi);
+            else
+               part_a.push_back(vi);
+         }
+         for (size_t ui=0; ui<sep.size(); ui++)
+            assign_rank(sep[ui], hi-sep.size()+ui);
+         parts.push_back(std::make_pair(part_b, hi-sep.size()));
+         parts.push_back(std::make_pair(part_a, hi-sep.size()-part_b.size()));
+      }
+   }
+   
+   inline void assign_rank(size_t vi, size_t r)
+   {
+      rank[vi] = r;
+      vertex_at[r] = vertex(vi,g);
+   }
+   
+   // breadth-first order of the component of v_root within a part
+   void bfs(size_t v_root,
+      const std::vector<size_t> & adj_first, const std::vector<size_t> & adj,
+      const std::vector<size_t> & in_part, size_t part_stamp,
+      std::vector<size_t> & visited, size_t visit_stamp,
+      std::vector<size_t> & order)
+   {
+      order.clear();
+      order.push_back(v_root);
+      visited[v_root] = visit_stamp;
+      for (size_t ui=0; ui<order.size(); ui++)
+      {
+         size_t vi = order[ui];
+         for (size_t ai=adj_first[vi]; ai<adj_first[vi+1]; ai++)
+         {
+            size_t vn = adj[ai];
+            if (in_part[vn] != part_stamp || visited[vn] == visit_stamp)
+               continue;
+            visited[vn] = visit_stamp;
+            order.push_back(vn);
+         }
+      }
+   }
+};
+
+} // namespace pr_bgl
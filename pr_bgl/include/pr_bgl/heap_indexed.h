@@ -192,6 +192,11 @@ public:
    {
       return backing[1].idx;
    }
+   // the idx at heap location loc, in [1,size()] (in no particular order)
+   inline size_t idx_at(size_t loc) const
+   {
+      return backing[loc].idx;
+   }
    inline void remove_min()
    {
       // remove
@@ -9,6 +9,38 @@
 namespace pr_bgl
 {
 
+/*! \brief Synchronization primitives and the goal-side worker
+ *         thread for the parallel mode of pr_bgl::incbi.
+ * 
+ * The worker is started on the first parallel search, and then waits
+ * (on cond) for each later search until the sync object is destroyed.
+ * 
+ * copies get their own fresh primitives (and no worker),
+ * so that incbi instances remain copyable.
+ */
+struct incbi_sync
+{
+   boost::mutex mutex;
+   boost::condition_variable cond;
+   boost::thread worker;
+   bool worker_busy; // a search has been handed to the worker
+   bool worker_quit;
+   incbi_sync(): worker_busy(false), worker_quit(false) {}
+   incbi_sync(const incbi_sync &): worker_busy(false), worker_quit(false) {}
+   incbi_sync & operator=(const incbi_sync &) { return *this; }
+   ~incbi_sync()
+   {
+      if (!worker.joinable())
+         return;
+      {
+         boost::unique_lock<boost::mutex> lock(mutex);
+         worker_quit = true;
+         cond.notify_all();
+      }
+      worker.join();
+   }
+};
+
 /*! \brief This class implements incremental bidirectional Dijkstra's
  *         search for the single-pair shortest path problem.
  * 
@@ -36,6 +68,12 @@ namespace pr_bgl
  * Invariant 2:
  * iff start_distlook[v] != start_dist[u], then inconsistent
  * (also conn queue stuff)
+ * 
+ * if parallel is set, compute_shortest_path() expands the start and
+ * goal frontiers concurrently on two threads (see
+ * compute_shortest_path_parallel); the balancer is then unused,
+ * and the visitor's start_* and goal_* callbacks may be called
+ * concurrently from the two threads
  */
 template <class Graph,
    class StartPredecessorMap,
@@ -104,6 +142,7 @@ public:
    weight_type goal_margin;
    IncBiVisitor vis;
    IncBiBalancer balancer;
+   bool parallel;
    
    // these contain all inconsistent vertices
    heap_indexed< weight_type > start_queue;
@@ -114,6 +153,26 @@ public:
    // infinite-length prospective paths are not in queue at all
    heap_indexed< conn_key > conn_queue;
    
+   // parallel mode only:
+   // each side publishes (under sync.mutex) the distances of its
+   // consistent vertices (or inf), which is all the other side
+   // (and the conn_queue) may look at;
+   // vertices whose consistency may have changed since their last
+   // publication are kept in the side's touched list
+   incbi_sync sync;
+   std::vector<weight_type> start_published;
+   std::vector<weight_type> goal_published;
+   std::vector<Vertex> start_touched;
+   std::vector<Vertex> goal_touched;
+   weight_type start_published_top;
+   weight_type goal_published_top;
+   size_t start_published_size;
+   size_t goal_published_size;
+   weight_type start_published_goaldist;
+   weight_type goal_published_startdist;
+   bool parallel_done;
+   cancel_poll * parallel_cancel;
+   
    incbi(
       const Graph & g,
       Vertex v_start, Vertex v_goal,
@@ -128,7 +187,9 @@ public:
       CostInf inf, CostZero zero,
       weight_type goal_margin,
       IncBiVisitor vis,
-      IncBiBalancer balancer):
+      IncBiBalancer balancer,
+      bool do_resume = false,
+      bool parallel = false):
       g(g), v_start(v_start), v_goal(v_goal),
       start_predecessor(start_predecessor),
       start_distance(start_distance),
@@ -142,9 +203,15 @@ public:
       compare(compare), combine(combine),
       inf(inf), zero(zero),
       goal_margin(goal_margin),
-      vis(vis), balancer(balancer)
+      vis(vis), balancer(balancer),
+      parallel(parallel),
+      parallel_done(false),
+      parallel_cancel(0)
    {
-      reset();
+      if (do_resume)
+         resume();
+      else
+         reset();
    }
 
    void reset()
@@ -166,6 +233,124 @@ public:
       goal_queue.insert(get(vertex_index_map,v_goal), zero);
       vis.goal_queue_insert(v_goal);
       conn_queue.reset();
+      if (parallel)
+      {
+         start_published.assign(num_vertices(g), inf);
+         goal_published.assign(num_vertices(g), inf);
+         start_touched.clear();
+         goal_touched.clear();
+      }
+   }
+   
+   // this re-uses the existing start/goal distance and
+   // predecessor/successor values
+   // (e.g. from a previous search over a subgraph of g)
+   // it recalculates all lookahead distances over the current edges,
+   // re-queues all inconsistent vertices,
+   // and rebuilds the connection queue
+   void resume()
+   {
+      start_queue.reset();
+      goal_queue.reset();
+      conn_queue.reset();
+      VertexIter vi, vi_end;
+      for (boost::tie(vi,vi_end)=vertices(g); vi!=vi_end; ++vi)
+      {
+         Vertex v = *vi;
+         
+         // start-side lookahead
+         start_recompute_lookahead(v);
+         if (get(start_distance,v) != get(start_distance_lookahead,v))
+         {
+            start_queue.insert(get(vertex_index_map,v), start_calculate_key(v));
+            vis.start_queue_insert(v);
+         }
+         
+         // goal-side lookahead
+         goal_recompute_lookahead(v);
+         if (get(goal_distance,v) != get(goal_distance_lookahead,v))
+         {
+            goal_queue.insert(get(vertex_index_map,v), goal_calculate_key(v));
+            vis.goal_queue_insert(v);
+         }
+      }
+      
+      // parallel mode: publish every consistent vertex
+      if (parallel)
+      {
+         start_published.assign(num_vertices(g), inf);
+         goal_published.assign(num_vertices(g), inf);
+         start_touched.clear();
+         goal_touched.clear();
+         for (boost::tie(vi,vi_end)=vertices(g); vi!=vi_end; ++vi)
+         {
+            size_t v_idx = get(vertex_index_map,*vi);
+            if (!start_queue.contains(v_idx))
+               start_published[v_idx] = get(start_distance,*vi);
+            if (!goal_queue.contains(v_idx))
+               goal_published[v_idx] = get(goal_distance,*vi);
+         }
+      }
+      
+      // connection queue (requires both queues to be complete)
+      for (boost::tie(vi,vi_end)=vertices(g); vi!=vi_end; ++vi)
+      {
+         OutEdgeIter ei, ei_end;
+         for (boost::tie(ei,ei_end)=out_edges(*vi,g); ei!=ei_end; ei++)
+            update_edge(*ei);
+      }
+   }
+   
+   // recalculates v's start-side lookahead distance (and predecessor)
+   // from scratch over all of its in-edges;
+   // start_update_vertex(v) must be called afterwards
+   inline void start_recompute_lookahead(Vertex v)
+   {
+      if (v == v_start)
+      {
+         put(start_distance_lookahead, v_start, zero);
+         return;
+      }
+      weight_type v_look_best = inf;
+      Vertex v_pred_best = get(start_predecessor, v);
+      InEdgeIter ei, ei_end;
+      for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
+      {
+         weight_type v_look_uu = combine(get(start_distance,source(*ei,g)), get(weight,*ei));
+         if (v_look_uu < v_look_best)
+         {
+            v_look_best = v_look_uu;
+            v_pred_best = source(*ei,g);
+         }
+      }
+      put(start_predecessor, v, v_pred_best);
+      put(start_distance_lookahead, v, v_look_best);
+   }
+   
+   // recalculates u's goal-side lookahead distance (and successor)
+   // from scratch over all of its out-edges;
+   // goal_update_vertex(u) must be called afterwards
+   inline void goal_recompute_lookahead(Vertex u)
+   {
+      if (u == v_goal)
+      {
+         put(goal_distance_lookahead, v_goal, zero);
+         return;
+      }
+      weight_type u_look_best = inf;
+      Vertex u_succ_best = get(goal_successor, u);
+      OutEdgeIter ei, ei_end;
+      for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
+      {
+         weight_type u_look_vv = combine(get(weight,*ei), get(goal_distance,target(*ei,g)));
+         if (u_look_vv < u_look_best)
+         {
+            u_look_best = u_look_vv;
+            u_succ_best = target(*ei,g);
+         }
+      }
+      put(goal_successor, u, u_succ_best);
+      put(goal_distance_lookahead, u, u_look_best);
    }
    
    inline weight_type start_calculate_key(Vertex u)
@@ -187,6 +372,13 @@ public:
       weight_type elen = get(weight, e);
       Vertex va = source(e,g);
       Vertex vb = target(e,g);
+      if (parallel)
+      {
+         update_edge_published(e, eidx, elen,
+            start_published[get(vertex_index_map,va)],
+            goal_published[get(vertex_index_map,vb)]);
+         return;
+      }
       // should it be in the queue?
       bool is_valid = false;
       do
@@ -313,7 +505,10 @@ public:
             start_queue.remove(u_idx);
             vis.start_queue_remove(u);
             // we're newly consistent, so insert any new conn_queue edges from us
-            if (u_dist != inf)
+            // (in parallel mode, this is deferred to start_publish)
+            if (parallel)
+               start_touched.push_back(u);
+            else if (u_dist != inf)
             {
                OutEdgeIter ei, ei_end;
                for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
@@ -345,14 +540,20 @@ public:
             start_queue.insert(u_idx, start_calculate_key(u));
             vis.start_queue_insert(u);
             // we're newly inconsistent, so remove any conn_queue edges from us
-            OutEdgeIter ei, ei_end;
-            for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
+            // (in parallel mode, this is deferred to start_publish)
+            if (parallel)
+               start_touched.push_back(u);
+            else
             {
-               size_t edge_index = get(edge_index_map,*ei);
-               if (conn_queue.contains(edge_index))
+               OutEdgeIter ei, ei_end;
+               for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
                {
-                  conn_queue.remove(edge_index);
-                  vis.conn_queue_remove(*ei);
+                  size_t edge_index = get(edge_index_map,*ei);
+                  if (conn_queue.contains(edge_index))
+                  {
+                     conn_queue.remove(edge_index);
+                     vis.conn_queue_remove(*ei);
+                  }
                }
             }
          }
@@ -446,7 +647,10 @@ public:
             goal_queue.remove(v_idx);
             vis.goal_queue_remove(v);
             // we're newly consistent, so insert any new conn_queue edges to us
-            if (v_dist != inf)
+            // (in parallel mode, this is deferred to goal_publish)
+            if (parallel)
+               goal_touched.push_back(v);
+            else if (v_dist != inf)
             {
                InEdgeIter ei, ei_end;
                for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
@@ -478,23 +682,34 @@ public:
             goal_queue.insert(v_idx, goal_calculate_key(v));
             vis.goal_queue_insert(v);
             // we're newly inconsistent, so remove any conn_queue edges to us
-            InEdgeIter ei, ei_end;
-            for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
+            // (in parallel mode, this is deferred to goal_publish)
+            if (parallel)
+               goal_touched.push_back(v);
+            else
             {
-               size_t edge_index = get(edge_index_map,*ei);
-               if (conn_queue.contains(edge_index))
+               InEdgeIter ei, ei_end;
+               for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
                {
-                  conn_queue.remove(edge_index);
-                  vis.conn_queue_remove(*ei);
+                  size_t edge_index = get(edge_index_map,*ei);
+                  if (conn_queue.contains(edge_index))
+                  {
+                     conn_queue.remove(edge_index);
+                     vis.conn_queue_remove(*ei);
+                  }
                }
             }
          }
       }
    }
    
-   // returns index of middle edge, and bool for success
-   std::pair<size_t,bool> compute_shortest_path()
+   // returns index of middle edge, and bool for success;
+   // if cancel is passed, it is polled before each expansion,
+   // and no path is returned (with the queues intact) if it cancels
+   std::pair<size_t,bool> compute_shortest_path(cancel_poll * cancel = 0)
    {
+      if (parallel)
+         return compute_shortest_path_parallel(cancel);
+      
       for (;;)
       {
          weight_type start_top = start_queue.size() ? start_queue.top_key() : inf;
@@ -502,15 +717,9 @@ public:
          
          vis.begin_iteration();
          
-         // no-path termination
-         if (!start_queue.size() && !goal_queue.size())
-            return std::make_pair(0, false);
-         if (!start_queue.size() && get(start_distance,v_goal) == inf)
-            return std::make_pair(0, false);
-         if (!goal_queue.size() && get(goal_distance,v_start) == inf)
-            return std::make_pair(0, false);
-         
          // has-path termination condition is rather complicated!
+         // (this is checked first, since both queues may be empty
+         // with a path in the conn queue, e.g. after resume())
          do
          {
             if (!conn_queue.size()) break;
@@ -521,6 +730,17 @@ public:
          }
          while (0);
          
+         // no-path termination
+         if (!start_queue.size() && !goal_queue.size())
+            return std::make_pair(0, false);
+         if (!start_queue.size() && get(start_distance,v_goal) == inf)
+            return std::make_pair(0, false);
+         if (!goal_queue.size() && get(goal_distance,v_start) == inf)
+            return std::make_pair(0, false);
+         
+         if (cancel && cancel->poll())
+            return std::make_pair(0, false);
+         
          bool do_goal =
             start_queue.contains(v_start) ? false :
             goal_queue.contains(v_goal) ? true :
@@ -530,117 +750,361 @@ public:
          {
             if (!start_queue.size())
                return std::make_pair(0, false);
+            start_expand();
+         }
+         else
+         {
+            if (!goal_queue.size())
+               return std::make_pair(0, false);
+            goal_expand();
+         }
+      }
+   }
+   
+   // expands the top vertex of the (non-empty) start queue
+   void start_expand()
+   {
+      Vertex u = vertex(start_queue.top_idx(), g);
+      
+      vis.examine_vertex_start(u);
+      
+      start_queue.remove_min();
+      vis.start_queue_remove(u);
+      if (get(start_distance,u) > get(start_distance_lookahead,u))
+      {
+         weight_type u_sdist = get(start_distance_lookahead,u);
+         put(start_distance, u, u_sdist);
+         
+         // vertex u is newly start-consistent
+         
+         // update any successors that they may now be inconsistent
+         // also, this start vertex just became consistent,
+         // so add any out_edges to consistent goal-tree vertices
+         // to conn queue (in parallel mode, via start_publish)
+         OutEdgeIter ei, ei_end;
+         for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
+         {
+            Vertex v = target(*ei,g);
+            size_t v_idx = get(vertex_index_map, v);
             
-            Vertex u = vertex(start_queue.top_idx(), g);
+            double uv_weight = get(weight,*ei);
+            bool lookahead_changed = start_update_predecessor(u, v, uv_weight);
+            if (lookahead_changed)
+               start_update_vertex(v);
             
-            vis.examine_vertex_start(u);
+            if (parallel)
+               continue;
             
-            start_queue.remove_min();
-            vis.start_queue_remove(u);
-            if (get(start_distance,u) > get(start_distance_lookahead,u))
+            weight_type v_tdist = get(goal_distance,v);
+            if (u_sdist != inf && !goal_queue.contains(v_idx) && v_tdist != inf && uv_weight != inf)
             {
-               weight_type u_sdist = get(start_distance_lookahead,u);
-               put(start_distance, u, u_sdist);
-               
-               // vertex u is newly start-consistent
-               
-               // update any successors that they may now be inconsistent
-               // also, this start vertex just became consistent,
-               // so add any out_edges to consistent goal-tree vertices
-               // to conn queue
-               OutEdgeIter ei, ei_end;
-               for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
-               {
-                  Vertex v = target(*ei,g);
-                  size_t v_idx = get(vertex_index_map, v);
-                  
-                  double uv_weight = get(weight,*ei);
-                  bool lookahead_changed = start_update_predecessor(u, v, uv_weight);
-                  if (lookahead_changed)
-                     start_update_vertex(v);
-                  
-                  weight_type v_tdist = get(goal_distance,v);
-                  if (u_sdist != inf && !goal_queue.contains(v_idx) && v_tdist != inf && uv_weight != inf)
-                  {
-                     conn_key new_key(combine(combine(u_sdist, uv_weight), v_tdist), u_sdist, v_tdist);
-                     conn_queue.insert(get(edge_index_map,*ei), new_key);
-                     vis.conn_queue_insert(*ei);
-                  }
-               }
-            }
-            else
-            {
-               put(start_distance, u, inf);
-               start_update_vertex(u);
-               OutEdgeIter ei, ei_end;
-               for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
-               {
-                  Vertex v = target(*ei,g);
-                  
-                  double uv_weight = get(weight,*ei);
-                  bool lookahead_changed = start_update_predecessor(u, v, uv_weight);
-                  if (lookahead_changed)
-                     start_update_vertex(v);
-               }
+               conn_key new_key(combine(combine(u_sdist, uv_weight), v_tdist), u_sdist, v_tdist);
+               conn_queue.insert(get(edge_index_map,*ei), new_key);
+               vis.conn_queue_insert(*ei);
             }
          }
-         else
+         if (parallel)
+            start_touched.push_back(u);
+      }
+      else
+      {
+         put(start_distance, u, inf);
+         start_update_vertex(u);
+         OutEdgeIter ei, ei_end;
+         for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
          {
-            if (!goal_queue.size())
-               return std::make_pair(0, false);
+            Vertex v = target(*ei,g);
             
-            Vertex v = vertex(goal_queue.top_idx(), g);
+            double uv_weight = get(weight,*ei);
+            bool lookahead_changed = start_update_predecessor(u, v, uv_weight);
+            if (lookahead_changed)
+               start_update_vertex(v);
+         }
+      }
+   }
+   
+   // expands the top vertex of the (non-empty) goal queue
+   void goal_expand()
+   {
+      Vertex v = vertex(goal_queue.top_idx(), g);
+      
+      vis.examine_vertex_goal(v);
+      
+      goal_queue.remove_min();
+      vis.goal_queue_remove(v);
+      if (get(goal_distance,v) > get(goal_distance_lookahead,v))
+      {
+         weight_type v_tdist = get(goal_distance_lookahead,v);
+         put(goal_distance, v, v_tdist);
+         
+         // vertex v is newly goal-consistent
+         
+         // update any predecessors that they may now be inconsistent
+         // also, this goal vertex just became consistent,
+         // so add any in_edges from consistent start-tree vertices
+         // (in parallel mode, via goal_publish)
+         InEdgeIter ei, ei_end;
+         for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
+         {
+            Vertex u = source(*ei,g);
+            size_t u_idx = get(vertex_index_map, u);
             
-            vis.examine_vertex_goal(v);
+            double uv_weight = get(weight,*ei);
+            bool lookahead_changed = goal_update_successor(u, v, uv_weight);
+            if (lookahead_changed)
+               goal_update_vertex(u);
             
-            goal_queue.remove_min();
-            vis.goal_queue_remove(v);
-            if (get(goal_distance,v) > get(goal_distance_lookahead,v))
+            if (parallel)
+               continue;
+            
+            weight_type u_sdist = get(start_distance,u);
+            if (v_tdist != inf && !start_queue.contains(u_idx) && u_sdist != inf && uv_weight != inf)
             {
-               weight_type v_tdist = get(goal_distance_lookahead,v);
-               put(goal_distance, v, v_tdist);
-               
-               // vertex v is newly goal-consistent
-               
-               // update any predecessors that they may now be inconsistent
-               // also, this goal vertex just became consistent,
-               // so add any in_edges from consistent start-tree vertices
-               InEdgeIter ei, ei_end;
-               for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
-               {
-                  Vertex u = source(*ei,g);
-                  size_t u_idx = get(vertex_index_map, u);
-                  
-                  double uv_weight = get(weight,*ei);
-                  bool lookahead_changed = goal_update_successor(u, v, uv_weight);
-                  if (lookahead_changed)
-                     goal_update_vertex(u);
-                  
-                  weight_type u_sdist = get(start_distance,u);
-                  if (v_tdist != inf && !start_queue.contains(u_idx) && u_sdist != inf && uv_weight != inf)
-                  {
-                     conn_key new_key(combine(combine(u_sdist, uv_weight), v_tdist), u_sdist, v_tdist);
-                     conn_queue.insert(get(edge_index_map,*ei), new_key);
-                     vis.conn_queue_insert(*ei);
-                  }
-               }
+               conn_key new_key(combine(combine(u_sdist, uv_weight), v_tdist), u_sdist, v_tdist);
+               conn_queue.insert(get(edge_index_map,*ei), new_key);
+               vis.conn_queue_insert(*ei);
             }
+         }
+         if (parallel)
+            goal_touched.push_back(v);
+      }
+      else
+      {
+         put(goal_distance, v, inf);
+         goal_update_vertex(v);
+         InEdgeIter ei, ei_end;
+         for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
+         {
+            Vertex u = source(*ei,g);
+            
+            double uv_weight_new = get(weight,*ei);
+            bool lookahead_changed = goal_update_successor(u, v, uv_weight_new);
+            if (lookahead_changed)
+               goal_update_vertex(u);
+         }
+      }
+   }
+   
+   // parallel mode: sets whether edge e should be in the conn_queue
+   // based only on the published distances of its endpoints
+   // (called under sync.mutex while the search is running)
+   void update_edge_published(Edge e, size_t eidx, weight_type elen,
+      weight_type va_pub, weight_type vb_pub)
+   {
+      if (elen == inf || va_pub == inf || vb_pub == inf)
+      {
+         if (conn_queue.contains(eidx))
+         {
+            conn_queue.remove(eidx);
+            vis.conn_queue_remove(e);
+         }
+         return;
+      }
+      conn_key new_key(combine(combine(va_pub, elen), vb_pub), va_pub, vb_pub);
+      if (conn_queue.contains(eidx))
+      {
+         conn_queue.update(eidx, new_key);
+         vis.conn_queue_update(e);
+      }
+      else
+      {
+         conn_queue.insert(eidx, new_key);
+         vis.conn_queue_insert(e);
+      }
+   }
+   
+   // parallel mode: publishes the start-side state of u
+   // (its distance if start-consistent, otherwise inf),
+   // and updates the conn_queue edges out of u if it changed
+   inline void start_publish(Vertex u)
+   {
+      size_t u_idx = get(vertex_index_map,u);
+      weight_type u_pub = start_queue.contains(u_idx) ? inf : get(start_distance,u);
+      if (u_pub == start_published[u_idx])
+         return;
+      start_published[u_idx] = u_pub;
+      OutEdgeIter ei, ei_end;
+      for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
+         update_edge(*ei);
+   }
+   
+   // parallel mode: publishes the goal-side state of v
+   // (its distance if goal-consistent, otherwise inf),
+   // and updates the conn_queue edges into v if it changed
+   inline void goal_publish(Vertex v)
+   {
+      size_t v_idx = get(vertex_index_map,v);
+      weight_type v_pub = goal_queue.contains(v_idx) ? inf : get(goal_distance,v);
+      if (v_pub == goal_published[v_idx])
+         return;
+      goal_published[v_idx] = v_pub;
+      InEdgeIter ei, ei_end;
+      for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
+         update_edge(*ei);
+   }
+   
+   // parallel mode: publishes all touched start-side vertices
+   // and the start queue summary used for termination
+   void start_publish_all()
+   {
+      for (size_t ui=0; ui<start_touched.size(); ui++)
+         start_publish(start_touched[ui]);
+      start_touched.clear();
+      start_published_top = start_queue.size() ? start_queue.top_key() : inf;
+      start_published_size = start_queue.size();
+      start_published_goaldist = get(start_distance,v_goal);
+   }
+   
+   // parallel mode: publishes all touched goal-side vertices
+   // and the goal queue summary used for termination
+   void goal_publish_all()
+   {
+      for (size_t ui=0; ui<goal_touched.size(); ui++)
+         goal_publish(goal_touched[ui]);
+      goal_touched.clear();
+      goal_published_top = goal_queue.size() ? goal_queue.top_key() : inf;
+      goal_published_size = goal_queue.size();
+      goal_published_startdist = get(goal_distance,v_start);
+   }
+   
+   // parallel mode: the termination conditions of compute_shortest_path(),
+   // evaluated over the published state (under sync.mutex);
+   // both sides may run on until their queues are empty
+   bool parallel_terminated(std::pair<size_t,bool> & result)
+   {
+      // has-path termination
+      do
+      {
+         if (!conn_queue.size()) break;
+         if (combine(conn_queue.top_key().path_length,goal_margin) > combine(start_published_top,goal_published_top)) break;
+         if (combine(conn_queue.top_key().start_dist,goal_margin) > start_published_top) break;
+         if (combine(conn_queue.top_key().goal_dist,goal_margin) > goal_published_top) break;
+         result = std::make_pair(conn_queue.top_idx(), true);
+         return true;
+      }
+      while (0);
+      
+      // no-path termination
+      if ((!start_published_size && !goal_published_size)
+         || (!start_published_size && start_published_goaldist == inf)
+         || (!goal_published_size && goal_published_startdist == inf))
+      {
+         result = std::make_pair(0, false);
+         return true;
+      }
+      
+      return false;
+   }
+   
+   // parallel mode: expansion loop for one side;
+   // each side expands up to parallel_batch vertices between taking
+   // sync.mutex to publish them (cancel is polled under sync.mutex)
+   static const unsigned int parallel_batch = 64;
+   void parallel_expand_loop(bool is_goal, cancel_poll * cancel)
+   {
+      std::pair<size_t,bool> result;
+      for (;;)
+      {
+         {
+            boost::unique_lock<boost::mutex> lock(sync.mutex);
+            if (is_goal)
+               goal_publish_all();
             else
+               start_publish_all();
+            sync.cond.notify_all();
+            for (;;)
             {
-               put(goal_distance, v, inf);
-               goal_update_vertex(v);
-               InEdgeIter ei, ei_end;
-               for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
+               if (parallel_done)
+                  return;
+               vis.begin_iteration();
+               if (parallel_terminated(result)
+                  || (cancel && cancel->poll()))
                {
-                  Vertex u = source(*ei,g);
-                  
-                  double uv_weight_new = get(weight,*ei);
-                  bool lookahead_changed = goal_update_successor(u, v, uv_weight_new);
-                  if (lookahead_changed)
-                     goal_update_vertex(u);
+                  parallel_done = true;
+                  sync.cond.notify_all();
+                  return;
                }
+               if (is_goal ? goal_queue.size() : start_queue.size())
+                  break;
+               // our side is exhausted; wait for the other side
+               sync.cond.wait(lock);
             }
          }
+         for (unsigned int ui=0; ui<parallel_batch; ui++)
+         {
+            if (is_goal)
+            {
+               if (!goal_queue.size())
+                  break;
+               goal_expand();
+            }
+            else
+            {
+               if (!start_queue.size())
+                  break;
+               start_expand();
+            }
+         }
+      }
+   }
+   
+   // parallel mode: the goal-side worker thread,
+   // which runs one expansion loop per search handed to it
+   void parallel_worker()
+   {
+      boost::unique_lock<boost::mutex> lock(sync.mutex);
+      for (;;)
+      {
+         while (!sync.worker_busy && !sync.worker_quit)
+            sync.cond.wait(lock);
+         if (sync.worker_quit)
+            return;
+         lock.unlock();
+         parallel_expand_loop(true, parallel_cancel);
+         lock.lock();
+         sync.worker_busy = false;
+         sync.cond.notify_all();
+      }
+   }
+   
+   // parallel mode: the start side is expanded on the calling thread,
+   // and the goal side on the worker thread (see incbi_sync);
+   // the sides interact only through the published distances and the
+   // conn_queue (both guarded by sync.mutex), and each side publishes
+   // the result of each expansion atomically,
+   // so the termination test always sees a state reachable by some
+   // serial interleaving of expansions
+   // (the path length matches the serial search,
+   // although ties may be broken differently)
+   std::pair<size_t,bool> compute_shortest_path_parallel(cancel_poll * cancel)
+   {
+      std::pair<size_t,bool> result;
+      for (;;)
+      {
+         // publish changes since the last call (e.g. from update_edge)
+         start_publish_all();
+         goal_publish_all();
+         if (parallel_terminated(result))
+            return result;
+         if (cancel && cancel->cancelled())
+            return std::make_pair(0, false);
+         if (!sync.worker.joinable())
+            sync.worker = boost::thread(boost::bind(&incbi::parallel_worker, this));
+         {
+            boost::unique_lock<boost::mutex> lock(sync.mutex);
+            parallel_done = false;
+            parallel_cancel = cancel;
+            sync.worker_busy = true;
+            sync.cond.notify_all();
+         }
+         parallel_expand_loop(false, cancel);
+         {
+            boost::unique_lock<boost::mutex> lock(sync.mutex);
+            while (sync.worker_busy)
+               sync.cond.wait(lock);
+         }
+         // the other side may have finished one more expansion
+         // after termination was detected, so check again
       }
    }
 
@@ -9,6 +9,204 @@
 namespace pr_bgl
 {
 
+/*! \brief Caller-owned scratch buffers for pr_bgl::lazysp.
+ * 
+ * These hold the per-iteration working vectors of the main loop
+ * (the inner search's path, the composed vertex/edge paths, the
+ * selector's edges to evaluate, and the evaluation results).  They are
+ * cleared but never shrunk, so once they have grown to their working
+ * size (or have been sized up front via reserve()) the loop itself
+ * performs no heap allocations.  A caller can keep one instance alive
+ * across several lazysp calls.
+ */
+template <class Vertex, class Edge, class WeightType = double>
+class lazysp_buffers
+{
+public:
+   std::vector<Edge> incsp_path;
+   std::vector<Vertex> vpath;
+   std::vector< std::pair<Edge,bool> > eepath;
+   std::vector<Edge> to_evaluate;
+   std::vector<WeightType> weights;
+   std::vector<Edge> changed;
+   std::vector<std::size_t> changed_ends;
+   std::vector< std::pair<Edge,bool> > speculate_path;
+   std::vector< std::pair<Edge,std::size_t> > speculate_index;
+   std::vector<Edge> speculate;
+   std::vector<std::size_t> speculate_ends;
+   
+   // sizes the buffers for paths of up to num_vertices vertices
+   void reserve(std::size_t num_vertices)
+   {
+      incsp_path.reserve(num_vertices);
+      vpath.reserve(num_vertices);
+      eepath.reserve(num_vertices);
+      to_evaluate.reserve(num_vertices);
+      weights.reserve(num_vertices);
+      changed.reserve(num_vertices);
+      changed_ends.reserve(num_vertices);
+      speculate_path.reserve(num_vertices);
+      speculate_index.reserve(num_vertices);
+      speculate.reserve(num_vertices);
+      speculate_ends.reserve(num_vertices);
+   }
+};
+
+/*! \brief Evaluate an edge via a lazysp WMap into caller-owned storage.
+ * 
+ * Appends the edges whose lazy weights changed to changed, and returns
+ * the evaluated edge's new weight.  This default implementation
+ * delegates to get(wmap,e) (which returns a pair<newval, vec<edge>>
+ * by value); maps which can append their changed edges directly should
+ * provide an overload (found via argument-dependent lookup).
+ */
+template <class WMap, class Edge>
+inline typename boost::property_traits<WMap>::value_type::first_type
+lazysp_wmap_eval(const WMap & wmap, const Edge & e, std::vector<Edge> & changed)
+{
+   typename boost::property_traits<WMap>::value_type eval_result = get(wmap, e);
+   changed.insert(changed.end(),
+      eval_result.second.begin(), eval_result.second.end());
+   return eval_result.first;
+}
+
+/*! \brief Evaluate a batch of edges via a lazysp WMap.
+ * 
+ * For each edge es[i] in order, appends its new weight to weights,
+ * appends its changed edges to changed, and then appends the new size
+ * of changed to changed_ends.  This default implementation calls
+ * lazysp_wmap_eval() on each edge in turn; maps which can evaluate
+ * several (distinct) edges concurrently should provide an overload
+ * with the same results (found via argument-dependent lookup).
+ */
+template <class WMap, class Edge, class WeightType>
+inline void
+lazysp_wmap_eval_batch(const WMap & wmap, const std::vector<Edge> & es,
+   std::vector<WeightType> & weights,
+   std::vector<Edge> & changed, std::vector<std::size_t> & changed_ends)
+{
+   for (unsigned int ui=0; ui<es.size(); ui++)
+   {
+      weights.push_back(lazysp_wmap_eval(wmap, es[ui], changed));
+      changed_ends.push_back(changed.size());
+   }
+}
+
+/*! \brief Whether a lazysp WMap evaluates edges speculatively.
+ * 
+ * Maps which overload lazysp_wmap_speculate() should also overload
+ * this to return true; otherwise lazysp does not compute the edges
+ * to speculate on.
+ */
+template <class WMap>
+inline bool lazysp_wmap_speculates(const WMap &)
+{
+   return false;
+}
+
+/*! \brief Run the inner search while speculatively evaluating edges.
+ * 
+ * The speculate edges are the unevaluated edges of the previous lazy
+ * path, in the order the selector would choose them.  The map may
+ * evaluate any prefix of them (e.g. on background threads) while
+ * search() runs, and reports those it completed in the same form as
+ * lazysp_wmap_eval_batch() (es, weights, changed, changed_ends); the
+ * lazy weights of changed edges must not be modified until search()
+ * has returned.  This default implementation just runs the search.
+ */
+template <class WMap, class Edge, class SearchFn, class WeightType>
+inline WeightType
+lazysp_wmap_speculate(const WMap &,
+   const std::vector<Edge> &, SearchFn search,
+   std::vector<Edge> &, std::vector<WeightType> &,
+   std::vector<Edge> &, std::vector<std::size_t> &)
+{
+   return search();
+}
+
+/*! \brief Inner search call passed to lazysp_wmap_speculate().
+ */
+template <class Graph, class IncSP, class WLazyMap>
+class lazysp_search_fn
+{
+public:
+   typedef typename boost::property_traits<WLazyMap>::value_type result_type;
+   typedef typename boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef typename boost::graph_traits<Graph>::edge_descriptor Edge;
+   IncSP & incsp;
+   Graph & g;
+   Vertex v_start;
+   Vertex v_goal;
+   WLazyMap wlazymap;
+   std::vector<Edge> & path;
+   lazysp_search_fn(IncSP & incsp, Graph & g, Vertex v_start, Vertex v_goal,
+         WLazyMap wlazymap, std::vector<Edge> & path):
+      incsp(incsp), g(g), v_start(v_start), v_goal(v_goal),
+      wlazymap(wlazymap), path(path)
+   {
+   }
+   inline result_type operator()()
+   {
+      return incsp.solve(g, v_start, v_goal, wlazymap, path);
+   }
+};
+
+/*! \brief Pass a cancellation poll to an inner search.
+ * 
+ * Adaptors which can stop their search part way (leaving it
+ * resumable) overload this to poll cancel during the search, in which
+ * case solve() returns inf once it cancels.  This default
+ * implementation does nothing, so that such an inner search is only
+ * interrupted between lazysp iterations.
+ */
+template <class IncSP>
+inline void lazysp_incsp_set_cancel(IncSP &, cancel_poll *)
+{
+}
+
+/*! \brief Find the position of e in a lazysp path via its sorted index.
+ * 
+ * index holds (edge, position) pairs for some of the path's edges,
+ * sorted; returns false if e is not indexed.
+ */
+template <class Edge>
+inline bool lazysp_path_position(
+   const std::vector< std::pair<Edge,std::size_t> > & index, const Edge & e,
+   std::size_t & pos)
+{
+   typename std::vector< std::pair<Edge,std::size_t> >::const_iterator it
+      = std::lower_bound(index.begin(), index.end(), std::make_pair(e,std::size_t(0)));
+   if (it == index.end() || !(it->first == e))
+      return false;
+   pos = it->second;
+   return true;
+}
+
+/*! \brief Apply the results of evaluating es (in order) for pr_bgl::lazysp.
+ */
+template <class Edge, class WeightType,
+   class WLazyMap, class EvalStrategy, class LazySPVisitor>
+inline void lazysp_apply_evals(
+   const std::vector<Edge> & es, const std::vector<WeightType> & weights,
+   const std::vector<Edge> & changed, const std::vector<std::size_t> & changed_ends,
+   WLazyMap wlazymap, EvalStrategy & evalstrategy, LazySPVisitor & visitor,
+   WeightType inf)
+{
+   for (unsigned int ui=0; ui<es.size(); ui++)
+   {
+      Edge e = es[ui];
+      //weight_type e_weight_old = get(wlazymap, e);
+      
+      visitor.edge_evaluate(e, weights[ui]);
+      put(wlazymap, e, weights[ui]);
+      
+      visitor.selector_notify_begin();
+      for (std::size_t ui2=(ui ? changed_ends[ui-1] : 0); ui2<changed_ends[ui]; ui2++)
+         evalstrategy.update_notify(changed[ui2], inf); // e_weight_old
+      visitor.selector_notify_end();
+   }
+}
+
 /*! \brief Invoke the Lazy Shortest Path graph search algorithm
  *
  * The lazysp function implements the Lazy Shortest Path algorithm for
@@ -33,9 +231,35 @@ namespace pr_bgl
  * WMap is NOT assumed to be cached
  * (i.e. it's ok if it's expensive to evaluate each time)
  * 
- * WMap maps from an edge to a pair<newval, vec<edge> changed>
+ * WMap maps from an edge to a pair<newval, vec<edge> changed>;
+ * the selected edges are evaluated together via lazysp_wmap_eval_batch(),
+ * after which the weights and notifications are applied in order
  * 
  * incsp.solve returns IncSP<CostInf> if no path is found!
+ * 
+ * after each round of evaluations, all changed edges are passed
+ * together to incsp.update_notify_batch(begin, end)
+ * 
+ * all working vectors are held in the passed buffers
+ * (see pr_bgl::lazysp_buffers), and are reused across iterations
+ * 
+ * if lazysp_wmap_speculates(wmap), then each inner search is run via
+ * lazysp_wmap_speculate(), which may evaluate the remaining edges of
+ * the previous lazy path while the search runs; any such results are
+ * applied (and the search re-run if weights changed) before the next
+ * selection; the speculated edges are ordered by a copy of the
+ * selector, and the selector itself is then called once for each of
+ * its rounds which were evaluated in full (as though it had selected
+ * those edges), so that a selector which keeps state (e.g. alt)
+ * chooses the same edges as it would without speculation; this
+ * requires Edge to be less-than comparable (as BGL edge descriptors
+ * are)
+ * 
+ * cancel is checked at the start of each iteration (when all
+ * evaluations so far have been applied), and is also passed to the
+ * inner search via lazysp_incsp_set_cancel(); once it cancels, lazysp
+ * returns false without calling visitor.no_path(), and the caller can
+ * distinguish this case via cancel.cancelled()
  */
 template <class Graph,
    class WMap, class WLazyMap, class IsEvaledMap,
@@ -45,29 +269,132 @@ bool lazysp(Graph & g,
    typename boost::graph_traits<Graph>::vertex_descriptor v_goal,
    WMap wmap, WLazyMap wlazymap, IsEvaledMap isevaledmap,
    std::vector<typename boost::graph_traits<Graph>::edge_descriptor> & path,
-   IncSP incsp, EvalStrategy evalstrategy, LazySPVisitor visitor)
+   IncSP incsp, EvalStrategy evalstrategy, LazySPVisitor visitor,
+   lazysp_buffers<
+      typename boost::graph_traits<Graph>::vertex_descriptor,
+      typename boost::graph_traits<Graph>::edge_descriptor,
+      typename boost::property_traits<WLazyMap>::value_type> & buffers,
+   cancel_poll & cancel)
 {
    typedef typename boost::graph_traits<Graph>::vertex_descriptor Vertex;
    typedef typename boost::graph_traits<Graph>::edge_descriptor Edge;
    typedef typename boost::property_traits<WLazyMap>::value_type weight_type;
+   
+   std::vector<Edge> & incsp_path = buffers.incsp_path;
+   std::vector<Vertex> & vpath = buffers.vpath;
+   std::vector< std::pair<Edge,bool> > & eepath = buffers.eepath;
+   std::vector<Edge> & to_evaluate = buffers.to_evaluate;
+   std::vector<weight_type> & weights = buffers.weights;
+   std::vector<Edge> & changed = buffers.changed;
+   std::vector<std::size_t> & changed_ends = buffers.changed_ends;
+   std::vector< std::pair<Edge,bool> > & speculate_path = buffers.speculate_path;
+   std::vector< std::pair<Edge,std::size_t> > & speculate_index = buffers.speculate_index;
+   std::vector<Edge> & speculate = buffers.speculate;
+   std::vector<std::size_t> & speculate_ends = buffers.speculate_ends;
+   bool speculates = lazysp_wmap_speculates(wmap);
+   lazysp_incsp_set_cancel(incsp, &cancel);
 
    for (;;)
    {
-      std::vector<Edge> incsp_path;
+      if (cancel.check())
+         return false;
+      
+      // order the previous path's unevaluated edges as a copy of the
+      // selector would choose them (restricted to path edges), in
+      // rounds ending at speculate_ends; the selector itself is only
+      // advanced once their results are applied (see below)
+      speculate.clear();
+      speculate_ends.clear();
+      if (speculates && eepath.size())
+      {
+         speculate_path = eepath;
+         speculate_index.clear();
+         for (unsigned int ui=0; ui<speculate_path.size(); ui++)
+         {
+            speculate_path[ui].second = get(isevaledmap, speculate_path[ui].first);
+            if (!speculate_path[ui].second)
+               speculate_index.push_back(std::make_pair(speculate_path[ui].first, std::size_t(ui)));
+         }
+         std::sort(speculate_index.begin(), speculate_index.end());
+         EvalStrategy speculate_strategy(evalstrategy);
+         for (;;)
+         {
+            to_evaluate.clear();
+            speculate_strategy.get_to_evaluate(g, speculate_path, to_evaluate);
+            for (unsigned int ui=0; ui<to_evaluate.size(); ui++)
+            {
+               std::size_t pos;
+               if (!lazysp_path_position(speculate_index, to_evaluate[ui], pos)
+                  || speculate_path[pos].second)
+                  continue;
+               speculate_path[pos].second = true;
+               speculate.push_back(to_evaluate[ui]);
+            }
+            if (speculate.size() == (speculate_ends.size() ? speculate_ends.back() : 0))
+               break;
+            speculate_ends.push_back(speculate.size());
+         }
+         for (unsigned int ui=0; ui<speculate.size(); ui++)
+         {
+            std::size_t pos = 0;
+            lazysp_path_position(speculate_index, speculate[ui], pos);
+            speculate_path[pos].second = false;
+         }
+      }
       
       visitor.search_begin();
-      weight_type pathlen = incsp.solve(g, v_start, v_goal, wlazymap, incsp_path);
+      weight_type pathlen;
+      to_evaluate.clear();
+      weights.clear();
+      changed.clear();
+      changed_ends.clear();
+      if (speculate.size())
+         pathlen = lazysp_wmap_speculate(wmap, speculate,
+            lazysp_search_fn<Graph,IncSP,WLazyMap>(incsp, g, v_start, v_goal, wlazymap, incsp_path),
+            to_evaluate, weights, changed, changed_ends);
+      else
+         pathlen = incsp.solve(g, v_start, v_goal, wlazymap, incsp_path);
       visitor.search_end();
       
+      // apply speculative results; if any weights changed,
+      // the path just found may be stale, so search again
+      if (to_evaluate.size())
+      {
+         std::size_t num_speculated = to_evaluate.size();
+         lazysp_apply_evals(to_evaluate, weights, changed, changed_ends,
+            wlazymap, evalstrategy, visitor, incsp.inf);
+         
+         // advance the selector past each round evaluated in full,
+         // as though it had selected those edges itself
+         for (unsigned int ur=0; ur<speculate_ends.size() && speculate_ends[ur]<=num_speculated; ur++)
+         {
+            to_evaluate.clear();
+            evalstrategy.get_to_evaluate(g, speculate_path, to_evaluate);
+            for (std::size_t ui=(ur ? speculate_ends[ur-1] : 0); ui<speculate_ends[ur]; ui++)
+            {
+               std::size_t pos = 0;
+               lazysp_path_position(speculate_index, speculate[ui], pos);
+               speculate_path[pos].second = true;
+            }
+         }
+         if (changed.size())
+         {
+            incsp.update_notify_batch(changed.begin(), changed.end());
+            continue;
+         }
+      }
+      
       if (pathlen == incsp.inf)
       {
+         if (cancel.cancelled())
+            return false;
          visitor.no_path();
          return false;
       }
       
       // compose vpath and eepath, determine if path already evaled
-      std::vector<Vertex> vpath;
-      std::vector< std::pair<Edge,bool> > eepath;
+      vpath.clear();
+      eepath.clear();
       bool path_evaled = true;
       vpath.push_back(source(incsp_path[0],g));
       for (unsigned int ui=0; ui<incsp_path.size(); ui++)
@@ -91,40 +418,91 @@ bool lazysp(Graph & g,
       }
 
       // determine edges to evaluate
-      std::vector<Edge> to_evaluate;
+      to_evaluate.clear();
       visitor.selector_begin();
       evalstrategy.get_to_evaluate(g, eepath, to_evaluate);
       visitor.selector_end();
       BOOST_ASSERT(to_evaluate.size());
 
-      // perform the evaluations
+      // perform the evaluations (possibly concurrently)
+      weights.clear();
+      changed.clear();
+      changed_ends.clear();
+      visitor.eval_begin();
+      lazysp_wmap_eval_batch(wmap, to_evaluate, weights, changed, changed_ends);
+      visitor.eval_end();
       
-      for (unsigned int ui=0; ui<to_evaluate.size(); ui++)
-      {
-         Edge & e = to_evaluate[ui];
-         //weight_type e_weight_old = get(wlazymap, e);
-         
-         visitor.eval_begin();
-         std::pair<weight_type, std::vector<Edge> > eval_result = get(wmap,e);
-         visitor.eval_end();
-         
-         visitor.edge_evaluate(e, eval_result.first);
-         put(wlazymap, e, eval_result.first);
-         
-         for (unsigned int ui2=0; ui2<eval_result.second.size(); ui2++)
-         {
-            incsp.update_notify(eval_result.second[ui2]);
-         }
-         
-         visitor.selector_notify_begin();
-         for (unsigned int ui2=0; ui2<eval_result.second.size(); ui2++)
-            evalstrategy.update_notify(eval_result.second[ui2], incsp.inf); // e_weight_old
-         visitor.selector_notify_end();
-      }
+      // apply the results in order
+      lazysp_apply_evals(to_evaluate, weights, changed, changed_ends,
+         wlazymap, evalstrategy, visitor, incsp.inf);
       
+      // notify the inner search of all changed edges at once
+      incsp.update_notify_batch(changed.begin(), changed.end());
    }
 }
 
+/*! \brief Invoke the Lazy Shortest Path graph search algorithm
+ *         (without cancellation).
+ */
+template <class Graph,
+   class WMap, class WLazyMap, class IsEvaledMap,
+   class IncSP, class EvalStrategy, class LazySPVisitor>
+bool lazysp(Graph & g,
+   typename boost::graph_traits<Graph>::vertex_descriptor v_start,
+   typename boost::graph_traits<Graph>::vertex_descriptor v_goal,
+   WMap wmap, WLazyMap wlazymap, IsEvaledMap isevaledmap,
+   std::vector<typename boost::graph_traits<Graph>::edge_descriptor> & path,
+   IncSP incsp, EvalStrategy evalstrategy, LazySPVisitor visitor,
+   lazysp_buffers<
+      typename boost::graph_traits<Graph>::vertex_descriptor,
+      typename boost::graph_traits<Graph>::edge_descriptor,
+      typename boost::property_traits<WLazyMap>::value_type> & buffers)
+{
+   cancel_poll cancel;
+   return lazysp(g, v_start, v_goal, wmap, wlazymap, isevaledmap,
+      path, incsp, evalstrategy, visitor, buffers, cancel);
+}
+
+/*! \brief Invoke the Lazy Shortest Path graph search algorithm
+ *         (with buffers local to this call).
+ */
+template <class Graph,
+   class WMap, class WLazyMap, class IsEvaledMap,
+   class IncSP, class EvalStrategy, class LazySPVisitor>
+bool lazysp(Graph & g,
+   typename boost::graph_traits<Graph>::vertex_descriptor v_start,
+   typename boost::graph_traits<Graph>::vertex_descriptor v_goal,
+   WMap wmap, WLazyMap wlazymap, IsEvaledMap isevaledmap,
+   std::vector<typename boost::graph_traits<Graph>::edge_descriptor> & path,
+   IncSP incsp, EvalStrategy evalstrategy, LazySPVisitor visitor,
+   cancel_poll & cancel)
+{
+   lazysp_buffers<
+      typename boost::graph_traits<Graph>::vertex_descriptor,
+      typename boost::graph_traits<Graph>::edge_descriptor,
+      typename boost::property_traits<WLazyMap>::value_type> buffers;
+   return lazysp(g, v_start, v_goal, wmap, wlazymap, isevaledmap,
+      path, incsp, evalstrategy, visitor, buffers, cancel);
+}
+
+/*! \brief Invoke the Lazy Shortest Path graph search algorithm
+ *         (with buffers local to this call, without cancellation).
+ */
+template <class Graph,
+   class WMap, class WLazyMap, class IsEvaledMap,
+   class IncSP, class EvalStrategy, class LazySPVisitor>
+bool lazysp(Graph & g,
+   typename boost::graph_traits<Graph>::vertex_descriptor v_start,
+   typename boost::graph_traits<Graph>::vertex_descriptor v_goal,
+   WMap wmap, WLazyMap wlazymap, IsEvaledMap isevaledmap,
+   std::vector<typename boost::graph_traits<Graph>::edge_descriptor> & path,
+   IncSP incsp, EvalStrategy evalstrategy, LazySPVisitor visitor)
+{
+   cancel_poll cancel;
+   return lazysp(g, v_start, v_goal, wmap, wlazymap, isevaledmap,
+      path, incsp, evalstrategy, visitor, cancel);
+}
+
 /*! \brief Null visitor for pr_bgl::lazysp.
  */
 class lazysp_visitor_null
@@ -357,6 +735,8 @@ public:
 class lazysp_selector_bisect
 {
 public:
+   // scratch space, reused across calls
+   std::vector<int> dists;
    template <class Graph>
    void get_to_evaluate(
       const Graph & g,
@@ -367,7 +747,7 @@ public:
       // distance for now is just number of edges
       // dist[e_evaled] = 0
       int i;
-      std::vector<int> dists(path.size());
+      dists.resize(path.size());
       // forward
       for (i=0; i<(int)path.size(); i++)
       {
@@ -440,4 +820,68 @@ public:
    void update_notify(Edge e, WeightType e_weight_old) {}
 };
 
+/*! \brief All selector for pr_bgl::lazysp.
+ * 
+ * This selects every unevaluated edge on the path at once
+ * (so that they can be evaluated together, see lazysp_wmap_eval_batch).
+ */
+class lazysp_selector_all
+{
+public:
+   template <class Graph>
+   void get_to_evaluate(
+      const Graph &,
+      const std::vector< std::pair<typename boost::graph_traits<Graph>::edge_descriptor,bool> > & path,
+      std::vector<typename boost::graph_traits<Graph>::edge_descriptor> & to_evaluate)
+   {
+      for (unsigned int ui=0; ui<path.size(); ui++)
+         if (path[ui].second == false)
+            to_evaluate.push_back(path[ui].first);
+   }
+   template <class Edge, class WeightType>
+   void update_notify(Edge, WeightType) {}
+};
+
+/*! \brief Maximum probability selector for pr_bgl::lazysp.
+ * 
+ * This selects the unevaluated edge on the path with the largest
+ * get(probmap,e), e.g. an estimate of the probability that evaluating
+ * it will invalidate the path; ties go to the earliest edge.
+ * 
+ * The probabilities are read afresh for each selection (there is
+ * nothing to update in update_notify()), so maps which are expensive
+ * to query should cache them.
+ */
+template <class ProbMap>
+class lazysp_selector_maxprob
+{
+public:
+   ProbMap probmap;
+   lazysp_selector_maxprob(ProbMap probmap): probmap(probmap) {}
+   template <class Graph>
+   void get_to_evaluate(
+      const Graph &,
+      const std::vector< std::pair<typename boost::graph_traits<Graph>::edge_descriptor,bool> > & path,
+      std::vector<typename boost::graph_traits<Graph>::edge_descriptor> & to_evaluate)
+   {
+      int i_best = -1;
+      double prob_best = 0.0;
+      for (unsigned int ui=0; ui<path.size(); ui++)
+      {
+         if (path[ui].second)
+            continue;
+         double prob = get(probmap, path[ui].first);
+         if (i_best < 0 || prob_best < prob)
+         {
+            i_best = ui;
+            prob_best = prob;
+         }
+      }
+      if (0 <= i_best)
+         to_evaluate.push_back(path[i_best].first);
+   }
+   template <class Edge, class WeightType>
+   void update_notify(Edge, WeightType) {}
+};
+
 } // namespace pr_bgl
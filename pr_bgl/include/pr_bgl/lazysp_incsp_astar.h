@@ -33,12 +33,14 @@ public:
    {
    public:
       Vertex v_throw;
-      throw_visitor(Vertex v_throw): v_throw(v_throw) {}
+      cancel_poll * cancel;
+      throw_visitor(Vertex v_throw, cancel_poll * cancel):
+         v_throw(v_throw), cancel(cancel) {}
       inline void initialize_vertex(Vertex u, const Graph & g) {}
       inline void discover_vertex(Vertex u, const Graph & g) {}
       inline void examine_vertex(Vertex u, const Graph & g)
       {
-         if (u == v_throw)
+         if (u == v_throw || (cancel && cancel->poll()))
             throw throw_visitor_exception();
       }
       inline void examine_edge(Edge e, const Graph & g) {}
@@ -69,13 +71,17 @@ public:
    weight_type inf;
    weight_type zero;
    
+   // polled before each vertex expansion (see lazysp_incsp_set_cancel)
+   cancel_poll * cancel;
+   
    lazysp_incsp_astar(HeuristicMap heuristic_map, PredecessorMap predecessor_map, DistanceMap distance_map,
          CostMap cost_map, ColorMap color_map,
          CompareFunction compare, CombineFunction combine,
          weight_type inf, weight_type zero):
       heuristic_map(heuristic_map), predecessor_map(predecessor_map), distance_map(distance_map),
       cost_map(cost_map), color_map(color_map),
-      compare(compare), combine(combine), inf(inf), zero(zero)
+      compare(compare), combine(combine), inf(inf), zero(zero),
+      cancel(0)
    {}
    
    template <typename WMap>
@@ -88,7 +94,7 @@ public:
             g,
             v_start,
             map_heuristic(heuristic_map), // AStarHeuristic h
-            throw_visitor(v_goal), // AStarVisitor vis
+            throw_visitor(v_goal, cancel), // AStarVisitor vis
             predecessor_map, // PredecessorMap predecessor
             cost_map, // CostMap cost
             distance_map, // DistanceMap distance
@@ -101,7 +107,10 @@ public:
       catch (const throw_visitor_exception & ex)
       {
       }
-         
+      
+      if (cancel && cancel->cancelled())
+         return inf;
+      
       if (get(distance_map,v_goal) == inf)
          return inf;
       
@@ -123,6 +132,11 @@ public:
    void update_notify(Edge e)
    {
    }
+   
+   template <class EdgeIter>
+   void update_notify_batch(EdgeIter ebegin, EdgeIter eend)
+   {
+   }
 };
 
 template <class Graph, class HeuristicMap, class PredecessorMap, class DistanceMap, class CostMap, class ColorMap, typename CompareFunction, typename CombineFunction>
@@ -132,4 +146,12 @@ make_lazysp_incsp_astar(HeuristicMap heuristic_map, PredecessorMap predecessor_m
    return lazysp_incsp_astar<Graph,HeuristicMap,PredecessorMap,DistanceMap,CostMap,ColorMap,CompareFunction,CombineFunction>(heuristic_map, predecessor_map, distance_map, cost_map, color_map, compare, combine, inf, zero);
 }
 
+template <class Graph, class HeuristicMap, class PredecessorMap, class DistanceMap, class CostMap, class ColorMap, typename CompareFunction, typename CombineFunction>
+inline void lazysp_incsp_set_cancel(
+   lazysp_incsp_astar<Graph,HeuristicMap,PredecessorMap,DistanceMap,CostMap,ColorMap,CompareFunction,CombineFunction> & incsp,
+   cancel_poll * cancel)
+{
+   incsp.cancel = cancel;
+}
+
 } // namespace pr_bgl
@@ -0,0 +1,103 @@
+/*! \file lazysp_incsp_cch.h
+ * \author Chris Dellin <cdellin@gmail.com>
+ * \copyright 2015 Carnegie Mellon University
+ * \copyright License: BSD
+ * 
+ * \brief Adaptor to use a customizable contraction hierarchy
+ *        as the inner sp algorithm for pr_bgl::lazysp.
+ */
+
+namespace pr_bgl
+{
+
+/*! \brief Adaptor to use pr_bgl::cch as the inner sp algorithm
+ *         for pr_bgl::lazysp.
+ * 
+ * The hierarchy is built and customized once on construction
+ * (for the fixed topology of g); edge weight changes are then
+ * repaired by partial recustomization before the next query.
+ * 
+ * g is treated as undirected, with symmetric weights.
+ * 
+ * The cancel (see lazysp_incsp_set_cancel) is polled before each
+ * recustomized arc and before the query; the query itself (two scans
+ * up the elimination tree) is not interrupted.  Arcs not yet
+ * recustomized stay queued for the next solve.
+ * 
+ * solve is always called with the same g,v_start,v_goal
+ */
+template <class Graph, class WMap,
+   typename CompareFunction, typename CombineFunction>
+class lazysp_incsp_cch
+{
+public:
+   typedef typename boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef typename boost::graph_traits<Graph>::edge_descriptor Edge;
+   typedef typename boost::property_traits<WMap>::value_type weight_type;
+   
+   weight_type inf;
+   pr_bgl::cch<Graph,WMap,CompareFunction,CombineFunction> cch;
+   
+   // polled before each recustomized arc (see lazysp_incsp_set_cancel)
+   cancel_poll * cancel;
+   
+   lazysp_incsp_cch(
+      const Graph & g, WMap w_map,
+      CompareFunction compare, CombineFunction combine,
+      weight_type inf, weight_type zero):
+      inf(inf),
+      cch(g, w_map, compare, combine, inf, zero),
+      cancel(0)
+   {
+      cch.customize();
+   }
+   
+   weight_type solve(const Graph &, Vertex v_start, Vertex v_goal,
+      WMap, std::vector<Edge> & path)
+   {
+      while (cch.queue.size())
+      {
+         if (cancel && cancel->poll())
+            return inf;
+         cch.recustomize_next();
+      }
+      if (cancel && cancel->poll())
+         return inf;
+      path.clear();
+      return cch.query(v_start, v_goal, path);
+   }
+   
+   void update_notify(Edge e)
+   {
+      cch.update_edge(e);
+   }
+   
+   template <class EdgeIter>
+   void update_notify_batch(EdgeIter ebegin, EdgeIter eend)
+   {
+      for (EdgeIter it=ebegin; it!=eend; ++it)
+         cch.update_edge(*it);
+   }
+};
+
+template <class Graph, class WMap, typename CompareFunction, typename CombineFunction>
+lazysp_incsp_cch<Graph,WMap,CompareFunction,CombineFunction>
+make_lazysp_incsp_cch(
+   const Graph & g, WMap w_map,
+   CompareFunction compare, CombineFunction combine,
+   typename boost::property_traits<WMap>::value_type inf,
+   typename boost::property_traits<WMap>::value_type zero)
+{
+   return lazysp_incsp_cch<Graph,WMap,CompareFunction,CombineFunction>(
+      g, w_map, compare, combine, inf, zero);
+}
+
+template <class Graph, class WMap, typename CompareFunction, typename CombineFunction>
+inline void lazysp_incsp_set_cancel(
+   lazysp_incsp_cch<Graph,WMap,CompareFunction,CombineFunction> & incsp,
+   cancel_poll * cancel)
+{
+   incsp.cancel = cancel;
+}
+
+} // namespace pr_bgl
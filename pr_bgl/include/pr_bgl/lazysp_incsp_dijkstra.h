@@ -32,11 +32,13 @@ public:
    {
    public:
       Vertex v_throw;
-      throw_visitor(Vertex v_throw): v_throw(v_throw) {}
+      cancel_poll * cancel;
+      throw_visitor(Vertex v_throw, cancel_poll * cancel):
+         v_throw(v_throw), cancel(cancel) {}
       inline void initialize_vertex(Vertex u, const Graph & g) {}
       inline void examine_vertex(Vertex u, const Graph & g)
       {
-         if (u == v_throw)
+         if (u == v_throw || (cancel && cancel->poll()))
             throw throw_visitor_exception();
       }
       inline void examine_edge(Edge e, const Graph & g) {}
@@ -53,12 +55,16 @@ public:
    weight_type inf;
    weight_type zero;
    
+   // polled before each vertex expansion (see lazysp_incsp_set_cancel)
+   cancel_poll * cancel;
+   
    lazysp_incsp_dijkstra(
          PredecessorMap predecessor_map, DistanceMap distance_map,
          CompareFunction compare, CombineFunction combine,
          weight_type inf, weight_type zero):
       predecessor_map(predecessor_map), distance_map(distance_map),
-      compare(compare), combine(combine), inf(inf), zero(zero)
+      compare(compare), combine(combine), inf(inf), zero(zero),
+      cancel(0)
    {
    }
    
@@ -76,14 +82,17 @@ public:
             wmap,
             get(boost::vertex_index, g), // implicit vertex index map
             compare, combine, inf, zero,
-            throw_visitor(v_goal)
+            throw_visitor(v_goal, cancel)
             //boost::make_dijkstra_visitor(boost::null_visitor())
          );
       }
       catch (const throw_visitor_exception & ex)
       {
       }
-         
+      
+      if (cancel && cancel->cancelled())
+         return inf;
+      
       if (get(distance_map,v_goal) == inf)
          return inf;
       
@@ -105,6 +114,11 @@ public:
    void update_notify(Edge e)
    {
    }
+   
+   template <class EdgeIter>
+   void update_notify_batch(EdgeIter, EdgeIter)
+   {
+   }
 };
 
 template <class Graph, class PredecessorMap, class DistanceMap, typename CompareFunction, typename CombineFunction>
@@ -114,4 +128,12 @@ make_lazysp_incsp_dijkstra(PredecessorMap predecessor_map, DistanceMap distance_
    return lazysp_incsp_dijkstra<Graph,PredecessorMap,DistanceMap,CompareFunction,CombineFunction>(predecessor_map, distance_map, compare, combine, inf, zero);
 }
 
+template <class Graph, class PredecessorMap, class DistanceMap, typename CompareFunction, typename CombineFunction>
+inline void lazysp_incsp_set_cancel(
+   lazysp_incsp_dijkstra<Graph,PredecessorMap,DistanceMap,CompareFunction,CombineFunction> & incsp,
+   cancel_poll * cancel)
+{
+   incsp.cancel = cancel;
+}
+
 } // namespace pr_bgl
@@ -53,6 +53,14 @@ with the lsb=0: lower vertex index is start-side
 \endverbatim
  *
  * due to wincbi stuff, wmap is not necessarily symmetric!
+ * 
+ * if do_resume is set, the start/goal maps are assumed to already hold
+ * the result of a previous search
+ * (e.g. over a subgraph with fewer edges),
+ * which is continued incrementally (see incbi::resume)
+ * 
+ * if parallel is set, the start and goal frontiers of each inner search
+ * are expanded on two threads (see incbi::compute_shortest_path_parallel)
  */
 template <class Graph, class ActualWMap,
    class StartPredecessorMap, class StartDistanceMap, class StartDistanceLookaheadMap,
@@ -79,6 +87,12 @@ public:
    EdgeVectorMap edge_vector_map;
    weight_type inf;
    
+   // polled before each vertex expansion (see lazysp_incsp_set_cancel)
+   cancel_poll * cancel;
+   
+   // scratch space for update_notify_batch
+   std::vector<Vertex> batch_vertices;
+   
    // incbi instance
    pr_bgl::incbi<Graph,
       StartPredecessorMap,StartDistanceMap,StartDistanceLookaheadMap,
@@ -103,7 +117,8 @@ public:
       weight_type goal_margin,
       CompareFunction compare, CombineFunction combine,
       weight_type inf, weight_type zero,
-      IncBiVisitor vis, IncBiBalancer balancer):
+      IncBiVisitor vis, IncBiBalancer balancer,
+      bool do_resume = false, bool parallel = false):
       g(g), v_start(v_start), v_goal(v_goal),
       w_map(w_map),
       start_predecessor(start_predecessor),
@@ -112,6 +127,7 @@ public:
       goal_distance(goal_distance),
       edge_vector_map(edge_vector_map),
       inf(inf),
+      cancel(0),
       incbi(g, v_start, v_goal,
          start_predecessor, start_distance, start_distance_lookahead,
          goal_predecessor, goal_distance, goal_distance_lookahead,
@@ -124,7 +140,7 @@ public:
          //weight_type(),
          compare, combine, inf, zero,
          goal_margin,
-         vis, balancer)
+         vis, balancer, do_resume, parallel)
    {
    }
    
@@ -132,9 +148,9 @@ public:
    weight_type solve(const Graph & g, Vertex v_start, Vertex v_goal,
       LazySPWMap wmap, std::vector<Edge> & path)
    {
-      std::pair<size_t,bool> spresult = incbi.compute_shortest_path();
+      std::pair<size_t,bool> spresult = incbi.compute_shortest_path(cancel);
       
-      // no solution?
+      // no solution (or cancelled)?
       if (!spresult.second)
          return inf;
       
@@ -206,6 +222,41 @@ public:
       incbi.goal_update_vertex(v);
       incbi.update_edge(evu);
    }
+   
+   // each affected vertex (either endpoint of a changed edge)
+   // has its start and goal lookaheads recomputed once,
+   // and then its queue entries updated once,
+   // before the connection queue entries of the changed edges
+   // (in both directions) are updated
+   template <class EdgeIter>
+   void update_notify_batch(EdgeIter ebegin, EdgeIter eend)
+   {
+      batch_vertices.clear();
+      for (EdgeIter it=ebegin; it!=eend; ++it)
+      {
+         batch_vertices.push_back(source(*it,g));
+         batch_vertices.push_back(target(*it,g));
+      }
+      std::sort(batch_vertices.begin(), batch_vertices.end());
+      batch_vertices.erase(
+         std::unique(batch_vertices.begin(), batch_vertices.end()),
+         batch_vertices.end());
+      for (unsigned int ui=0; ui<batch_vertices.size(); ui++)
+      {
+         incbi.start_recompute_lookahead(batch_vertices[ui]);
+         incbi.goal_recompute_lookahead(batch_vertices[ui]);
+      }
+      for (unsigned int ui=0; ui<batch_vertices.size(); ui++)
+      {
+         incbi.start_update_vertex(batch_vertices[ui]);
+         incbi.goal_update_vertex(batch_vertices[ui]);
+      }
+      for (EdgeIter it=ebegin; it!=eend; ++it)
+      {
+         incbi.update_edge(*it);
+         incbi.update_edge(edge(target(*it,g),source(*it,g),g).first);
+      }
+   }
 };
 
 template <class Graph, class ActualWMap,
@@ -229,10 +280,24 @@ make_lazysp_incsp_incbi(
    CompareFunction compare, CombineFunction combine,
    typename boost::property_traits<ActualWMap>::value_type inf,
    typename boost::property_traits<ActualWMap>::value_type zero,
-   IncBiVisitor vis, IncBiBalancer balancer)
+   IncBiVisitor vis, IncBiBalancer balancer,
+   bool do_resume = false, bool parallel = false)
 {
    return lazysp_incsp_incbi<Graph,ActualWMap,StartPredecessorMap,StartDistanceMap,StartDistanceLookaheadMap,GoalPredecessorMap,GoalDistanceMap,GoalDistanceLookaheadMap,EdgeIndexMap,EdgeVectorMap,CompareFunction,CombineFunction,IncBiVisitor,IncBiBalancer>(
-      g, v_start, v_goal, w_map, start_predecessor, start_distance, start_distance_lookahead, goal_predecessor, goal_distance, goal_distance_lookahead, edge_index_map, edge_vector_map, goal_margin, compare, combine, inf, zero, vis, balancer);
+      g, v_start, v_goal, w_map, start_predecessor, start_distance, start_distance_lookahead, goal_predecessor, goal_distance, goal_distance_lookahead, edge_index_map, edge_vector_map, goal_margin, compare, combine, inf, zero, vis, balancer, do_resume, parallel);
+}
+
+template <class Graph, class ActualWMap,
+   class StartPredecessorMap, class StartDistanceMap, class StartDistanceLookaheadMap,
+   class GoalPredecessorMap, class GoalDistanceMap, class GoalDistanceLookaheadMap,
+   class EdgeIndexMap, class EdgeVectorMap,
+   typename CompareFunction, typename CombineFunction,
+   class IncBiVisitor, class IncBiBalancer>
+inline void lazysp_incsp_set_cancel(
+   lazysp_incsp_incbi<Graph,ActualWMap,StartPredecessorMap,StartDistanceMap,StartDistanceLookaheadMap,GoalPredecessorMap,GoalDistanceMap,GoalDistanceLookaheadMap,EdgeIndexMap,EdgeVectorMap,CompareFunction,CombineFunction,IncBiVisitor,IncBiBalancer> & incsp,
+   cancel_poll * cancel)
+{
+   incsp.cancel = cancel;
 }
 
 } // namespace pr_bgl
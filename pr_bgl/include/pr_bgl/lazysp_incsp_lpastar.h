@@ -16,6 +16,18 @@ namespace pr_bgl
  * solve returns weight_type::max if a non-infinite path is found
  * 
  * solve is always called with the same g,v_start,v_goal
+ * 
+ * if do_resume is set, the predecessor/distance maps are assumed to
+ * already hold the result of a previous search
+ * (e.g. over a subgraph with fewer edges),
+ * which is continued incrementally (see lpastar::resume)
+ * 
+ * a heuristic_weight above 1.0 makes the search bounded-suboptimal
+ * (see lpastar); returned paths are then within that factor
+ * of the shortest path over the current weights;
+ * if suboptimality is passed, each solve which finds a path
+ * stores there the (tighter) bound it achieved
+ * (see lpastar::suboptimality_bound)
  */
 template <class Graph, class WMap,
    class HeuristicMap, class PredecessorMap, class DistanceMap, class DistanceLookaheadMap,
@@ -47,6 +59,15 @@ public:
    DistanceMap distance_map;
    weight_type inf;
    
+   // polled before each vertex expansion (see lazysp_incsp_set_cancel)
+   cancel_poll * cancel;
+   
+   // if set, receives the bound achieved by each path found
+   double * suboptimality;
+   
+   // scratch space for update_notify_batch
+   std::vector<Vertex> batch_vertices;
+   
    // lpa* instance
    pr_bgl::lpastar<Graph,
       map_heuristic,
@@ -67,11 +88,16 @@ public:
       DistanceLookaheadMap distance_lookahead_map,
       weight_type goal_margin,
       CompareFunction compare, CombineFunction combine,
-      weight_type inf, weight_type zero):
+      weight_type inf, weight_type zero,
+      bool do_resume = false,
+      double heuristic_weight = 1.0,
+      double * suboptimality = 0):
       g(g), v_start(v_start), v_goal(v_goal), w_map(w_map),
       predecessor_map(predecessor_map),
       distance_map(distance_map),
       inf(inf),
+      cancel(0),
+      suboptimality(suboptimality),
       lpastar(g, v_start, v_goal,
          map_heuristic(heuristic_map),
          boost::make_astar_visitor(boost::null_visitor()),
@@ -81,7 +107,7 @@ public:
          w_map,
          get(boost::vertex_index, g), // index_map
          compare, combine, inf, zero,
-         goal_margin)
+         goal_margin, do_resume, heuristic_weight)
    {
    }
    
@@ -89,7 +115,9 @@ public:
       WMap wmap, std::vector<Edge> & path)
    {
       // this stops at the goal vertex
-      lpastar.compute_shortest_path();
+      // (or when cancelled, leaving it resumable)
+      if (!lpastar.compute_shortest_path(cancel))
+         return inf;
       
       // no solution?
       if (get(distance_map,v_goal) == inf)
@@ -107,6 +135,8 @@ public:
       }
       std::reverse(path.begin(),path.end());
       
+      if (suboptimality)
+         *suboptimality = lpastar.suboptimality_bound();
       return get(distance_map,v_goal);
    }
    
@@ -124,6 +154,28 @@ public:
       lpastar.update_predecessor(v, u, wvu);
       lpastar.update_vertex(u);
    }
+   
+   // each affected vertex (either endpoint of a changed edge)
+   // has its lookahead recomputed once, and then its queue entry
+   // updated once, regardless of how many of its edges changed
+   template <class EdgeIter>
+   void update_notify_batch(EdgeIter ebegin, EdgeIter eend)
+   {
+      batch_vertices.clear();
+      for (EdgeIter it=ebegin; it!=eend; ++it)
+      {
+         batch_vertices.push_back(source(*it,g));
+         batch_vertices.push_back(target(*it,g));
+      }
+      std::sort(batch_vertices.begin(), batch_vertices.end());
+      batch_vertices.erase(
+         std::unique(batch_vertices.begin(), batch_vertices.end()),
+         batch_vertices.end());
+      for (unsigned int ui=0; ui<batch_vertices.size(); ui++)
+         lpastar.recompute_lookahead(batch_vertices[ui]);
+      for (unsigned int ui=0; ui<batch_vertices.size(); ui++)
+         lpastar.update_vertex(batch_vertices[ui]);
+   }
 };
 
 template <class Graph, class WMap, class HeuristicMap, class PredecessorMap, class DistanceMap, class DistanceLookaheadMap, typename CompareFunction, typename CombineFunction>
@@ -138,10 +190,21 @@ make_lazysp_incsp_lpastar(
    typename boost::property_traits<WMap>::value_type goal_margin,
    CompareFunction compare, CombineFunction combine,
    typename boost::property_traits<WMap>::value_type inf,
-   typename boost::property_traits<WMap>::value_type zero)
+   typename boost::property_traits<WMap>::value_type zero,
+   bool do_resume = false,
+   double heuristic_weight = 1.0,
+   double * suboptimality = 0)
 {
    return lazysp_incsp_lpastar<Graph,WMap,HeuristicMap,PredecessorMap,DistanceMap,DistanceLookaheadMap,CompareFunction,CombineFunction>(
-      g, v_start, v_goal, w_map, heuristic_map, predecessor_map, distance_map, distance_lookahead_map, goal_margin, compare, combine, inf, zero);
+      g, v_start, v_goal, w_map, heuristic_map, predecessor_map, distance_map, distance_lookahead_map, goal_margin, compare, combine, inf, zero, do_resume, heuristic_weight, suboptimality);
+}
+
+template <class Graph, class WMap, class HeuristicMap, class PredecessorMap, class DistanceMap, class DistanceLookaheadMap, typename CompareFunction, typename CombineFunction>
+inline void lazysp_incsp_set_cancel(
+   lazysp_incsp_lpastar<Graph,WMap,HeuristicMap,PredecessorMap,DistanceMap,DistanceLookaheadMap,CompareFunction,CombineFunction> & incsp,
+   cancel_poll * cancel)
+{
+   incsp.cancel = cancel;
 }
 
 
@@ -149,6 +212,7 @@ make_lazysp_incsp_lpastar(
  * heuristic_map is therefore assumed to be the distance to the v_start vertex!
  * wmap is still the cost for the forward edges.
  * assume that vertex descriptors are the same
+ * heuristic_weight and suboptimality are as for lazysp_incsp_lpastar.
  */
 template <class Graph, class WMap,
    class HeuristicMap, class PredecessorMap, class DistanceMap, class DistanceLookaheadMap,
@@ -182,6 +246,15 @@ public:
    DistanceMap distance_map;
    weight_type inf;
    
+   // polled before each vertex expansion (see lazysp_incsp_set_cancel)
+   cancel_poll * cancel;
+   
+   // if set, receives the bound achieved by each path found
+   double * suboptimality;
+   
+   // scratch space for update_notify_batch
+   std::vector<Vertex> batch_vertices;
+   
    // lpa* instance (on reverse graph!)
    pr_bgl::lpastar<
       RevGraph,
@@ -204,11 +277,16 @@ public:
       DistanceLookaheadMap distance_lookahead_map,
       weight_type goal_margin,
       CompareFunction compare, CombineFunction combine,
-      weight_type inf, weight_type zero):
+      weight_type inf, weight_type zero,
+      bool do_resume = false,
+      double heuristic_weight = 1.0,
+      double * suboptimality = 0):
       g(g), rg(g), v_start(v_start), v_goal(v_goal), w_map(w_map),
       predecessor_map(predecessor_map),
       distance_map(distance_map),
       inf(inf),
+      cancel(0),
+      suboptimality(suboptimality),
       lpastar(rg,
          v_goal, v_start,
          map_heuristic(heuristic_map), // already reversed
@@ -220,7 +298,7 @@ public:
          boost::detail::reverse_graph_edge_property_map<WMap>(w_map),
          get(boost::vertex_index, g), // index_map
          compare, combine, inf, zero,
-         goal_margin)
+         goal_margin, do_resume, heuristic_weight)
    {
    }
    
@@ -228,7 +306,9 @@ public:
       WMap wmap, std::vector<Edge> & path)
    {
       // this stops at the goal vertex
-      lpastar.compute_shortest_path();
+      // (or when cancelled, leaving it resumable)
+      if (!lpastar.compute_shortest_path(cancel))
+         return inf;
       
       // no solution?
       if (get(distance_map,v_start) == inf)
@@ -245,6 +325,8 @@ public:
          v_walk = v_succ;
       }
       
+      if (suboptimality)
+         *suboptimality = lpastar.suboptimality_bound();
       return get(distance_map,v_start);
    }
    
@@ -262,6 +344,28 @@ public:
       lpastar.update_predecessor(v, u, wvu);
       lpastar.update_vertex(u);
    }
+   
+   // each affected vertex (either endpoint of a changed edge)
+   // has its lookahead recomputed once, and then its queue entry
+   // updated once, regardless of how many of its edges changed
+   template <class EdgeIter>
+   void update_notify_batch(EdgeIter ebegin, EdgeIter eend)
+   {
+      batch_vertices.clear();
+      for (EdgeIter it=ebegin; it!=eend; ++it)
+      {
+         batch_vertices.push_back(source(*it,g));
+         batch_vertices.push_back(target(*it,g));
+      }
+      std::sort(batch_vertices.begin(), batch_vertices.end());
+      batch_vertices.erase(
+         std::unique(batch_vertices.begin(), batch_vertices.end()),
+         batch_vertices.end());
+      for (unsigned int ui=0; ui<batch_vertices.size(); ui++)
+         lpastar.recompute_lookahead(batch_vertices[ui]);
+      for (unsigned int ui=0; ui<batch_vertices.size(); ui++)
+         lpastar.update_vertex(batch_vertices[ui]);
+   }
 };
 
 template <class Graph, class WMap, class HeuristicMap, class PredecessorMap, class DistanceMap, class DistanceLookaheadMap, typename CompareFunction, typename CombineFunction>
@@ -276,10 +380,21 @@ make_lazysp_incsp_rlpastar(
    typename boost::property_traits<WMap>::value_type goal_margin,
    CompareFunction compare, CombineFunction combine,
    typename boost::property_traits<WMap>::value_type inf,
-   typename boost::property_traits<WMap>::value_type zero)
+   typename boost::property_traits<WMap>::value_type zero,
+   bool do_resume = false,
+   double heuristic_weight = 1.0,
+   double * suboptimality = 0)
 {
    return lazysp_incsp_rlpastar<Graph,WMap,HeuristicMap,PredecessorMap,DistanceMap,DistanceLookaheadMap,CompareFunction,CombineFunction>(
-      g, v_start, v_goal, w_map, heuristic_map, predecessor_map, distance_map, distance_lookahead_map, goal_margin, compare, combine, inf, zero);
+      g, v_start, v_goal, w_map, heuristic_map, predecessor_map, distance_map, distance_lookahead_map, goal_margin, compare, combine, inf, zero, do_resume, heuristic_weight, suboptimality);
+}
+
+template <class Graph, class WMap, class HeuristicMap, class PredecessorMap, class DistanceMap, class DistanceLookaheadMap, typename CompareFunction, typename CombineFunction>
+inline void lazysp_incsp_set_cancel(
+   lazysp_incsp_rlpastar<Graph,WMap,HeuristicMap,PredecessorMap,DistanceMap,DistanceLookaheadMap,CompareFunction,CombineFunction> & incsp,
+   cancel_poll * cancel)
+{
+   incsp.cancel = cancel;
 }
 
 } // namespace pr_bgl
@@ -45,4 +45,15 @@ get(const lazysp_wmap_identity_map<PropMap> & map,
    return std::make_pair(get(map.prop_map,key), vec);
 }
 
+// evaluation into caller-owned storage (see pr_bgl::lazysp_wmap_eval)
+template <class PropMap>
+inline typename boost::property_traits<PropMap>::value_type
+lazysp_wmap_eval(const lazysp_wmap_identity_map<PropMap> & map,
+   const typename lazysp_wmap_identity_map<PropMap>::key_type & key,
+   std::vector< typename lazysp_wmap_identity_map<PropMap>::key_type > & changed)
+{
+   changed.push_back(key);
+   return get(map.prop_map,key);
+}
+
 } // namespace pr_bgl
@@ -24,6 +24,35 @@ rhs = one-step-lookahead (based on d/g)
 d (DynamicSWSF-FP) = g (LPA*) value = distance map
 rhs (DynamicSWSF-FP) = rhs (LPA*) = distance_lookahead_map
 \endverbatim
+ * 
+ * For D* Lite, run on the reversed graph rooted at the robot's goal,
+ * so that v_goal here is the robot's current position:
+ * 
+ * Sven Koenig and Maxim Likhachev. 2002. D* Lite.
+ * In Eighteenth National Conference on Artificial Intelligence
+ * (AAAI 2002), 476-483.
+ * 
+ * once the robot has moved, a new instance targeting its position
+ * (with the heuristic relative to it) may be resumed from the same maps;
+ * resume() recomputes every key, at O(V+E), in place of D* Lite's
+ * key modifier (k_m), which this implementation does not keep
+ * 
+ * A heuristic_weight above 1.0 inflates the heuristic for
+ * bounded-suboptimal search; as in Anytime D*, only the keys of
+ * overconsistent vertices are inflated, so that the goal distance
+ * found is within heuristic_weight of optimal also after
+ * edge weight increases:
+ * 
+ * Maxim Likhachev, David Ferguson, Geoffrey Gordon, Anthony Stentz,
+ * and Sebastian Thrun. 2005. Anytime Dynamic A*: An Anytime,
+ * Replanning Algorithm. In Proceedings of the International
+ * Conference on Automated Planning and Scheduling (ICAPS 2005).
+ * 
+ * As in ARA* and AD*, a weighted search expands each overconsistent
+ * vertex at most once per compute_shortest_path(); vertices which
+ * become overconsistent again are held on an INCONS list until the
+ * next call, and suboptimality_bound() reports the bound actually
+ * achieved by the goal distance found.
  */
 template <typename Graph, typename AStarHeuristic,
    typename LPAStarVisitor, typename PredecessorMap,
@@ -56,9 +85,18 @@ public:
    CostInf inf;
    CostZero zero;
    weight_type goal_margin;
+   double heuristic_weight;
    
    heap_indexed< std::pair<weight_type,weight_type> > queue;
    
+   // weighted search only: vertices expanded as overconsistent in the
+   // current compute_shortest_path() (CLOSED) have closed_epoch == epoch,
+   // and those which became overconsistent again since are on incons
+   unsigned int epoch;
+   std::vector<unsigned int> closed_epoch;
+   std::vector<Vertex> incons;
+   std::vector<char> in_incons;
+   
    lpastar(
       const Graph & g,
       Vertex v_start, Vertex v_goal,
@@ -70,16 +108,23 @@ public:
       VertexIndexMap index_map,
       CompareFunction compare, CombineFunction combine,
       CostInf inf, CostZero zero,
-      weight_type goal_margin):
+      weight_type goal_margin,
+      bool do_resume = false,
+      double heuristic_weight = 1.0):
       g(g), v_start(v_start), v_goal(v_goal),
       h(h), vis(vis), predecessor(predecessor),
       distance(distance), distance_lookahead(distance_lookahead),
       weight(weight), index_map(index_map),
       compare(compare), combine(combine),
       inf(inf), zero(zero),
-      goal_margin(goal_margin)
+      goal_margin(goal_margin),
+      heuristic_weight(heuristic_weight),
+      epoch(0)
    {
-      reset();
+      if (do_resume)
+         resume();
+      else
+         reset();
    }
 
    void reset()
@@ -93,7 +138,64 @@ public:
       put(predecessor, v_start, v_start);
       put(distance_lookahead, v_start, zero);
       queue.reset();
-      queue.insert(get(index_map,v_start), std::make_pair(h(v_start),0));
+      reset_incons();
+      queue.insert(get(index_map,v_start), calculate_key(v_start));
+   }
+   
+   // this re-uses the existing distance and predecessor values
+   // (e.g. from a previous search over a subgraph of g)
+   // it recalculates all lookahead distances over the current edges
+   // and re-queues all inconsistent vertices
+   // (no distance values are changed, so no expansions are repeated)
+   void resume()
+   {
+      queue.reset();
+      reset_incons();
+      VertexIter vi, vi_end;
+      for (boost::tie(vi,vi_end)=vertices(g); vi!=vi_end; ++vi)
+      {
+         Vertex v = *vi;
+         if (v == v_start)
+            put(predecessor, v_start, v_start);
+         recompute_lookahead(v);
+         if (get(distance,v) != get(distance_lookahead,v))
+            queue.insert(get(index_map,v), calculate_key(v));
+      }
+   }
+   
+   void reset_incons()
+   {
+      epoch = 1;
+      closed_epoch.assign(num_vertices(g), 0);
+      incons.clear();
+      in_incons.assign(num_vertices(g), 0);
+   }
+   
+   // recalculates v's lookahead distance (and predecessor) from scratch
+   // over all of its in-edges,
+   // e.g. after the weights of several of them have changed;
+   // update_vertex(v) must be called afterwards
+   inline void recompute_lookahead(Vertex v)
+   {
+      if (v == v_start)
+      {
+         put(distance_lookahead, v_start, zero);
+         return;
+      }
+      weight_type v_look_best = inf;
+      Vertex v_pred_best = get(predecessor, v);
+      InEdgeIter ei, ei_end;
+      for (boost::tie(ei,ei_end)=in_edges(v,g); ei!=ei_end; ei++)
+      {
+         weight_type v_look_uu = combine(get(distance,source(*ei,g)), get(weight,*ei));
+         if (v_look_uu < v_look_best)
+         {
+            v_look_best = v_look_uu;
+            v_pred_best = source(*ei,g);
+         }
+      }
+      put(predecessor, v, v_pred_best);
+      put(distance_lookahead, v, v_look_best);
    }
    
    inline std::pair<weight_type,weight_type> calculate_key(Vertex u, bool do_goal_margin=false)
@@ -102,7 +204,10 @@ public:
          = std::min(get(distance,u), get(distance_lookahead,u));
       if (do_goal_margin)
          minval += goal_margin;
-      return std::make_pair(minval+h(u), minval);
+      weight_type u_h = h(u);
+      if (heuristic_weight != 1.0 && get(distance,u) > get(distance_lookahead,u))
+         u_h = heuristic_weight * u_h;
+      return std::make_pair(combine(minval,u_h), minval);
    }
    
    // this is called to update vertex v due to either:
@@ -192,6 +297,19 @@ public:
       }
       else // not consistent
       {
+         // weighted: defer re-expansion to the next search (INCONS)
+         if (heuristic_weight != 1.0 && closed_epoch[u_idx] == epoch
+            && u_dist > get(distance_lookahead,u) && u != v_goal)
+         {
+            if (queue.contains(u_idx))
+               queue.remove(u_idx);
+            if (!in_incons[u_idx])
+            {
+               in_incons[u_idx] = 1;
+               incons.push_back(u);
+            }
+            return;
+         }
          if (queue.contains(u_idx))
             queue.update(u_idx, calculate_key(u));
          else
@@ -199,18 +317,33 @@ public:
       }
    }
 
-   void compute_shortest_path()
+   // if cancel is passed, it is polled before each pop,
+   // and false is returned (with the queue intact) if it cancels
+   bool compute_shortest_path(cancel_poll * cancel = 0)
    {
+      // start a new search: move INCONS to OPEN, and clear CLOSED
+      epoch++;
+      for (unsigned int ui=0; ui<incons.size(); ui++)
+      {
+         in_incons[get(index_map,incons[ui])] = 0;
+         update_vertex(incons[ui]);
+      }
+      incons.clear();
+      
       while (queue.size()
          && (queue.top_key() < calculate_key(v_goal,true) // do_goal_margin
          || get(distance_lookahead,v_goal) != get(distance,v_goal)))
       {
+         if (cancel && cancel->poll())
+            return false;
+         
          Vertex u = vertex(queue.top_idx(), g);
          
          vis.examine_vertex(u, g);
          queue.remove_min();
          if (get(distance,u) > get(distance_lookahead,u))
          {
+            closed_epoch[get(index_map,u)] = epoch;
             put(distance, u, get(distance_lookahead,u));
             OutEdgeIter ei, ei_end;
             for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ei++)
@@ -235,6 +368,40 @@ public:
             }
          }
       }
+      return true;
+   }
+   
+   // the factor within which the goal distance found by
+   // compute_shortest_path() is of the shortest path (at most
+   // heuristic_weight); the shortest path is bounded below by the
+   // least unweighted key over OPEN and INCONS (as in ARA*)
+   double suboptimality_bound()
+   {
+      weight_type goal_dist = get(distance,v_goal);
+      if (heuristic_weight == 1.0 || goal_dist == zero)
+         return 1.0;
+      if (goal_dist == inf)
+         return heuristic_weight;
+      weight_type lower = goal_dist;
+      for (size_t loc=1; loc<=queue.size(); loc++)
+      {
+         Vertex u = vertex(queue.idx_at(loc), g);
+         weight_type u_lower = combine(std::min(get(distance,u), get(distance_lookahead,u)), h(u));
+         if (u_lower < lower)
+            lower = u_lower;
+      }
+      for (unsigned int ui=0; ui<incons.size(); ui++)
+      {
+         Vertex u = incons[ui];
+         if (get(distance,u) == get(distance_lookahead,u))
+            continue;
+         weight_type u_lower = combine(std::min(get(distance,u), get(distance_lookahead,u)), h(u));
+         if (u_lower < lower)
+            lower = u_lower;
+      }
+      if (lower == zero)
+         return heuristic_weight;
+      return std::min(heuristic_weight, (double)goal_dist / (double)lower);
    }
 };
 
@@ -0,0 +1,321 @@
+/*! \file prefix_graph.h
+ * \author Chris Dellin <cdellin@gmail.com>
+ * \copyright 2015 Carnegie Mellon University
+ * \copyright License: BSD
+ * 
+ * \brief Contains pr_bgl::prefix_graph.
+ */
+
+namespace pr_bgl
+{
+
+/*! \brief Undirected graph view of a prefix of each out-edge list.
+ * 
+ * The prefix_graph class wraps an existing undirected graph, exposing
+ * only the first get(prefix_map,v) out-edges of each vertex v; this
+ * requires random-access out-edge iterators (e.g. vecS out-edge lists).
+ * 
+ * This is a cheaper alternative to boost::filtered_graph when the
+ * hidden edges are known to be at the end of every out-edge list
+ * (e.g. when each list is sorted by the edge's batch), since out_edges()
+ * is then a contiguous range with no per-edge predicate.  For the view
+ * to be consistent, each edge must be within the prefix of either both
+ * or neither of its endpoints' lists.
+ */
+template <class Graph, class PrefixMap>
+class prefix_graph
+{
+public:
+   typedef boost::graph_traits<Graph> Traits;
+   typedef typename Traits::vertex_descriptor vertex_descriptor;
+   typedef typename Traits::edge_descriptor edge_descriptor;
+   typedef typename Traits::out_edge_iterator out_edge_iterator;
+   typedef typename Traits::in_edge_iterator in_edge_iterator;
+   typedef typename Traits::vertex_iterator vertex_iterator;
+   typedef typename Traits::directed_category directed_category;
+   typedef typename Traits::edge_parallel_category edge_parallel_category;
+   typedef typename Traits::vertices_size_type vertices_size_type;
+   typedef typename Traits::edges_size_type edges_size_type;
+   typedef typename Traits::degree_size_type degree_size_type;
+   
+   struct traversal_category:
+      public boost::bidirectional_graph_tag,
+      public boost::vertex_list_graph_tag,
+      public boost::edge_list_graph_tag
+   {
+   };
+   
+   // iterates over each edge once, from its lower-indexed endpoint
+   class edge_iterator: public boost::iterator_facade<
+      edge_iterator, edge_descriptor, boost::forward_traversal_tag, edge_descriptor>
+   {
+   public:
+      const prefix_graph * pg;
+      vertex_iterator vi;
+      vertex_iterator vi_end;
+      out_edge_iterator ei;
+      out_edge_iterator ei_end;
+      edge_iterator(): pg(0) {}
+      edge_iterator(const prefix_graph * pg, vertex_iterator vi, vertex_iterator vi_end):
+         pg(pg), vi(vi), vi_end(vi_end)
+      {
+         if (vi != vi_end)
+         {
+            start_vertex();
+            skip();
+         }
+      }
+   private:
+      friend class boost::iterator_core_access;
+      inline void start_vertex()
+      {
+         boost::tie(ei,ei_end) = out_edges(*vi, pg->m_g);
+         ei_end = ei + get(pg->prefix_map, *vi);
+      }
+      // advance past (vertex,edge) positions which are not emitted
+      inline void skip()
+      {
+         for (;;)
+         {
+            if (ei == ei_end)
+            {
+               ++vi;
+               if (vi == vi_end)
+                  return;
+               start_vertex();
+               continue;
+            }
+            if (get(boost::vertex_index,pg->m_g,*vi)
+               <= get(boost::vertex_index,pg->m_g,target(*ei,pg->m_g)))
+               return;
+            ++ei;
+         }
+      }
+      inline void increment()
+      {
+         ++ei;
+         skip();
+      }
+      inline bool equal(const edge_iterator & other) const
+      {
+         if (vi == vi_end || other.vi == other.vi_end)
+            return (vi == vi_end) && (other.vi == other.vi_end);
+         return vi == other.vi && ei == other.ei;
+      }
+      inline edge_descriptor dereference() const
+      {
+         return *ei;
+      }
+   };
+   
+   const Graph & m_g;
+   PrefixMap prefix_map;
+   
+   prefix_graph(const Graph & g, PrefixMap prefix_map):
+      m_g(g), prefix_map(prefix_map)
+   {
+   }
+   
+   // bundled properties support
+   template <typename Descriptor>
+   typename boost::graph::detail::bundled_result<Graph,Descriptor>::type &
+   operator[](Descriptor x)
+   {
+      return const_cast<Graph &>(m_g)[x];
+   }
+   
+   template <typename Descriptor>
+   typename boost::graph::detail::bundled_result<Graph,Descriptor>::type const &
+   operator[](Descriptor x) const
+   {
+      return m_g[x];
+   }
+   
+   static vertex_descriptor null_vertex()
+   {
+      return Traits::null_vertex();
+   }
+};
+
+template <class Graph, class PrefixMap>
+prefix_graph<Graph,PrefixMap>
+make_prefix_graph(const Graph & g, PrefixMap prefix_map)
+{
+   return prefix_graph<Graph,PrefixMap>(g, prefix_map);
+}
+
+template <class Graph, class PrefixMap>
+inline typename boost::graph_traits<Graph>::vertices_size_type
+num_vertices(const prefix_graph<Graph,PrefixMap> & g)
+{
+   return num_vertices(g.m_g);
+}
+
+template <class Graph, class PrefixMap>
+inline typename boost::graph_traits<Graph>::vertex_descriptor
+vertex(typename boost::graph_traits<Graph>::vertices_size_type n, const prefix_graph<Graph,PrefixMap> & g)
+{
+   return vertex(n, g.m_g);
+}
+
+template <class Graph, class PrefixMap>
+inline std::pair<typename boost::graph_traits<Graph>::vertex_iterator, typename boost::graph_traits<Graph>::vertex_iterator>
+vertices(const prefix_graph<Graph,PrefixMap> & g)
+{
+   return vertices(g.m_g);
+}
+
+template <class Graph, class PrefixMap>
+inline std::pair<typename boost::graph_traits<Graph>::out_edge_iterator, typename boost::graph_traits<Graph>::out_edge_iterator>
+out_edges(typename boost::graph_traits<Graph>::vertex_descriptor u, const prefix_graph<Graph,PrefixMap> & g)
+{
+   typename boost::graph_traits<Graph>::out_edge_iterator ei, ei_end;
+   boost::tie(ei,ei_end) = out_edges(u, g.m_g);
+   return std::make_pair(ei, ei + get(g.prefix_map,u));
+}
+
+template <class Graph, class PrefixMap>
+inline typename boost::graph_traits<Graph>::degree_size_type
+out_degree(typename boost::graph_traits<Graph>::vertex_descriptor u, const prefix_graph<Graph,PrefixMap> & g)
+{
+   return get(g.prefix_map, u);
+}
+
+template <class Graph, class PrefixMap>
+inline std::pair<typename boost::graph_traits<Graph>::in_edge_iterator, typename boost::graph_traits<Graph>::in_edge_iterator>
+in_edges(typename boost::graph_traits<Graph>::vertex_descriptor u, const prefix_graph<Graph,PrefixMap> & g)
+{
+   // undirected: in-edges are the out-edge list seen from the other side
+   typename boost::graph_traits<Graph>::in_edge_iterator ei, ei_end;
+   boost::tie(ei,ei_end) = in_edges(u, g.m_g);
+   return std::make_pair(ei, ei + get(g.prefix_map,u));
+}
+
+template <class Graph, class PrefixMap>
+inline typename boost::graph_traits<Graph>::degree_size_type
+in_degree(typename boost::graph_traits<Graph>::vertex_descriptor u, const prefix_graph<Graph,PrefixMap> & g)
+{
+   return get(g.prefix_map, u);
+}
+
+template <class Graph, class PrefixMap>
+inline typename boost::graph_traits<Graph>::degree_size_type
+degree(typename boost::graph_traits<Graph>::vertex_descriptor u, const prefix_graph<Graph,PrefixMap> & g)
+{
+   return get(g.prefix_map, u);
+}
+
+template <class Graph, class PrefixMap>
+inline std::pair<typename prefix_graph<Graph,PrefixMap>::edge_iterator, typename prefix_graph<Graph,PrefixMap>::edge_iterator>
+edges(const prefix_graph<Graph,PrefixMap> & g)
+{
+   typedef typename prefix_graph<Graph,PrefixMap>::edge_iterator EdgeIter;
+   typename boost::graph_traits<Graph>::vertex_iterator vi, vi_end;
+   boost::tie(vi,vi_end) = vertices(g.m_g);
+   return std::make_pair(EdgeIter(&g,vi,vi_end), EdgeIter(&g,vi_end,vi_end));
+}
+
+// this walks all vertices
+template <class Graph, class PrefixMap>
+inline typename boost::graph_traits<Graph>::edges_size_type
+num_edges(const prefix_graph<Graph,PrefixMap> & g)
+{
+   typename boost::graph_traits<Graph>::edges_size_type count = 0;
+   typename prefix_graph<Graph,PrefixMap>::edge_iterator ei, ei_end;
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei)
+      count++;
+   return count;
+}
+
+template <class Graph, class PrefixMap>
+inline typename boost::graph_traits<Graph>::vertex_descriptor
+source(typename boost::graph_traits<Graph>::edge_descriptor e, const prefix_graph<Graph,PrefixMap> & g)
+{
+   return source(e, g.m_g);
+}
+
+template <class Graph, class PrefixMap>
+inline typename boost::graph_traits<Graph>::vertex_descriptor
+target(typename boost::graph_traits<Graph>::edge_descriptor e, const prefix_graph<Graph,PrefixMap> & g)
+{
+   return target(e, g.m_g);
+}
+
+template <class Graph, class PrefixMap>
+inline std::pair<typename boost::graph_traits<Graph>::edge_descriptor, bool>
+edge(
+   typename boost::graph_traits<Graph>::vertex_descriptor u,
+   typename boost::graph_traits<Graph>::vertex_descriptor v,
+   const prefix_graph<Graph,PrefixMap> & g)
+{
+   typename boost::graph_traits<Graph>::out_edge_iterator ei, ei_end;
+   for (boost::tie(ei,ei_end)=out_edges(u,g); ei!=ei_end; ++ei)
+      if (target(*ei,g.m_g) == v)
+         return std::make_pair(*ei, true);
+   return std::make_pair(typename boost::graph_traits<Graph>::edge_descriptor(), false);
+}
+
+template <class Graph, class PrefixMap, class Property>
+inline typename boost::property_map<Graph,Property>::type
+get(Property p, prefix_graph<Graph,PrefixMap> & g)
+{
+   return get(p, const_cast<Graph &>(g.m_g));
+}
+
+template <class Graph, class PrefixMap, class Property>
+inline typename boost::property_map<Graph,Property>::const_type
+get(Property p, const prefix_graph<Graph,PrefixMap> & g)
+{
+   return get(p, g.m_g);
+}
+
+template <class Graph, class PrefixMap, class Property, class Key>
+inline typename boost::property_map_value<Graph,Property>::type
+get(Property p, const prefix_graph<Graph,PrefixMap> & g, const Key & k)
+{
+   return get(p, g.m_g, k);
+}
+
+template <class Graph, class PrefixMap, class Property, class Key, class Value>
+inline void
+put(Property p, const prefix_graph<Graph,PrefixMap> & g, const Key & k, const Value & val)
+{
+   put(p, const_cast<Graph &>(g.m_g), k, val);
+}
+
+} // namespace pr_bgl
+
+namespace boost
+{
+
+template <class Graph, class PrefixMap, class Property>
+struct property_map<pr_bgl::prefix_graph<Graph,PrefixMap>, Property>:
+   property_map<Graph, Property>
+{
+};
+
+template <class Graph, class PrefixMap>
+struct vertex_property_type< pr_bgl::prefix_graph<Graph,PrefixMap> >:
+   vertex_property_type<Graph>
+{
+};
+
+template <class Graph, class PrefixMap>
+struct edge_property_type< pr_bgl::prefix_graph<Graph,PrefixMap> >:
+   edge_property_type<Graph>
+{
+};
+
+template <class Graph, class PrefixMap>
+struct vertex_bundle_type< pr_bgl::prefix_graph<Graph,PrefixMap> >:
+   vertex_bundle_type<Graph>
+{
+};
+
+template <class Graph, class PrefixMap>
+struct edge_bundle_type< pr_bgl::prefix_graph<Graph,PrefixMap> >:
+   edge_bundle_type<Graph>
+{
+};
+
+} // namespace boost
@@ -0,0 +1,188 @@
+/* File: cch.cpp
+ * Author: Chris Dellin <cdellin@gmail.com>
+ * Copyright: 2015 Carnegie Mellon University
+ * License: BSD
+ */
+
+#include <stdio.h>
+#include <map>
+
+#include <boost/graph/relax.hpp> // for closed_plus
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+
+#include <pr_bgl/heap_indexed.h>
+#include <pr_bgl/cch.h>
+
+#include <gtest/gtest.h>
+
+typedef boost::adjacency_list<
+   boost::vecS, boost::vecS, boost::undirectedS> Graph;
+typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+typedef boost::graph_traits<Graph>::edge_iterator EdgeIter;
+typedef boost::associative_property_map< std::map<Edge,double> > EdgeWeightMap;
+typedef pr_bgl::cch<Graph, EdgeWeightMap,
+   std::less<double>, boost::closed_plus<double> > CCH;
+
+// compares cch queries between several vertex pairs against dijkstra,
+// and checks that each returned path is connected and of that length
+void check_queries(const Graph & g, std::map<Edge,double> & weights, CCH & cch)
+{
+   const double inf = std::numeric_limits<double>::infinity();
+   for (unsigned int vs=0; vs<num_vertices(g); vs+=37)
+   {
+      std::vector<double> dist(num_vertices(g));
+      boost::dijkstra_shortest_paths(g, vertex(vs,g),
+         boost::weight_map(boost::make_assoc_property_map(weights))
+         .distance_map(boost::make_iterator_property_map(dist.begin(), get(boost::vertex_index,g)))
+         .distance_inf(inf));
+      for (unsigned int vt=0; vt<num_vertices(g); vt+=11)
+      {
+         if (vt == vs)
+            continue;
+         std::vector<Edge> path;
+         double len = cch.query(vertex(vs,g), vertex(vt,g), path);
+         if (dist[vt] == inf)
+         {
+            ASSERT_EQ(inf, len);
+            continue;
+         }
+         ASSERT_DOUBLE_EQ(dist[vt], len);
+         ASSERT_LT(0u, path.size());
+         ASSERT_EQ(vertex(vs,g), source(path[0],g));
+         ASSERT_EQ(vertex(vt,g), target(path.back(),g));
+         double path_len = 0.0;
+         for (unsigned int ui=0; ui<path.size(); ui++)
+         {
+            if (ui)
+            {
+               ASSERT_EQ(target(path[ui-1],g), source(path[ui],g));
+            }
+            path_len += weights[path[ui]];
+         }
+         ASSERT_DOUBLE_EQ(dist[vt], path_len);
+      }
+   }
+}
+
+TEST(CCHTestCase, CCHGridTest)
+{
+   // 8-connected 30x30 grid with pseudorandom weights
+   const unsigned int n = 30;
+   Graph g(n*n);
+   std::map<Edge,double> weights;
+   unsigned int seed = 1;
+   for (unsigned int i=0; i<n; i++)
+   for (unsigned int j=0; j<n; j++)
+   {
+      int di[4] = {0, 1, 1, 1};
+      int dj[4] = {1, 0, 1, -1};
+      for (unsigned int k=0; k<4; k++)
+      {
+         int i2 = i + di[k];
+         int j2 = j + dj[k];
+         if (i2 < 0 || (int)n <= i2 || j2 < 0 || (int)n <= j2)
+            continue;
+         seed = seed * 1103515245 + 12345;
+         Edge e = add_edge(i*n+j, i2*n+j2, g).first;
+         weights[e] = 1.0 + (seed >> 16) % 100 / 10.0;
+      }
+   }
+   
+   CCH cch(g, boost::make_assoc_property_map(weights),
+      std::less<double>(), boost::closed_plus<double>(std::numeric_limits<double>::infinity()),
+      std::numeric_limits<double>::infinity(), 0.0);
+   printf("cch: %lu vertices, %lu edges, %lu arcs\n",
+      num_vertices(g), num_edges(g), cch.arc_head.size());
+   cch.customize();
+   check_queries(g, weights, cch);
+   
+   // block a wall of edges (with one gap), and make others cheaper,
+   // over several rounds of partial recustomization
+   for (unsigned int round=0; round<4; round++)
+   {
+      unsigned int count = 0;
+      EdgeIter ei, ei_end;
+      for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei, ++count)
+      {
+         unsigned int vs = source(*ei,g);
+         unsigned int vt = target(*ei,g);
+         bool crosses = (vs%n <= 5+5*round && 5+5*round < vt%n)
+            || (vt%n <= 5+5*round && 5+5*round < vs%n);
+         if (crosses && vs/n != 3*round+1)
+            weights[*ei] = std::numeric_limits<double>::infinity();
+         else if (count % 17 == round)
+            weights[*ei] = 0.5;
+         else
+            continue;
+         cch.update_edge(*ei);
+      }
+      cch.recustomize();
+      check_queries(g, weights, cch);
+   }
+   
+   // a fresh customization agrees with the repaired arc weights
+   std::vector<double> arc_weight = cch.arc_weight;
+   cch.customize();
+   for (unsigned int a=0; a<arc_weight.size(); a++)
+      ASSERT_EQ(cch.arc_weight[a], arc_weight[a]);
+}
+
+// with parallel edges of different weights, paths are unpacked
+// through the cheapest edge of each pair (whichever of the two it is),
+// also after their weights swap
+TEST(CCHTestCase, CCHParallelEdgesTest)
+{
+   // 4-connected 12x12 grid, with each edge doubled
+   const unsigned int n = 12;
+   Graph g(n*n);
+   std::map<Edge,double> weights;
+   std::vector< std::pair<Edge,Edge> > pairs;
+   unsigned int seed = 3;
+   for (unsigned int i=0; i<n; i++)
+   for (unsigned int j=0; j<n; j++)
+   {
+      int di[2] = {0, 1};
+      int dj[2] = {1, 0};
+      for (unsigned int k=0; k<2; k++)
+      {
+         unsigned int i2 = i + di[k];
+         unsigned int j2 = j + dj[k];
+         if (n <= i2 || n <= j2)
+            continue;
+         seed = seed * 1103515245 + 12345;
+         double w = 1.0 + (seed >> 16) % 100 / 10.0;
+         // alternate which of the pair (and which direction) is cheaper
+         bool heavy_first = (seed >> 8) % 2;
+         Edge e1 = add_edge(i*n+j, i2*n+j2, g).first;
+         Edge e2 = add_edge(i2*n+j2, i*n+j, g).first;
+         weights[e1] = heavy_first ? 3.0*w : w;
+         weights[e2] = heavy_first ? w : 3.0*w;
+         pairs.push_back(std::make_pair(e1,e2));
+      }
+   }
+   
+   CCH cch(g, boost::make_assoc_property_map(weights),
+      std::less<double>(), boost::closed_plus<double>(std::numeric_limits<double>::infinity()),
+      std::numeric_limits<double>::infinity(), 0.0);
+   cch.customize();
+   check_queries(g, weights, cch);
+   
+   // swap the weights within every third pair
+   for (unsigned int ui=0; ui<pairs.size(); ui+=3)
+   {
+      std::swap(weights[pairs[ui].first], weights[pairs[ui].second]);
+      cch.update_edge(pairs[ui].first);
+      cch.update_edge(pairs[ui].second);
+   }
+   cch.recustomize();
+   check_queries(g, weights, cch);
+}
+
+int main(int argc, char **argv)
+{
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -6,10 +6,15 @@
 
 #include <stdio.h>
 
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
 #include <boost/graph/relax.hpp> // for closed_plus
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/dijkstra_shortest_paths.hpp>
 
+#include <pr_bgl/cancel_poll.h>
 #include <pr_bgl/heap_indexed.h>
 #include <pr_bgl/incbi.h>
 
@@ -106,6 +111,297 @@ TEST(IncBiTestCase, IncBiTest)
    
 }
 
+// owns the vertex maps for one incbi search over a grid graph
+template <class Graph>
+struct grid_incbi
+{
+   typedef typename boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::iterator_property_map<
+      typename std::vector<Vertex>::iterator,
+      typename boost::property_map<Graph, boost::vertex_index_t>::type > VertexVertexMap;
+   typedef boost::iterator_property_map<
+      std::vector<double>::iterator,
+      typename boost::property_map<Graph, boost::vertex_index_t>::type > VertexWeightMap;
+   
+   std::vector<Vertex> start_predecessor;
+   std::vector<double> start_dist;
+   std::vector<double> start_dist_lookahead;
+   std::vector<Vertex> goal_predecessor;
+   std::vector<double> goal_dist;
+   std::vector<double> goal_dist_lookahead;
+   
+   pr_bgl::incbi<Graph,
+      VertexVertexMap,VertexWeightMap,VertexWeightMap,
+      VertexVertexMap,VertexWeightMap,VertexWeightMap,
+      typename boost::property_map<Graph, boost::edge_weight_t>::type,
+      typename boost::property_map<Graph, boost::vertex_index_t>::type,
+      typename boost::property_map<Graph, boost::edge_index_t>::type,
+      std::less<double>, boost::closed_plus<double>,
+      double, double,
+      pr_bgl::incbi_visitor_null<Graph>,
+      pr_bgl::incbi_balancer_distance<Vertex,double>
+   > incbi;
+   
+   grid_incbi(Graph & g, Vertex v_start, Vertex v_goal, bool parallel):
+      start_predecessor(num_vertices(g)),
+      start_dist(num_vertices(g)),
+      start_dist_lookahead(num_vertices(g)),
+      goal_predecessor(num_vertices(g)),
+      goal_dist(num_vertices(g)),
+      goal_dist_lookahead(num_vertices(g)),
+      incbi(g, v_start, v_goal,
+         VertexVertexMap(start_predecessor.begin(), get(boost::vertex_index,g)),
+         VertexWeightMap(start_dist.begin(), get(boost::vertex_index,g)),
+         VertexWeightMap(start_dist_lookahead.begin(), get(boost::vertex_index,g)),
+         VertexVertexMap(goal_predecessor.begin(), get(boost::vertex_index,g)),
+         VertexWeightMap(goal_dist.begin(), get(boost::vertex_index,g)),
+         VertexWeightMap(goal_dist_lookahead.begin(), get(boost::vertex_index,g)),
+         get(boost::edge_weight,g),
+         get(boost::vertex_index,g), get(boost::edge_index,g),
+         std::less<double>(), // compare
+         boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
+         std::numeric_limits<double>::infinity(), 0.0,
+         0.0, // goal_margin
+         pr_bgl::incbi_visitor_null<Graph>(),
+         pr_bgl::incbi_balancer_distance<Vertex,double>(0.5),
+         false, // do_resume
+         parallel)
+   {
+   }
+   
+   double solve()
+   {
+      std::pair<size_t,bool> ret = incbi.compute_shortest_path();
+      if (!ret.second)
+         return std::numeric_limits<double>::infinity();
+      return incbi.conn_queue.top_key().path_length;
+   }
+   
+   template <class Edge>
+   void update_notify(const Graph & g, Edge e)
+   {
+      double w = get(boost::edge_weight, g, e);
+      incbi.start_update_predecessor(source(e,g), target(e,g), w);
+      incbi.start_update_vertex(target(e,g));
+      incbi.goal_update_successor(source(e,g), target(e,g), w);
+      incbi.goal_update_vertex(source(e,g));
+      incbi.update_edge(e);
+   }
+};
+
+TEST(IncBiTestCase, IncBiParallelTest)
+{
+   // random-weight grid with edges in both directions;
+   // the serial and parallel searches should agree with dijkstra's,
+   // both initially and after incremental edge weight changes
+   typedef boost::adjacency_list<
+      boost::vecS, boost::vecS, boost::bidirectionalS,
+      boost::no_property,
+      boost::property<boost::edge_index_t, size_t,
+      boost::property<boost::edge_weight_t, double> > > Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   
+   const unsigned int n = 60;
+   Graph g(n*n);
+   unsigned int rng = 12345;
+   std::vector<Edge> es;
+   for (unsigned int i=0; i<n; i++)
+   for (unsigned int j=0; j<n; j++)
+   {
+      for (unsigned int k=0; k<2; k++)
+      {
+         unsigned int ni = i + (k==0 ? 1 : 0);
+         unsigned int nj = j + (k==1 ? 1 : 0);
+         if (ni == n || nj == n)
+            continue;
+         rng = rng * 1103515245 + 12345;
+         double w = 1.0 + ((rng >> 16) % 100) / 10.0;
+         Edge e = add_edge(i*n+j, ni*n+nj, g).first;
+         put(boost::edge_index, g, e, es.size());
+         put(boost::edge_weight, g, e, w);
+         es.push_back(e);
+         e = add_edge(ni*n+nj, i*n+j, g).first;
+         put(boost::edge_index, g, e, es.size());
+         put(boost::edge_weight, g, e, w);
+         es.push_back(e);
+      }
+   }
+   Vertex v_start = 0;
+   Vertex v_goal = n*n-1;
+   
+   grid_incbi<Graph> serial(g, v_start, v_goal, false);
+   grid_incbi<Graph> parallel(g, v_start, v_goal, true);
+   std::vector<double> dists(num_vertices(g));
+   
+   for (unsigned int round=0; round<4; round++)
+   {
+      if (round)
+      {
+         // block some edges, and make some others cheaper
+         for (unsigned int ui=0; ui<100; ui++)
+         {
+            rng = rng * 1103515245 + 12345;
+            Edge e = es[(rng >> 8) % es.size()];
+            if (ui % 4)
+               put(boost::edge_weight, g, e, std::numeric_limits<double>::infinity());
+            else
+               put(boost::edge_weight, g, e, 0.5);
+            serial.update_notify(g, e);
+            parallel.update_notify(g, e);
+         }
+      }
+      
+      boost::dijkstra_shortest_paths(g, v_start,
+         boost::distance_map(boost::make_iterator_property_map(dists.begin(), get(boost::vertex_index,g))));
+      
+      double len_serial = serial.solve();
+      double len_parallel = parallel.solve();
+      printf("round %u: dijkstra %f serial %f parallel %f\n",
+         round, dists[v_goal], len_serial, len_parallel);
+      ASSERT_DOUBLE_EQ(dists[v_goal], len_serial);
+      ASSERT_DOUBLE_EQ(dists[v_goal], len_parallel);
+   }
+}
+
+TEST(IncBiTestCase, IncBiParallelConsistentTest)
+{
+   // a search resumed with every vertex already consistent has
+   // both queues empty, so its path comes from the connection queue
+   typedef boost::adjacency_list<
+      boost::vecS, boost::vecS, boost::bidirectionalS,
+      boost::no_property,
+      boost::property<boost::edge_index_t, size_t,
+      boost::property<boost::edge_weight_t, double> > > Graph;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   
+   Graph g(3);
+   Edge e = add_edge(0, 1, g).first;
+   put(boost::edge_index, g, e, 0);
+   put(boost::edge_weight, g, e, 1.0);
+   e = add_edge(1, 2, g).first;
+   put(boost::edge_index, g, e, 1);
+   put(boost::edge_weight, g, e, 2.0);
+   
+   for (unsigned int ui=0; ui<2; ui++)
+   {
+      grid_incbi<Graph> search(g, 0, 2, ui==1);
+      const double start_dist[3] = {0.0, 1.0, 3.0};
+      const double goal_dist[3] = {3.0, 2.0, 0.0};
+      for (unsigned int vi=0; vi<3; vi++)
+      {
+         search.start_dist[vi] = start_dist[vi];
+         search.goal_dist[vi] = goal_dist[vi];
+      }
+      search.incbi.resume();
+      ASSERT_EQ(0u, search.incbi.start_queue.size());
+      ASSERT_EQ(0u, search.incbi.goal_queue.size());
+      ASSERT_DOUBLE_EQ(3.0, search.solve());
+   }
+}
+
+TEST(IncBiTestCase, IncBiResumedTest)
+{
+   // a search resumed from the distances of a previous search,
+   // after edge weights change and vertices are added,
+   // agrees with a fresh search (and dijkstra's)
+   typedef boost::adjacency_list<
+      boost::vecS, boost::vecS, boost::bidirectionalS,
+      boost::no_property,
+      boost::property<boost::edge_index_t, size_t,
+      boost::property<boost::edge_weight_t, double> > > Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   
+   const unsigned int n = 40;
+   for (unsigned int ui=0; ui<2; ui++)
+   {
+      bool parallel = (ui == 1);
+      Graph g(n*n);
+      unsigned int rng = 54321;
+      std::vector<Edge> es;
+      for (unsigned int i=0; i<n; i++)
+      for (unsigned int j=0; j<n; j++)
+      {
+         for (unsigned int k=0; k<2; k++)
+         {
+            unsigned int ni = i + (k==0 ? 1 : 0);
+            unsigned int nj = j + (k==1 ? 1 : 0);
+            if (ni == n || nj == n)
+               continue;
+            rng = rng * 1103515245 + 12345;
+            double w = 1.0 + ((rng >> 16) % 100) / 10.0;
+            Edge e = add_edge(i*n+j, ni*n+nj, g).first;
+            put(boost::edge_index, g, e, es.size());
+            put(boost::edge_weight, g, e, w);
+            es.push_back(e);
+            e = add_edge(ni*n+nj, i*n+j, g).first;
+            put(boost::edge_index, g, e, es.size());
+            put(boost::edge_weight, g, e, w);
+            es.push_back(e);
+         }
+      }
+      Vertex v_start = 0;
+      Vertex v_goal = n*n-1;
+      
+      grid_incbi<Graph> first(g, v_start, v_goal, parallel);
+      ASSERT_GT(std::numeric_limits<double>::infinity(), first.solve());
+      
+      // block some edges, and make some others cheaper
+      for (unsigned int uj=0; uj<20; uj++)
+      {
+         rng = rng * 1103515245 + 12345;
+         Edge e = es[(rng >> 8) % es.size()];
+         if (uj % 4)
+            put(boost::edge_weight, g, e, std::numeric_limits<double>::infinity());
+         else
+            put(boost::edge_weight, g, e, 0.5);
+      }
+      
+      // add shortcut vertices between pairs of grid vertices
+      for (unsigned int uj=0; uj<20; uj++)
+      {
+         rng = rng * 1103515245 + 12345;
+         Vertex va = (rng >> 8) % (n*n);
+         rng = rng * 1103515245 + 12345;
+         Vertex vb = (rng >> 8) % (n*n);
+         Vertex v = add_vertex(g);
+         Vertex ends[2] = {va, vb};
+         for (unsigned int uk=0; uk<2; uk++)
+         {
+            Edge e = add_edge(ends[uk], v, g).first;
+            put(boost::edge_index, g, e, es.size());
+            put(boost::edge_weight, g, e, 2.0);
+            es.push_back(e);
+            e = add_edge(v, ends[uk], g).first;
+            put(boost::edge_index, g, e, es.size());
+            put(boost::edge_weight, g, e, 2.0);
+            es.push_back(e);
+         }
+      }
+      
+      // the new vertices start unreached (as after construction),
+      // and the others keep their values from the first search
+      grid_incbi<Graph> resumed(g, v_start, v_goal, parallel);
+      std::copy(first.start_predecessor.begin(), first.start_predecessor.end(), resumed.start_predecessor.begin());
+      std::copy(first.start_dist.begin(), first.start_dist.end(), resumed.start_dist.begin());
+      std::copy(first.start_dist_lookahead.begin(), first.start_dist_lookahead.end(), resumed.start_dist_lookahead.begin());
+      std::copy(first.goal_predecessor.begin(), first.goal_predecessor.end(), resumed.goal_predecessor.begin());
+      std::copy(first.goal_dist.begin(), first.goal_dist.end(), resumed.goal_dist.begin());
+      std::copy(first.goal_dist_lookahead.begin(), first.goal_dist_lookahead.end(), resumed.goal_dist_lookahead.begin());
+      resumed.incbi.resume();
+      
+      grid_incbi<Graph> fresh(g, v_start, v_goal, parallel);
+      
+      std::vector<double> dists(num_vertices(g));
+      boost::dijkstra_shortest_paths(g, v_start,
+         boost::distance_map(boost::make_iterator_property_map(dists.begin(), get(boost::vertex_index,g))));
+      
+      ASSERT_DOUBLE_EQ(dists[v_goal], fresh.solve());
+      ASSERT_DOUBLE_EQ(dists[v_goal], resumed.solve());
+   }
+}
+
 int main(int argc, char **argv)
 {
    testing::InitGoogleTest(&argc, argv);
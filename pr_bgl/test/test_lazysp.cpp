@@ -5,18 +5,29 @@
  */
 
 #include <cstdio>
+#include <cstdlib>
+#include <new>
 #include <map>
 #include <string>
 #include <sstream>
 
+#include <boost/function.hpp>
 #include <boost/property_map/dynamic_property_map.hpp>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graphml.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
+#include <boost/graph/astar_search.hpp>
+#include <boost/graph/reverse_graph.hpp>
 
+#include <pr_bgl/cancel_poll.h>
 #include <pr_bgl/flag_set_map.h>
+#include <pr_bgl/heap_indexed.h>
+#include <pr_bgl/lpastar.h>
 #include <pr_bgl/lazysp.h>
 #include <pr_bgl/lazysp_incsp_dijkstra.h>
+#include <pr_bgl/lazysp_incsp_lpastar.h>
+#include <pr_bgl/cch.h>
+#include <pr_bgl/lazysp_incsp_cch.h>
 #include <pr_bgl/lazysp_wmap_identity_map.h>
 
 #include <gtest/gtest.h>
@@ -24,6 +35,24 @@
 #define XSTR(s) STR(s)
 #define STR(s) # s
 
+// count global allocations, so that tests can check that
+// the lazysp main loop reuses its buffers
+static unsigned long num_allocs = 0;
+
+void * operator new(std::size_t size)
+{
+   num_allocs++;
+   void * p = malloc(size ? size : 1);
+   if (!p)
+      throw std::bad_alloc();
+   return p;
+}
+
+void operator delete(void * p) throw()
+{
+   free(p);
+}
+
 TEST(LazySPTestCase, LazySPTest)
 {
    typedef boost::adjacency_list<
@@ -100,6 +129,662 @@ TEST(LazySPTestCase, LazySPTest)
    ASSERT_EQ(22, target(path[4],g));
 }
 
+TEST(LazySPTestCase, LazySPLPAStarBatchTest)
+{
+   typedef boost::adjacency_list<
+      boost::vecS, // Edgelist ds, for per-vertex out-edges
+      boost::vecS, // VertexList ds, for vertex set
+      boost::undirectedS // type of graph
+      > Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   typedef boost::graph_traits<Graph>::edge_iterator EdgeIter;
+   
+   Graph g;
+   std::map<Vertex, std::string> state;
+   std::map<Edge, double> dist;
+   std::map<Edge, bool> isevaled;
+   
+   // read the test graph
+   std::ifstream fp;
+   fp.open(XSTR(DATADIR) "/halton2d.xml");
+   boost::dynamic_properties props;
+   props.property("state", boost::make_assoc_property_map(state));
+   boost::read_graphml(fp, g, props);
+   
+   // compute distances, and block every third edge
+   std::map<Edge, double> dist_lazy;
+   EdgeIter ei, ei_end;
+   unsigned int ei_count = 0;
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei, ++ei_count)
+   {
+      Vertex v1 = source(*ei, g);
+      Vertex v2 = target(*ei, g);
+      double v1x, v1y, v2x, v2y;
+      std::stringstream ss(state[v1] + " " + state[v2]);
+      ss >> v1x >> v1y >> v2x >> v2y;
+      dist_lazy[*ei] = sqrt(pow(v2x-v1x,2.) + pow(v2y-v1y,2.));
+      dist[*ei] = (ei_count % 3 == 0)
+         ? std::numeric_limits<double>::infinity() : dist_lazy[*ei];
+   }
+   
+   // reference solution
+   std::vector<double> v_truedist(num_vertices(g));
+   boost::dijkstra_shortest_paths(g, vertex(17,g),
+      boost::weight_map(boost::make_assoc_property_map(dist))
+      .distance_map(boost::make_iterator_property_map(v_truedist.begin(), get(boost::vertex_index,g))));
+   
+   // run lazysp with lpa* as the inner search;
+   // the fwdexpand selector evaluates several edges per round,
+   // which are passed to the inner search together
+   std::vector<Edge> path;
+   std::vector<double> v_hvalues(num_vertices(g), 0.0);
+   std::vector<Vertex> v_startpreds(num_vertices(g));
+   std::vector<double> v_startdist(num_vertices(g));
+   std::vector<double> v_startdistlookahead(num_vertices(g));
+   
+   bool success = pr_bgl::lazysp(
+      g, vertex(17,g), vertex(22,g),
+      pr_bgl::make_lazysp_wmap_identity_map(
+         pr_bgl::make_flag_set_map(
+            boost::make_assoc_property_map(dist), 
+            boost::make_assoc_property_map(isevaled))),
+      boost::make_assoc_property_map(dist_lazy),
+      boost::make_assoc_property_map(isevaled),
+      path,
+      pr_bgl::make_lazysp_incsp_lpastar(g, vertex(17,g), vertex(22,g),
+         boost::make_assoc_property_map(dist_lazy),
+         boost::make_iterator_property_map(v_hvalues.begin(), get(boost::vertex_index,g)), // heuristic_map
+         boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+         boost::make_iterator_property_map(v_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
+         boost::make_iterator_property_map(v_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+         0.0, // goal_margin
+         std::less<double>(), // compare
+         boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
+         std::numeric_limits<double>::infinity(), 0.0),
+      pr_bgl::lazysp_selector_fwdexpand(),
+      pr_bgl::lazysp_visitor_null());
+   ASSERT_EQ(v_truedist[22] != std::numeric_limits<double>::infinity(), success);
+   
+   // validate path length
+   double pathlen = 0.0;
+   for (unsigned int ui=0; ui<path.size(); ui++)
+      pathlen += dist[path[ui]];
+   ASSERT_DOUBLE_EQ(v_truedist[22], pathlen);
+}
+
+bool cancel_always()
+{
+   return true;
+}
+
+TEST(LazySPTestCase, LazySPCCHTest)
+{
+   typedef boost::adjacency_list<
+      boost::vecS, // Edgelist ds, for per-vertex out-edges
+      boost::vecS, // VertexList ds, for vertex set
+      boost::undirectedS // type of graph
+      > Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   typedef boost::graph_traits<Graph>::edge_iterator EdgeIter;
+   
+   Graph g;
+   std::map<Vertex, std::string> state;
+   std::map<Edge, double> dist;
+   std::map<Edge, bool> isevaled;
+   
+   // read the test graph
+   std::ifstream fp;
+   fp.open(XSTR(DATADIR) "/halton2d.xml");
+   boost::dynamic_properties props;
+   props.property("state", boost::make_assoc_property_map(state));
+   boost::read_graphml(fp, g, props);
+   
+   // compute distances, and block every third edge
+   std::map<Edge, double> dist_lazy;
+   EdgeIter ei, ei_end;
+   unsigned int ei_count = 0;
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei, ++ei_count)
+   {
+      Vertex v1 = source(*ei, g);
+      Vertex v2 = target(*ei, g);
+      double v1x, v1y, v2x, v2y;
+      std::stringstream ss(state[v1] + " " + state[v2]);
+      ss >> v1x >> v1y >> v2x >> v2y;
+      dist_lazy[*ei] = sqrt(pow(v2x-v1x,2.) + pow(v2y-v1y,2.));
+      dist[*ei] = (ei_count % 3 == 0)
+         ? std::numeric_limits<double>::infinity() : dist_lazy[*ei];
+   }
+   
+   // reference solution
+   std::vector<double> v_truedist(num_vertices(g));
+   boost::dijkstra_shortest_paths(g, vertex(17,g),
+      boost::weight_map(boost::make_assoc_property_map(dist))
+      .distance_map(boost::make_iterator_property_map(v_truedist.begin(), get(boost::vertex_index,g))));
+   
+   // run lazysp with the contraction hierarchy as the inner search
+   std::vector<Edge> path;
+   bool success = pr_bgl::lazysp(
+      g, vertex(17,g), vertex(22,g),
+      pr_bgl::make_lazysp_wmap_identity_map(
+         pr_bgl::make_flag_set_map(
+            boost::make_assoc_property_map(dist), 
+            boost::make_assoc_property_map(isevaled))),
+      boost::make_assoc_property_map(dist_lazy),
+      boost::make_assoc_property_map(isevaled),
+      path,
+      pr_bgl::make_lazysp_incsp_cch(g,
+         boost::make_assoc_property_map(dist_lazy),
+         std::less<double>(), // compare
+         boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
+         std::numeric_limits<double>::infinity(), 0.0),
+      pr_bgl::lazysp_selector_fwdexpand(),
+      pr_bgl::lazysp_visitor_null());
+   ASSERT_EQ(v_truedist[22] != std::numeric_limits<double>::infinity(), success);
+   
+   // validate path length
+   double pathlen = 0.0;
+   for (unsigned int ui=0; ui<path.size(); ui++)
+      pathlen += dist[path[ui]];
+   ASSERT_DOUBLE_EQ(v_truedist[22], pathlen);
+   
+   // a solve cancelled during recustomization returns inf,
+   // and the next (uncancelled) solve finishes it
+   std::map<Edge, double> dist_cancel = dist_lazy;
+   pr_bgl::lazysp_incsp_cch<Graph,
+      boost::associative_property_map< std::map<Edge,double> >,
+      std::less<double>, boost::closed_plus<double> > incsp(g,
+         boost::make_assoc_property_map(dist_cancel),
+         std::less<double>(), // compare
+         boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
+         std::numeric_limits<double>::infinity(), 0.0);
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei)
+   {
+      dist_cancel[*ei] = dist[*ei];
+      incsp.update_notify(*ei);
+   }
+   pr_bgl::cancel_poll cancel(cancel_always);
+   pr_bgl::lazysp_incsp_set_cancel(incsp, &cancel);
+   ASSERT_EQ(std::numeric_limits<double>::infinity(),
+      incsp.solve(g, vertex(17,g), vertex(22,g), boost::make_assoc_property_map(dist_cancel), path));
+   ASSERT_TRUE(cancel.cancelled());
+   ASSERT_LT(0u, incsp.cch.queue.size());
+   pr_bgl::lazysp_incsp_set_cancel(incsp, 0);
+   ASSERT_DOUBLE_EQ(v_truedist[22],
+      incsp.solve(g, vertex(17,g), vertex(22,g), boost::make_assoc_property_map(dist_cancel), path));
+}
+
+// identity wmap which records the sizes of the batches it evaluates,
+// and evaluates each batch in reverse order
+template <class PropMap>
+class batch_recording_wmap: public pr_bgl::lazysp_wmap_identity_map<PropMap>
+{
+public:
+   std::vector<unsigned int> & batch_sizes;
+   batch_recording_wmap(PropMap prop_map, std::vector<unsigned int> & batch_sizes):
+      pr_bgl::lazysp_wmap_identity_map<PropMap>(prop_map), batch_sizes(batch_sizes)
+   {
+   }
+};
+
+template <class PropMap, class Edge>
+void lazysp_wmap_eval_batch(const batch_recording_wmap<PropMap> & wmap,
+   const std::vector<Edge> & es, std::vector<double> & weights,
+   std::vector<Edge> & changed, std::vector<std::size_t> & changed_ends)
+{
+   wmap.batch_sizes.push_back(es.size());
+   weights.resize(es.size());
+   for (unsigned int ui=es.size(); ui>0; ui--)
+      weights[ui-1] = get(wmap.prop_map, es[ui-1]);
+   for (unsigned int ui=0; ui<es.size(); ui++)
+   {
+      changed.push_back(es[ui]);
+      changed_ends.push_back(changed.size());
+   }
+}
+
+TEST(LazySPTestCase, LazySPBatchEvalTest)
+{
+   typedef boost::adjacency_list<
+      boost::vecS, // Edgelist ds, for per-vertex out-edges
+      boost::vecS, // VertexList ds, for vertex set
+      boost::undirectedS // type of graph
+      > Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   typedef boost::graph_traits<Graph>::edge_iterator EdgeIter;
+   typedef boost::associative_property_map< std::map<Edge,double> > DistMap;
+   typedef boost::associative_property_map< std::map<Edge,bool> > IsEvaledMap;
+   
+   Graph g;
+   std::map<Vertex, std::string> state;
+   std::map<Edge, double> dist;
+   std::map<Edge, bool> isevaled;
+   
+   // read the test graph
+   std::ifstream fp;
+   fp.open(XSTR(DATADIR) "/halton2d.xml");
+   boost::dynamic_properties props;
+   props.property("state", boost::make_assoc_property_map(state));
+   boost::read_graphml(fp, g, props);
+   
+   // compute distances, and block every third edge
+   std::map<Edge, double> dist_lazy;
+   EdgeIter ei, ei_end;
+   unsigned int ei_count = 0;
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei, ++ei_count)
+   {
+      Vertex v1 = source(*ei, g);
+      Vertex v2 = target(*ei, g);
+      double v1x, v1y, v2x, v2y;
+      std::stringstream ss(state[v1] + " " + state[v2]);
+      ss >> v1x >> v1y >> v2x >> v2y;
+      dist_lazy[*ei] = sqrt(pow(v2x-v1x,2.) + pow(v2y-v1y,2.));
+      dist[*ei] = (ei_count % 3 == 0)
+         ? std::numeric_limits<double>::infinity() : dist_lazy[*ei];
+   }
+   
+   // reference solution
+   std::vector<double> v_truedist(num_vertices(g));
+   boost::dijkstra_shortest_paths(g, vertex(17,g),
+      boost::weight_map(boost::make_assoc_property_map(dist))
+      .distance_map(boost::make_iterator_property_map(v_truedist.begin(), get(boost::vertex_index,g))));
+   
+   // run lazysp selecting all unevaluated path edges at once,
+   // which are passed to the wmap as a single batch
+   std::vector<Edge> path;
+   std::vector<Vertex> v_startpreds(num_vertices(g));
+   std::vector<double> v_startdist(num_vertices(g));
+   std::vector<unsigned int> batch_sizes;
+   
+   bool success = pr_bgl::lazysp(
+      g, vertex(17,g), vertex(22,g),
+      batch_recording_wmap< pr_bgl::flag_set_map<DistMap,IsEvaledMap> >(
+         pr_bgl::make_flag_set_map(
+            boost::make_assoc_property_map(dist), 
+            boost::make_assoc_property_map(isevaled)),
+         batch_sizes),
+      boost::make_assoc_property_map(dist_lazy),
+      boost::make_assoc_property_map(isevaled),
+      path,
+      pr_bgl::make_lazysp_incsp_dijkstra<Graph>(
+         boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+         boost::make_iterator_property_map(v_startdist.begin(), get(boost::vertex_index,g)), // startdist_map
+         std::less<double>(), // compare
+         boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
+         std::numeric_limits<double>::infinity(), 0.0),
+      pr_bgl::lazysp_selector_all(),
+      pr_bgl::lazysp_visitor_null());
+   ASSERT_EQ(v_truedist[22] != std::numeric_limits<double>::infinity(), success);
+   
+   // validate path length
+   double pathlen = 0.0;
+   for (unsigned int ui=0; ui<path.size(); ui++)
+      pathlen += dist[path[ui]];
+   ASSERT_DOUBLE_EQ(v_truedist[22], pathlen);
+   
+   // the first path's edges were all evaluated together
+   ASSERT_LT(0u, batch_sizes.size());
+   ASSERT_LT(1u, batch_sizes[0]);
+}
+
+// with an oracle failure probability (1 on blocked edges), the
+// maxprob selector evaluates a blocked edge whenever the path has one
+TEST(LazySPTestCase, LazySPMaxProbTest)
+{
+   typedef boost::adjacency_list<
+      boost::vecS, // Edgelist ds, for per-vertex out-edges
+      boost::vecS, // VertexList ds, for vertex set
+      boost::undirectedS // type of graph
+      > Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   typedef boost::graph_traits<Graph>::edge_iterator EdgeIter;
+   typedef boost::associative_property_map< std::map<Edge,double> > ProbMap;
+   
+   Graph g;
+   std::map<Vertex, std::string> state;
+   std::map<Edge, double> dist;
+   std::map<Edge, double> prob;
+   std::map<Edge, bool> isevaled;
+   
+   // read the test graph
+   std::ifstream fp;
+   fp.open(XSTR(DATADIR) "/halton2d.xml");
+   boost::dynamic_properties props;
+   props.property("state", boost::make_assoc_property_map(state));
+   boost::read_graphml(fp, g, props);
+   
+   // compute distances, and block every third edge
+   std::map<Edge, double> dist_lazy;
+   EdgeIter ei, ei_end;
+   unsigned int ei_count = 0;
+   unsigned int num_blocked = 0;
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei, ++ei_count)
+   {
+      Vertex v1 = source(*ei, g);
+      Vertex v2 = target(*ei, g);
+      double v1x, v1y, v2x, v2y;
+      std::stringstream ss(state[v1] + " " + state[v2]);
+      ss >> v1x >> v1y >> v2x >> v2y;
+      dist_lazy[*ei] = sqrt(pow(v2x-v1x,2.) + pow(v2y-v1y,2.));
+      bool blocked = (ei_count % 3 == 0);
+      dist[*ei] = blocked ? std::numeric_limits<double>::infinity() : dist_lazy[*ei];
+      prob[*ei] = blocked ? 1.0 : 0.0;
+      if (blocked)
+         num_blocked++;
+   }
+   
+   // reference solution
+   std::vector<double> v_truedist(num_vertices(g));
+   boost::dijkstra_shortest_paths(g, vertex(17,g),
+      boost::weight_map(boost::make_assoc_property_map(dist))
+      .distance_map(boost::make_iterator_property_map(v_truedist.begin(), get(boost::vertex_index,g))));
+   
+   std::vector<Edge> path;
+   std::vector<Vertex> v_startpreds(num_vertices(g));
+   std::vector<double> v_startdist(num_vertices(g));
+   
+   bool success = pr_bgl::lazysp(
+      g, vertex(17,g), vertex(22,g),
+      pr_bgl::make_lazysp_wmap_identity_map(
+         pr_bgl::make_flag_set_map(
+            boost::make_assoc_property_map(dist), 
+            boost::make_assoc_property_map(isevaled))),
+      boost::make_assoc_property_map(dist_lazy),
+      boost::make_assoc_property_map(isevaled),
+      path,
+      pr_bgl::make_lazysp_incsp_dijkstra<Graph>(
+         boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+         boost::make_iterator_property_map(v_startdist.begin(), get(boost::vertex_index,g)), // startdist_map
+         std::less<double>(), // compare
+         boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
+         std::numeric_limits<double>::infinity(), 0.0),
+      pr_bgl::lazysp_selector_maxprob<ProbMap>(boost::make_assoc_property_map(prob)),
+      pr_bgl::lazysp_visitor_null());
+   ASSERT_EQ(v_truedist[22] != std::numeric_limits<double>::infinity(), success);
+   
+   // validate path length
+   double pathlen = 0.0;
+   for (unsigned int ui=0; ui<path.size(); ui++)
+      pathlen += dist[path[ui]];
+   ASSERT_DOUBLE_EQ(v_truedist[22], pathlen);
+   
+   // valid edges are only evaluated on the final path
+   unsigned int num_evaled_valid = 0;
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei)
+      if (isevaled[*ei] && prob[*ei] == 0.0)
+         num_evaled_valid++;
+   ASSERT_EQ(path.size(), num_evaled_valid);
+}
+
+// identity wmap which speculates: during each search, the first
+// num_complete speculated edges are evaluated (as though that many
+// background checks had completed)
+template <class PropMap>
+class speculating_wmap: public pr_bgl::lazysp_wmap_identity_map<PropMap>
+{
+public:
+   unsigned int num_complete;
+   speculating_wmap(PropMap prop_map, unsigned int num_complete):
+      pr_bgl::lazysp_wmap_identity_map<PropMap>(prop_map), num_complete(num_complete)
+   {
+   }
+};
+
+template <class PropMap>
+bool lazysp_wmap_speculates(const speculating_wmap<PropMap> & wmap)
+{
+   return 0 < wmap.num_complete;
+}
+
+template <class PropMap, class Edge, class SearchFn>
+double lazysp_wmap_speculate(const speculating_wmap<PropMap> & wmap,
+   const std::vector<Edge> & speculate, SearchFn search,
+   std::vector<Edge> & es, std::vector<double> & weights,
+   std::vector<Edge> & changed, std::vector<std::size_t> & changed_ends)
+{
+   double pathlen = search();
+   for (unsigned int ui=0; ui<speculate.size() && ui<wmap.num_complete; ui++)
+   {
+      es.push_back(speculate[ui]);
+      weights.push_back(lazysp_wmap_eval(wmap, speculate[ui], changed));
+      changed_ends.push_back(changed.size());
+   }
+   return pathlen;
+}
+
+// records the edges in the order their evaluations are applied
+template <class Edge>
+class eval_recording_visitor: public pr_bgl::lazysp_visitor_null
+{
+public:
+   std::vector<Edge> & evals;
+   eval_recording_visitor(std::vector<Edge> & evals): evals(evals) {}
+   inline void edge_evaluate(Edge & e, double e_weight)
+   {
+      evals.push_back(e);
+   }
+};
+
+typedef boost::adjacency_list<
+   boost::vecS, // Edgelist ds, for per-vertex out-edges
+   boost::vecS, // VertexList ds, for vertex set
+   boost::undirectedS // type of graph
+   > SpeculateGraph;
+typedef boost::graph_traits<SpeculateGraph>::edge_descriptor SpeculateEdge;
+
+// runs lazysp with the alt selector from vertex 17 to vertex 22,
+// speculating num_complete edges per search (none if zero)
+void lazysp_alt_speculating(const SpeculateGraph & g,
+   std::map<SpeculateEdge,double> dist, std::map<SpeculateEdge,double> dist_lazy,
+   unsigned int num_complete,
+   std::vector<SpeculateEdge> & path, std::vector<SpeculateEdge> & evals)
+{
+   typedef boost::associative_property_map< std::map<SpeculateEdge,double> > DistMap;
+   typedef boost::associative_property_map< std::map<SpeculateEdge,bool> > IsEvaledMap;
+   std::map<SpeculateEdge, bool> isevaled;
+   std::vector<SpeculateGraph::vertex_descriptor> v_startpreds(num_vertices(g));
+   std::vector<double> v_startdist(num_vertices(g));
+   pr_bgl::lazysp(
+      g, vertex(17,g), vertex(22,g),
+      speculating_wmap< pr_bgl::flag_set_map<DistMap,IsEvaledMap> >(
+         pr_bgl::make_flag_set_map(
+            boost::make_assoc_property_map(dist), 
+            boost::make_assoc_property_map(isevaled)),
+         num_complete),
+      boost::make_assoc_property_map(dist_lazy),
+      boost::make_assoc_property_map(isevaled),
+      path,
+      pr_bgl::make_lazysp_incsp_dijkstra<SpeculateGraph>(
+         boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+         boost::make_iterator_property_map(v_startdist.begin(), get(boost::vertex_index,g)), // startdist_map
+         std::less<double>(), // compare
+         boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
+         std::numeric_limits<double>::infinity(), 0.0),
+      pr_bgl::lazysp_selector_alt(),
+      eval_recording_visitor<SpeculateEdge>(evals));
+}
+
+// speculation does not change which edges the (stateful) alt selector
+// chooses: with valid lazy weights, the evaluations are applied in the
+// same order however many speculative evaluations complete, and with
+// blocked edges, the same path is found
+TEST(LazySPTestCase, LazySPSpeculativeAltTest)
+{
+   typedef boost::graph_traits<SpeculateGraph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<SpeculateGraph>::edge_iterator EdgeIter;
+   
+   SpeculateGraph g;
+   std::map<Vertex, std::string> state;
+   
+   // read the test graph
+   std::ifstream fp;
+   fp.open(XSTR(DATADIR) "/halton2d.xml");
+   boost::dynamic_properties props;
+   props.property("state", boost::make_assoc_property_map(state));
+   boost::read_graphml(fp, g, props);
+   
+   // compute distances, with every third edge blocked in dist_blocked
+   std::map<SpeculateEdge, double> dist;
+   std::map<SpeculateEdge, double> dist_blocked;
+   EdgeIter ei, ei_end;
+   unsigned int ei_count = 0;
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ++ei, ++ei_count)
+   {
+      Vertex v1 = source(*ei, g);
+      Vertex v2 = target(*ei, g);
+      double v1x, v1y, v2x, v2y;
+      std::stringstream ss(state[v1] + " " + state[v2]);
+      ss >> v1x >> v1y >> v2x >> v2y;
+      dist[*ei] = sqrt(pow(v2x-v1x,2.) + pow(v2y-v1y,2.));
+      dist_blocked[*ei] = (ei_count % 3 == 0)
+         ? std::numeric_limits<double>::infinity() : dist[*ei];
+   }
+   
+   std::vector<SpeculateEdge> path_serial;
+   std::vector<SpeculateEdge> evals_serial;
+   lazysp_alt_speculating(g, dist, dist, 0, path_serial, evals_serial);
+   ASSERT_EQ(5, path_serial.size());
+   ASSERT_EQ(path_serial.size(), evals_serial.size());
+   
+   std::vector<SpeculateEdge> path_blocked_serial;
+   std::vector<SpeculateEdge> evals_blocked_serial;
+   lazysp_alt_speculating(g, dist_blocked, dist, 0,
+      path_blocked_serial, evals_blocked_serial);
+   ASSERT_LT(0u, path_blocked_serial.size());
+   
+   const unsigned int num_completes[] = {1, 2, 3, 100};
+   for (unsigned int ui=0; ui<4; ui++)
+   {
+      std::vector<SpeculateEdge> path;
+      std::vector<SpeculateEdge> evals;
+      lazysp_alt_speculating(g, dist, dist, num_completes[ui], path, evals);
+      ASSERT_TRUE(path_serial == path);
+      ASSERT_TRUE(evals_serial == evals);
+      
+      std::vector<SpeculateEdge> path_blocked;
+      std::vector<SpeculateEdge> evals_blocked;
+      lazysp_alt_speculating(g, dist_blocked, dist, num_completes[ui],
+         path_blocked, evals_blocked);
+      ASSERT_TRUE(path_blocked_serial == path_blocked);
+   }
+}
+
+// records the number of allocations made during each lazysp iteration
+class alloc_count_visitor: public pr_bgl::lazysp_visitor_null
+{
+public:
+   std::vector<unsigned long> & iter_allocs;
+   unsigned long allocs_begin;
+   alloc_count_visitor(std::vector<unsigned long> & iter_allocs):
+      iter_allocs(iter_allocs), allocs_begin(0)
+   {
+   }
+   inline void search_begin()
+   {
+      unsigned long allocs_now = num_allocs;
+      if (allocs_begin)
+         iter_allocs.push_back(allocs_now - allocs_begin);
+      allocs_begin = num_allocs;
+   }
+};
+
+TEST(LazySPTestCase, LazySPAllocationTest)
+{
+   struct EProps
+   {
+      double w;
+      double w_lazy;
+      bool is_evaled;
+   };
+   typedef boost::adjacency_list<
+      boost::vecS, // Edgelist ds, for per-vertex out-edges
+      boost::vecS, // VertexList ds, for vertex set
+      boost::undirectedS, // type of graph
+      boost::no_property, EProps
+      > Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   
+   // a 30x30 grid with a lazy weight of 1 per edge,
+   // whose true weights block about a quarter of the edges
+   const unsigned int n = 30;
+   Graph g(n*n);
+   unsigned int seed = 1;
+   for (unsigned int i=0; i<n; i++)
+   for (unsigned int j=0; j<n; j++)
+   {
+      for (unsigned int dir=0; dir<2; dir++)
+      {
+         if (dir == 0 && !(j+1 < n)) continue;
+         if (dir == 1 && !(i+1 < n)) continue;
+         Vertex vb = (dir == 0) ? i*n+j+1 : (i+1)*n+j;
+         Edge e = add_edge(i*n+j, vb, g).first;
+         seed = seed * 1103515245 + 12345;
+         g[e].w_lazy = 1.0;
+         g[e].w = ((seed >> 16) % 4 == 0) ? std::numeric_limits<double>::infinity() : 1.0;
+         g[e].is_evaled = false;
+      }
+   }
+   Vertex v_start = vertex(0,g);
+   Vertex v_goal = vertex(n*n-1,g);
+   
+   // reference solution
+   std::vector<double> v_truedist(num_vertices(g));
+   boost::dijkstra_shortest_paths(g, v_start,
+      boost::weight_map(get(&EProps::w,g))
+      .distance_map(boost::make_iterator_property_map(v_truedist.begin(), get(boost::vertex_index,g)))
+      .distance_inf(std::numeric_limits<double>::infinity()));
+   
+   // run lazysp with lpa* as the inner search
+   std::vector<Edge> path;
+   std::vector<double> v_hvalues(num_vertices(g), 0.0);
+   std::vector<Vertex> v_startpreds(num_vertices(g));
+   std::vector<double> v_startdist(num_vertices(g));
+   std::vector<double> v_startdistlookahead(num_vertices(g));
+   std::vector<unsigned long> iter_allocs;
+   pr_bgl::lazysp_buffers<Vertex,Edge> buffers;
+   buffers.reserve(num_vertices(g));
+   
+   bool success = pr_bgl::lazysp(
+      g, v_start, v_goal,
+      pr_bgl::make_lazysp_wmap_identity_map(
+         pr_bgl::make_flag_set_map(get(&EProps::w,g), get(&EProps::is_evaled,g))),
+      get(&EProps::w_lazy,g),
+      get(&EProps::is_evaled,g),
+      path,
+      pr_bgl::make_lazysp_incsp_lpastar(g, v_start, v_goal,
+         get(&EProps::w_lazy,g),
+         boost::make_iterator_property_map(v_hvalues.begin(), get(boost::vertex_index,g)), // heuristic_map
+         boost::make_iterator_property_map(v_startpreds.begin(), get(boost::vertex_index,g)), // startpreds_map
+         boost::make_iterator_property_map(v_startdist.begin(), get(boost::vertex_index,g)), // gvalues_map
+         boost::make_iterator_property_map(v_startdistlookahead.begin(), get(boost::vertex_index,g)), // rhsvalues_map
+         0.0, // goal_margin
+         std::less<double>(), // compare
+         boost::closed_plus<double>(std::numeric_limits<double>::infinity()), // combine
+         std::numeric_limits<double>::infinity(), 0.0),
+      pr_bgl::lazysp_selector_bisect(),
+      alloc_count_visitor(iter_allocs),
+      buffers);
+   ASSERT_EQ(v_truedist[v_goal] != std::numeric_limits<double>::infinity(), success);
+   
+   // validate path length
+   double pathlen = 0.0;
+   for (unsigned int ui=0; ui<path.size(); ui++)
+      pathlen += g[path[ui]].w;
+   ASSERT_DOUBLE_EQ(v_truedist[v_goal], pathlen);
+   
+   // after the first iteration (which sizes the inner search's queue),
+   // iterations should not allocate
+   ASSERT_LT(10u, iter_allocs.size());
+   printf("iterations: %lu, first iteration allocations: %lu\n",
+      iter_allocs.size(), iter_allocs[0]);
+   for (unsigned int ui=1; ui<iter_allocs.size(); ui++)
+      ASSERT_EQ(0u, iter_allocs[ui]);
+}
+
 int main(int argc, char **argv)
 {
    testing::InitGoogleTest(&argc, argv);
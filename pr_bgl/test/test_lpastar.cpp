@@ -9,10 +9,12 @@
 #include <string>
 #include <sstream>
 
+#include <boost/function.hpp>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graphml.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 
+#include <pr_bgl/cancel_poll.h>
 #include <pr_bgl/heap_indexed.h>
 #include <pr_bgl/lpastar.h>
 
@@ -104,6 +106,26 @@ struct grid_heuristic
    }
 };
 
+template <class Graph, class CoordMap>
+struct moving_grid_heuristic
+{
+   typedef typename boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   const CoordMap coord_map;
+   const std::pair<unsigned int,unsigned int> * target;
+   moving_grid_heuristic(CoordMap coord_map,
+         const std::pair<unsigned int,unsigned int> * target):
+      coord_map(coord_map), target(target)
+   {
+   }
+   unsigned int operator()(Vertex v)
+   {
+      int iv = get(coord_map, v).first;
+      int jv = get(coord_map, v).second;
+      return std::max(std::abs(iv - (int)target->first),
+         std::abs(jv - (int)target->second));
+   }
+};
+
 template <class Graph>
 class counting_visitor
 {
@@ -304,6 +326,587 @@ TEST(LifelongPlanningAstarTestCase, LifelongPlanningAstarTest)
    ASSERT_EQ(14, v_gvalues[v_goal]);
 }
 
+/* D* Lite: search backwards from the grid goal towards a robot
+ * which moves along the current path, with the map changing
+ * after it has moved; the result must match a fresh search */
+TEST(LifelongPlanningAstarTestCase, DStarLiteTest)
+{
+   grid_reader grid(
+      XSTR(DATADIR) "/lpastar_fig1.txt");
+   
+   typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS> Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   typedef boost::graph_traits<Graph>::edge_iterator EdgeIter;
+   typedef boost::associative_property_map<
+      std::map<Vertex, std::pair<unsigned int,unsigned int> > > MapVII;
+   typedef boost::associative_property_map<std::map<Vertex,Vertex> > MapVV;
+   typedef boost::associative_property_map<std::map<Vertex,unsigned int> > MapVI;
+   typedef boost::associative_property_map<std::map<Edge,unsigned int> > MapEI;
+   typedef pr_bgl::lpastar<Graph,
+      moving_grid_heuristic<Graph,MapVII>,
+      counting_visitor<Graph>,
+      MapVV, MapVI, MapVI, MapEI,
+      boost::property_map<Graph, boost::vertex_index_t>::type,
+      std::less<unsigned int>, boost::closed_plus<unsigned int>,
+      unsigned int, unsigned int
+   > LPAStar;
+   
+   Graph g;
+   std::map<std::pair<unsigned int,unsigned int>, Vertex> coord_to_v;
+   std::map<Vertex, std::pair<unsigned int,unsigned int> > v_coords;
+   std::map<Edge, unsigned int> e_dists;
+   
+   for (unsigned int irow=0; irow<grid.nrows; irow++)
+   for (unsigned int icol=0; icol<grid.ncols; icol++)
+   {
+      Vertex v = add_vertex(g);
+      coord_to_v[std::make_pair(irow,icol)] = v;
+      v_coords[v] = std::make_pair(irow,icol);
+   }
+   for (unsigned int irow=0; irow<grid.nrows; irow++)
+   for (unsigned int icol=0; icol<grid.ncols; icol++)
+   {
+      Vertex v1 = coord_to_v[std::make_pair(irow,icol)];
+      bool v1_free = grid.rows_original[irow][icol];
+      std::vector< std::pair<unsigned int,unsigned int> > neighbors;
+      if (icol+1 < grid.ncols)
+         neighbors.push_back(std::make_pair(irow,icol+1));
+      if (irow+1 < grid.nrows)
+         neighbors.push_back(std::make_pair(irow+1,icol));
+      if (icol+1 < grid.ncols && irow+1 < grid.nrows)
+         neighbors.push_back(std::make_pair(irow+1,icol+1));
+      if (0 < icol && irow+1 < grid.nrows)
+         neighbors.push_back(std::make_pair(irow+1,icol-1));
+      for (unsigned int ui=0; ui<neighbors.size(); ui++)
+      {
+         Vertex v2 = coord_to_v[neighbors[ui]];
+         bool v2_free = grid.rows_original[neighbors[ui].first][neighbors[ui].second];
+         Edge e = add_edge(v1, v2, g).first;
+         e_dists[e] = (v1_free && v2_free) ? 1 : UINT_MAX;
+      }
+   }
+   
+   // the search is rooted at the goal; the robot is its target
+   Vertex v_root = coord_to_v[std::make_pair(grid.igoal,grid.jgoal)];
+   Vertex v_robot = coord_to_v[std::make_pair(grid.istart,grid.jstart)];
+   std::pair<unsigned int,unsigned int> robot_coords = v_coords[v_robot];
+   
+   std::map<Vertex,Vertex> v_preds;
+   std::map<Vertex,unsigned int> v_gvalues;
+   std::map<Vertex,unsigned int> v_rhsvalues;
+   std::set<Vertex> vs_expanded;
+   int num_expansions = 0;
+   LPAStar dstarlite(g, v_root, v_robot,
+      moving_grid_heuristic<Graph,MapVII>(MapVII(v_coords), &robot_coords),
+      counting_visitor<Graph>(vs_expanded,num_expansions),
+      MapVV(v_preds), MapVI(v_gvalues), MapVI(v_rhsvalues), MapEI(e_dists),
+      get(boost::vertex_index, g),
+      std::less<unsigned int>(),
+      boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()),
+      std::numeric_limits<unsigned int>::max(), 0,
+      0);
+   dstarlite.compute_shortest_path();
+   ASSERT_EQ(13, v_gvalues[v_robot]);
+   
+   // robot takes three steps along the path towards the root
+   for (unsigned int step=0; step<3; step++)
+   {
+      Vertex v_next = v_preds[v_robot];
+      ASSERT_NE(v_robot, v_next);
+      v_robot = v_next;
+   }
+   robot_coords = v_coords[v_robot];
+   ASSERT_EQ(10, v_gvalues[v_robot]);
+   
+   // the map changes
+   unsigned int num_changed = 0;
+   EdgeIter ei, ei_end;
+   for (boost::tie(ei,ei_end)=edges(g); ei!=ei_end; ei++)
+   {
+      Vertex u = source(*ei,g);
+      Vertex v = target(*ei,g);
+      bool u_free = grid.rows_changed[v_coords[u].first][v_coords[u].second];
+      bool v_free = grid.rows_changed[v_coords[v].first][v_coords[v].second];
+      unsigned int new_dist = (u_free && v_free) ? 1 : UINT_MAX;
+      if (new_dist == e_dists[*ei])
+         continue;
+      e_dists[*ei] = new_dist;
+      num_changed++;
+   }
+   ASSERT_EQ(29, num_changed);
+   
+   // resume towards the robot's new position from the same maps
+   // (the heuristic now reads the moved robot_coords)
+   num_expansions = 0;
+   LPAStar dstarlite_resumed(g, v_root, v_robot,
+      moving_grid_heuristic<Graph,MapVII>(MapVII(v_coords), &robot_coords),
+      counting_visitor<Graph>(vs_expanded,num_expansions),
+      MapVV(v_preds), MapVI(v_gvalues), MapVI(v_rhsvalues), MapEI(e_dists),
+      get(boost::vertex_index, g),
+      std::less<unsigned int>(),
+      boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()),
+      std::numeric_limits<unsigned int>::max(), 0,
+      0, true);
+   dstarlite_resumed.compute_shortest_path();
+   int num_expansions_dstarlite = num_expansions;
+   
+   // compare against a fresh search from scratch
+   std::map<Vertex,Vertex> v_preds_fresh;
+   std::map<Vertex,unsigned int> v_gvalues_fresh;
+   std::map<Vertex,unsigned int> v_rhsvalues_fresh;
+   num_expansions = 0;
+   LPAStar fresh(g, v_root, v_robot,
+      moving_grid_heuristic<Graph,MapVII>(MapVII(v_coords), &robot_coords),
+      counting_visitor<Graph>(vs_expanded,num_expansions),
+      MapVV(v_preds_fresh), MapVI(v_gvalues_fresh), MapVI(v_rhsvalues_fresh), MapEI(e_dists),
+      get(boost::vertex_index, g),
+      std::less<unsigned int>(),
+      boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()),
+      std::numeric_limits<unsigned int>::max(), 0,
+      0);
+   fresh.compute_shortest_path();
+   printf("num_expansions: d* lite %d, fresh %d\n",
+      num_expansions_dstarlite, num_expansions);
+   ASSERT_EQ(v_gvalues_fresh[v_robot], v_gvalues[v_robot]);
+   
+   // the d* lite path must be feasible with the claimed length
+   unsigned int len = 0;
+   for (Vertex v_walk=v_robot; v_walk!=v_root;)
+   {
+      Vertex v_next = v_preds[v_walk];
+      ASSERT_NE(v_walk, v_next);
+      len += e_dists[edge(v_walk,v_next,g).first];
+      v_walk = v_next;
+   }
+   ASSERT_EQ(v_gvalues[v_robot], len);
+}
+
+/* weighted (bounded-suboptimal) lpa* on a grid with varied weights;
+ * after each round of weight changes, the path found must be within
+ * the heuristic weight of the true shortest path */
+TEST(LifelongPlanningAstarTestCase, WeightedLifelongPlanningAstarTest)
+{
+   typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS> Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   typedef boost::associative_property_map<
+      std::map<Vertex, std::pair<unsigned int,unsigned int> > > MapVII;
+   typedef boost::associative_property_map<std::map<Vertex,Vertex> > MapVV;
+   typedef boost::associative_property_map<std::map<Vertex,unsigned int> > MapVI;
+   typedef boost::associative_property_map<std::map<Edge,unsigned int> > MapEI;
+   
+   const unsigned int n = 30;
+   const double heuristic_weight = 2.0;
+   
+   Graph g;
+   std::map<std::pair<unsigned int,unsigned int>, Vertex> coord_to_v;
+   std::map<Vertex, std::pair<unsigned int,unsigned int> > v_coords;
+   std::map<Edge, unsigned int> e_dists;
+   std::vector<Edge> es;
+   
+   // deterministic pseudo-random weights in 1..5
+   unsigned int seed = 1;
+   
+   for (unsigned int irow=0; irow<n; irow++)
+   for (unsigned int icol=0; icol<n; icol++)
+   {
+      Vertex v = add_vertex(g);
+      coord_to_v[std::make_pair(irow,icol)] = v;
+      v_coords[v] = std::make_pair(irow,icol);
+   }
+   for (unsigned int irow=0; irow<n; irow++)
+   for (unsigned int icol=0; icol<n; icol++)
+   {
+      Vertex v1 = coord_to_v[std::make_pair(irow,icol)];
+      std::vector< std::pair<unsigned int,unsigned int> > neighbors;
+      if (icol+1 < n)
+         neighbors.push_back(std::make_pair(irow,icol+1));
+      if (irow+1 < n)
+         neighbors.push_back(std::make_pair(irow+1,icol));
+      if (icol+1 < n && irow+1 < n)
+         neighbors.push_back(std::make_pair(irow+1,icol+1));
+      if (0 < icol && irow+1 < n)
+         neighbors.push_back(std::make_pair(irow+1,icol-1));
+      for (unsigned int ui=0; ui<neighbors.size(); ui++)
+      {
+         Edge e = add_edge(v1, coord_to_v[neighbors[ui]], g).first;
+         seed = seed * 1103515245 + 12345;
+         e_dists[e] = 1 + (seed >> 16) % 5;
+         es.push_back(e);
+      }
+   }
+   
+   Vertex v_start = coord_to_v[std::make_pair(2,3)];
+   Vertex v_goal = coord_to_v[std::make_pair(n-3,n-2)];
+   
+   std::map<Vertex,Vertex> v_preds;
+   std::map<Vertex,unsigned int> v_gvalues;
+   std::map<Vertex,unsigned int> v_rhsvalues;
+   std::set<Vertex> vs_expanded;
+   int num_expansions = 0;
+   pr_bgl::lpastar<Graph,
+      grid_heuristic<Graph,MapVII>,
+      counting_visitor<Graph>,
+      MapVV, MapVI, MapVI, MapEI,
+      boost::property_map<Graph, boost::vertex_index_t>::type,
+      std::less<unsigned int>, boost::closed_plus<unsigned int>,
+      unsigned int, unsigned int
+   > lpastar(g, v_start, v_goal,
+      grid_heuristic<Graph,MapVII>(g, v_goal, MapVII(v_coords)),
+      counting_visitor<Graph>(vs_expanded,num_expansions),
+      MapVV(v_preds), MapVI(v_gvalues), MapVI(v_rhsvalues), MapEI(e_dists),
+      get(boost::vertex_index, g),
+      std::less<unsigned int>(),
+      boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()),
+      std::numeric_limits<unsigned int>::max(), 0,
+      0, // goal_margin
+      false, // do_resume
+      heuristic_weight);
+   
+   for (unsigned int round=0; round<6; round++)
+   {
+      // change some weights (blocking some edges entirely)
+      if (round)
+      {
+         for (unsigned int ui=0; ui<60; ui++)
+         {
+            seed = seed * 1103515245 + 12345;
+            Edge e = es[(seed >> 16) % es.size()];
+            seed = seed * 1103515245 + 12345;
+            unsigned int r = (seed >> 16) % 7;
+            unsigned int new_dist = (r == 6) ? UINT_MAX : 1 + r % 5;
+            if (new_dist == e_dists[e])
+               continue;
+            e_dists[e] = new_dist;
+            Vertex u = source(e,g);
+            Vertex v = target(e,g);
+            lpastar.update_predecessor(u, v, new_dist);
+            lpastar.update_vertex(v);
+            lpastar.update_predecessor(v, u, new_dist);
+            lpastar.update_vertex(u);
+         }
+      }
+      
+      num_expansions = 0;
+      lpastar.compute_shortest_path();
+      
+      // true shortest path length
+      std::map<Vertex,unsigned int> v_dists;
+      boost::dijkstra_shortest_paths(g, v_start,
+         boost::weight_map(MapEI(e_dists))
+         .distance_map(MapVI(v_dists))
+         .distance_combine(boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()))
+         .distance_inf(std::numeric_limits<unsigned int>::max()));
+      unsigned int len_opt = v_dists[v_goal];
+      ASSERT_NE(std::numeric_limits<unsigned int>::max(), len_opt);
+      
+      // the path must be feasible and within the bound
+      unsigned int len = 0;
+      for (Vertex v_walk=v_goal; v_walk!=v_start;)
+      {
+         Vertex v_pred = v_preds[v_walk];
+         ASSERT_NE(v_walk, v_pred);
+         len += e_dists[edge(v_pred,v_walk,g).first];
+         ASSERT_GT(std::numeric_limits<unsigned int>::max(), len);
+         v_walk = v_pred;
+      }
+      double bound = lpastar.suboptimality_bound();
+      ASSERT_LE(1.0, bound);
+      ASSERT_GE(heuristic_weight, bound);
+      ASSERT_LE(len_opt, len);
+      ASSERT_LE(len, bound * len_opt);
+      ASSERT_LE(len_opt, v_gvalues[v_goal]);
+      ASSERT_LE(v_gvalues[v_goal], bound * len_opt);
+   }
+}
+
+// cancels on the num_calls_cancel'th call
+struct cancel_after
+{
+   int & num_calls;
+   int num_calls_cancel;
+   cancel_after(int & num_calls, int num_calls_cancel):
+      num_calls(num_calls), num_calls_cancel(num_calls_cancel)
+   {
+   }
+   bool operator()()
+   {
+      return num_calls_cancel <= ++num_calls;
+   }
+};
+
+/* LPA*: a search cancelled part way (polling every other pop) can be
+ * resumed, with the same result and total expansions as one which
+ * runs to completion */
+TEST(LifelongPlanningAstarTestCase, CancelledLifelongPlanningAstarTest)
+{
+   grid_reader grid(
+      XSTR(DATADIR) "/lpastar_fig1.txt");
+   
+   typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS> Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   
+   Graph g;
+   std::map<std::pair<unsigned int,unsigned int>, Vertex> coord_to_v;
+   std::map<Vertex, std::pair<unsigned int,unsigned int> > v_coords;
+   std::map<Edge, unsigned int> e_dists;
+   std::map<Vertex,Vertex> v_preds;
+   std::map<Vertex,unsigned int> v_gvalues;
+   std::map<Vertex,unsigned int> v_rhsvalues;
+   typedef boost::associative_property_map<
+      std::map<Vertex, std::pair<unsigned int,unsigned int> > > MapVII;
+   typedef boost::associative_property_map<std::map<Vertex,Vertex> > MapVV;
+   typedef boost::associative_property_map<std::map<Vertex,unsigned int> > MapVI;
+   typedef boost::associative_property_map<std::map<Edge,unsigned int> > MapEI;
+   
+   // same graph as LifelongPlanningAstarTest
+   for (unsigned int irow=0; irow<grid.nrows; irow++)
+   for (unsigned int icol=0; icol<grid.ncols; icol++)
+   {
+      Vertex v = add_vertex(g);
+      coord_to_v[std::make_pair(irow,icol)] = v;
+      v_coords[v] = std::make_pair(irow,icol);
+   }
+   Vertex v_start = coord_to_v[std::make_pair( grid.istart,grid.jstart)];
+   Vertex v_goal = coord_to_v[std::make_pair(grid.igoal,grid.jgoal)];
+   for (unsigned int irow=0; irow<grid.nrows; irow++)
+   for (unsigned int icol=0; icol<grid.ncols; icol++)
+   {
+      Vertex v1 = coord_to_v[std::make_pair(irow,icol)];
+      bool v1_free = grid.rows_original[irow][icol];
+      std::vector< std::pair<unsigned int,unsigned int> > neighbors;
+      if (icol+1 < grid.ncols)
+         neighbors.push_back(std::make_pair(irow,icol+1));
+      if (irow+1 < grid.nrows)
+         neighbors.push_back(std::make_pair(irow+1,icol));
+      if (icol+1 < grid.ncols && irow+1 < grid.nrows)
+         neighbors.push_back(std::make_pair(irow+1,icol+1));
+      if (0 < icol && irow+1 < grid.nrows)
+         neighbors.push_back(std::make_pair(irow+1,icol-1));
+      for (unsigned int ui=0; ui<neighbors.size(); ui++)
+      {
+         Vertex v2 = coord_to_v[neighbors[ui]];
+         bool v2_free = grid.rows_original[neighbors[ui].first][neighbors[ui].second];
+         Edge e = add_edge(v1, v2, g).first;
+         e_dists[e] = (v1_free && v2_free) ? 1 : UINT_MAX;
+      }
+   }
+   
+   std::set<Vertex> vs_expanded;
+   int num_expansions = 0;
+   pr_bgl::lpastar<Graph,
+      grid_heuristic<Graph,MapVII>,
+      counting_visitor<Graph>,
+      MapVV, MapVI, MapVI, MapEI,
+      boost::property_map<Graph, boost::vertex_index_t>::type,
+      std::less<unsigned int>, boost::closed_plus<unsigned int>,
+      unsigned int, unsigned int
+   > lpastar(g, v_start, v_goal,
+      grid_heuristic<Graph,MapVII>(g, v_goal, MapVII(v_coords)),
+      counting_visitor<Graph>(vs_expanded,num_expansions),
+      MapVV(v_preds), MapVI(v_gvalues), MapVI(v_rhsvalues), MapEI(e_dists),
+      get(boost::vertex_index, g), // index_map
+      std::less<unsigned int>(), // compare
+      boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()), // combine
+      std::numeric_limits<unsigned int>::max(), 0, // cost inf, zero
+      0 // goal_margin
+   );
+   
+   // cancel on the 10th predicate call (the 20th poll)
+   int num_calls = 0;
+   pr_bgl::cancel_poll cancel(cancel_after(num_calls, 10), 2);
+   ASSERT_FALSE(lpastar.compute_shortest_path(&cancel));
+   ASSERT_TRUE(cancel.cancelled());
+   ASSERT_EQ(10, num_calls);
+   ASSERT_EQ(19, num_expansions);
+   
+   // once cancelled, it stays cancelled without calling the predicate
+   ASSERT_FALSE(lpastar.compute_shortest_path(&cancel));
+   ASSERT_EQ(10, num_calls);
+   ASSERT_EQ(19, num_expansions);
+   
+   // resume to completion
+   ASSERT_TRUE(lpastar.compute_shortest_path());
+   ASSERT_EQ(37, num_expansions);
+   ASSERT_EQ(37, vs_expanded.size());
+   ASSERT_EQ(13, v_gvalues[v_goal]);
+}
+
+/* LPA*: a search resumed (via do_resume) from the distances of a
+ * previous search, after edge weights change and vertices are added,
+ * finds the same goal distance as a fresh search, with fewer expansions
+ * (vertices not seen by the previous search start unreached) */
+TEST(LifelongPlanningAstarTestCase, ResumedLifelongPlanningAstarTest)
+{
+   typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS> Graph;
+   typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+   typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+   typedef boost::associative_property_map<
+      std::map<Vertex, std::pair<unsigned int,unsigned int> > > MapVII;
+   typedef boost::associative_property_map<std::map<Vertex,Vertex> > MapVV;
+   typedef boost::associative_property_map<std::map<Vertex,unsigned int> > MapVI;
+   typedef boost::associative_property_map<std::map<Edge,unsigned int> > MapEI;
+   typedef pr_bgl::lpastar<Graph,
+      grid_heuristic<Graph,MapVII>,
+      counting_visitor<Graph>,
+      MapVV, MapVI, MapVI, MapEI,
+      boost::property_map<Graph, boost::vertex_index_t>::type,
+      std::less<unsigned int>, boost::closed_plus<unsigned int>,
+      unsigned int, unsigned int
+   > LPAStar;
+   
+   const unsigned int n = 30;
+   
+   Graph g;
+   std::map<std::pair<unsigned int,unsigned int>, Vertex> coord_to_v;
+   std::map<Vertex, std::pair<unsigned int,unsigned int> > v_coords;
+   std::map<Edge, unsigned int> e_dists;
+   std::vector<Edge> es;
+   
+   // deterministic pseudo-random weights in 1..5
+   unsigned int seed = 7;
+   
+   for (unsigned int irow=0; irow<n; irow++)
+   for (unsigned int icol=0; icol<n; icol++)
+   {
+      Vertex v = add_vertex(g);
+      coord_to_v[std::make_pair(irow,icol)] = v;
+      v_coords[v] = std::make_pair(irow,icol);
+   }
+   for (unsigned int irow=0; irow<n; irow++)
+   for (unsigned int icol=0; icol<n; icol++)
+   {
+      Vertex v1 = coord_to_v[std::make_pair(irow,icol)];
+      std::vector< std::pair<unsigned int,unsigned int> > neighbors;
+      if (icol+1 < n)
+         neighbors.push_back(std::make_pair(irow,icol+1));
+      if (irow+1 < n)
+         neighbors.push_back(std::make_pair(irow+1,icol));
+      for (unsigned int ui=0; ui<neighbors.size(); ui++)
+      {
+         Edge e = add_edge(v1, coord_to_v[neighbors[ui]], g).first;
+         seed = seed * 1103515245 + 12345;
+         e_dists[e] = 1 + (seed >> 16) % 5;
+         es.push_back(e);
+      }
+   }
+   
+   Vertex v_start = coord_to_v[std::make_pair(1,2)];
+   Vertex v_goal = coord_to_v[std::make_pair(n-2,n-1)];
+   
+   // initial search
+   std::map<Vertex,Vertex> v_preds;
+   std::map<Vertex,unsigned int> v_gvalues;
+   std::map<Vertex,unsigned int> v_rhsvalues;
+   std::set<Vertex> vs_expanded;
+   int num_expansions = 0;
+   {
+      LPAStar lpastar(g, v_start, v_goal,
+         grid_heuristic<Graph,MapVII>(g, v_goal, MapVII(v_coords)),
+         counting_visitor<Graph>(vs_expanded,num_expansions),
+         MapVV(v_preds), MapVI(v_gvalues), MapVI(v_rhsvalues), MapEI(e_dists),
+         get(boost::vertex_index, g),
+         std::less<unsigned int>(),
+         boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()),
+         std::numeric_limits<unsigned int>::max(), 0,
+         0); // goal_margin
+      ASSERT_TRUE(lpastar.compute_shortest_path());
+   }
+   
+   // change some weights (blocking some edges entirely)
+   for (unsigned int ui=0; ui<10; ui++)
+   {
+      seed = seed * 1103515245 + 12345;
+      Edge e = es[(seed >> 16) % es.size()];
+      seed = seed * 1103515245 + 12345;
+      unsigned int r = (seed >> 16) % 6;
+      e_dists[e] = (r == 5) ? UINT_MAX : 1 + r;
+   }
+   
+   // add shortcut vertices, each at the position of a grid vertex a,
+   // and joined to it and to a nearby grid vertex b
+   // (the edge weights keep the heuristic consistent)
+   for (unsigned int ui=0; ui<10; ui++)
+   {
+      seed = seed * 1103515245 + 12345;
+      unsigned int ia = (seed >> 16) % (n-4);
+      seed = seed * 1103515245 + 12345;
+      unsigned int ja = (seed >> 16) % (n-4);
+      seed = seed * 1103515245 + 12345;
+      unsigned int ib = ia + (seed >> 16) % 5;
+      seed = seed * 1103515245 + 12345;
+      unsigned int jb = ja + (seed >> 16) % 5;
+      Vertex v = add_vertex(g);
+      v_coords[v] = std::make_pair(ia,ja);
+      Edge e = add_edge(coord_to_v[std::make_pair(ia,ja)], v, g).first;
+      e_dists[e] = 1;
+      e = add_edge(v, coord_to_v[std::make_pair(ib,jb)], g).first;
+      e_dists[e] = std::max(1u, std::max(ib-ia, jb-ja));
+      
+      // seen for the first time
+      v_preds[v] = v;
+      v_gvalues[v] = std::numeric_limits<unsigned int>::max();
+      v_rhsvalues[v] = std::numeric_limits<unsigned int>::max();
+   }
+   
+   // resumed search
+   vs_expanded.clear();
+   num_expansions = 0;
+   LPAStar lpastar_resumed(g, v_start, v_goal,
+      grid_heuristic<Graph,MapVII>(g, v_goal, MapVII(v_coords)),
+      counting_visitor<Graph>(vs_expanded,num_expansions),
+      MapVV(v_preds), MapVI(v_gvalues), MapVI(v_rhsvalues), MapEI(e_dists),
+      get(boost::vertex_index, g),
+      std::less<unsigned int>(),
+      boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()),
+      std::numeric_limits<unsigned int>::max(), 0,
+      0, // goal_margin
+      true); // do_resume
+   ASSERT_TRUE(lpastar_resumed.compute_shortest_path());
+   
+   // fresh search
+   std::map<Vertex,Vertex> v_preds_fresh;
+   std::map<Vertex,unsigned int> v_gvalues_fresh;
+   std::map<Vertex,unsigned int> v_rhsvalues_fresh;
+   std::set<Vertex> vs_expanded_fresh;
+   int num_expansions_fresh = 0;
+   LPAStar lpastar_fresh(g, v_start, v_goal,
+      grid_heuristic<Graph,MapVII>(g, v_goal, MapVII(v_coords)),
+      counting_visitor<Graph>(vs_expanded_fresh,num_expansions_fresh),
+      MapVV(v_preds_fresh), MapVI(v_gvalues_fresh), MapVI(v_rhsvalues_fresh), MapEI(e_dists),
+      get(boost::vertex_index, g),
+      std::less<unsigned int>(),
+      boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()),
+      std::numeric_limits<unsigned int>::max(), 0,
+      0); // goal_margin
+   ASSERT_TRUE(lpastar_fresh.compute_shortest_path());
+   
+   // true shortest path length
+   std::map<Vertex,unsigned int> v_dists;
+   boost::dijkstra_shortest_paths(g, v_start,
+      boost::weight_map(MapEI(e_dists))
+      .distance_map(MapVI(v_dists))
+      .distance_combine(boost::closed_plus<unsigned int>(std::numeric_limits<unsigned int>::max()))
+      .distance_inf(std::numeric_limits<unsigned int>::max()));
+   ASSERT_NE(std::numeric_limits<unsigned int>::max(), v_dists[v_goal]);
+   ASSERT_EQ(v_dists[v_goal], v_gvalues_fresh[v_goal]);
+   ASSERT_EQ(v_dists[v_goal], v_gvalues[v_goal]);
+   
+   // the resumed path is feasible, and as short
+   unsigned int len = 0;
+   for (Vertex v_walk=v_goal; v_walk!=v_start;)
+   {
+      Vertex v_pred = v_preds[v_walk];
+      ASSERT_NE(v_walk, v_pred);
+      len += e_dists[edge(v_pred,v_walk,g).first];
+      v_walk = v_pred;
+   }
+   ASSERT_EQ(v_dists[v_goal], len);
+   ASSERT_LT(num_expansions, num_expansions_fresh);
+}
+
 int main(int argc, char **argv)
 {
    testing::InitGoogleTest(&argc, argv);
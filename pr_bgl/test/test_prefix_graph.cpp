@@ -0,0 +1,128 @@
+/* File: prefix_graph.cpp
+ * Author: Chris Dellin <cdellin@gmail.com>
+ * Copyright: 2015 Carnegie Mellon University
+ * License: BSD
+ */
+
+#include <stdio.h>
+#include <map>
+
+#include <boost/graph/relax.hpp> // for closed_plus
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/filtered_graph.hpp>
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+
+#include <pr_bgl/prefix_graph.h>
+
+#include <gtest/gtest.h>
+
+struct EProps
+{
+   int batch;
+   double weight;
+};
+typedef boost::adjacency_list<
+   boost::vecS, boost::vecS, boost::undirectedS,
+   boost::no_property, EProps> Graph;
+typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
+typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+typedef boost::graph_traits<Graph>::out_edge_iterator OutEdgeIter;
+typedef boost::iterator_property_map<std::vector<size_t>::iterator,
+   boost::property_map<Graph, boost::vertex_index_t>::type> PrefixMap;
+typedef pr_bgl::prefix_graph<Graph,PrefixMap> PrefixGraph;
+
+struct filter_batches
+{
+   const Graph * g;
+   int num_batches;
+   filter_batches(): g(0), num_batches(0) {}
+   filter_batches(const Graph & g, int num_batches): g(&g), num_batches(num_batches) {}
+   bool operator()(const Edge & e) const { return (*g)[e].batch < num_batches; }
+};
+
+/* a 20x20 grid whose edges are added in batch order (so that each
+ * vertex's out-edges are sorted by batch); the prefix view over the
+ * first k batches must match a filtered_graph over the same edges */
+TEST(PrefixGraphTestCase, PrefixGraphTest)
+{
+   const unsigned int n = 20;
+   const int num_batches = 4;
+   Graph g(n*n);
+   unsigned int seed = 1;
+   std::vector< std::pair<Vertex,Vertex> > pairs;
+   for (unsigned int i=0; i<n; i++)
+   for (unsigned int j=0; j<n; j++)
+   {
+      if (j+1 < n) pairs.push_back(std::make_pair(i*n+j, i*n+j+1));
+      if (i+1 < n) pairs.push_back(std::make_pair(i*n+j, (i+1)*n+j));
+   }
+   std::vector<int> pair_batches(pairs.size());
+   for (unsigned int ui=0; ui<pairs.size(); ui++)
+   {
+      seed = seed * 1103515245 + 12345;
+      pair_batches[ui] = (seed >> 16) % num_batches;
+   }
+   for (int b=0; b<num_batches; b++)
+   for (unsigned int ui=0; ui<pairs.size(); ui++)
+   {
+      if (pair_batches[ui] != b)
+         continue;
+      Edge e = add_edge(pairs[ui].first, pairs[ui].second, g).first;
+      g[e].batch = b;
+      seed = seed * 1103515245 + 12345;
+      g[e].weight = 1.0 + (seed >> 16) % 10;
+   }
+   
+   for (int k=0; k<=num_batches; k++)
+   {
+      // per-vertex prefix lengths
+      std::vector<size_t> degrees(num_vertices(g));
+      for (unsigned int vi=0; vi<num_vertices(g); vi++)
+      {
+         OutEdgeIter ei, ei_end;
+         for (boost::tie(ei,ei_end)=out_edges(vi,g); ei!=ei_end; ++ei)
+            if (g[*ei].batch < k)
+               degrees[vi]++;
+      }
+      PrefixGraph pg(g, PrefixMap(degrees.begin(), get(boost::vertex_index,g)));
+      filter_batches filter(g, k);
+      boost::filtered_graph<Graph,filter_batches> fg(g, filter);
+      
+      // same edge sets
+      unsigned int count = 0;
+      boost::graph_traits<PrefixGraph>::edge_iterator ei, ei_end;
+      for (boost::tie(ei,ei_end)=edges(pg); ei!=ei_end; ++ei)
+      {
+         ASSERT_LT(g[*ei].batch, k);
+         ASSERT_TRUE(edge(source(*ei,pg), target(*ei,pg), pg).second);
+         ASSERT_TRUE(edge(target(*ei,pg), source(*ei,pg), pg).second);
+         count++;
+      }
+      ASSERT_EQ(num_edges(pg), count);
+      unsigned int count_filtered = 0;
+      boost::graph_traits< boost::filtered_graph<Graph,filter_batches> >::edge_iterator fi, fi_end;
+      for (boost::tie(fi,fi_end)=edges(fg); fi!=fi_end; ++fi)
+         count_filtered++;
+      ASSERT_EQ(count_filtered, count);
+      
+      // same shortest path distances
+      std::vector<double> dist(num_vertices(g));
+      std::vector<double> dist_filtered(num_vertices(g));
+      boost::dijkstra_shortest_paths(pg, vertex(0,pg),
+         boost::weight_map(get(&EProps::weight,pg))
+         .distance_map(boost::make_iterator_property_map(dist.begin(), get(boost::vertex_index,pg))));
+      boost::dijkstra_shortest_paths(fg, vertex(0,g),
+         boost::weight_map(get(&EProps::weight,fg))
+         .distance_map(boost::make_iterator_property_map(dist_filtered.begin(), get(boost::vertex_index,g))));
+      for (unsigned int vi=0; vi<num_vertices(g); vi++)
+         ASSERT_EQ(dist_filtered[vi], dist[vi]);
+      printf("batches %d: %u edges\n", k, count);
+   }
+}
+
+int main(int argc, char **argv)
+{
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}